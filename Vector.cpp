@@ -46,25 +46,34 @@ namespace Csi
 //
 //----------------------------------------------------
 
-Vector& Vector::operator=(char* str)
+template <typename T>
+VectorT<T>& VectorT<T>::operator=(char* str)
 {
    std::istringstream iss(str);
    iss >> x >> y >> z;
+   return *this;
 }
 
-std::string Vector::ToString() const
+template <typename T>
+std::string VectorT<T>::ToString() const
 {
    std::ostringstream oss;
    oss << x<< " " << y << " "<< z;
    return oss.str();
 }
 
-std::ostream& operator<< (std::ostream& os, const Vector &v)
+template <typename T>
+std::ostream& operator<< (std::ostream& os, const VectorT<T> &v)
 {
    os << v.ToString();
    return os;
 }
 
+template struct VectorT<double>;
+template struct VectorT<float>;
+template std::ostream& operator<< (std::ostream& os, const VectorT<double> &v);
+template std::ostream& operator<< (std::ostream& os, const VectorT<float> &v);
+
 } // end namespace Csi
 
 
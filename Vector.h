@@ -35,8 +35,11 @@
 ///
 //-------------------------------------------------------------------------
 #ifndef _Csi_Vector_h_
+#define _Csi_Vector_h_
 #include <cmath>
+#include <cstring>
 #include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -45,42 +48,100 @@
 namespace Csi
 {
 
-///@brief   Represents a 3 dimensional (x,y,z) vector
-struct Vector
+///@brief   Represents a 3 dimensional (x,y,z) vector of T (float or double)
+///
+/// Trivially copyable, so arrays of vectors can be moved with memcpy, and usable in constant
+/// expressions. Use Vector (double) or VectorF (float).
+template <typename T>
+struct VectorT
 {
-   double x,y,z;
-   Vector() :x(0),y(0),z(0){}
-   Vector(const Vector& r):x(r.x), y(r.y), z(r.z){}
-   Vector(const double& a, const double& b, const double& c) {x=a; y=b; z=c;}
-   Vector& operator-=(const Vector& r)  { x -= r.x; y -= r.y; z -= r.z; return *this; }
-   Vector& operator+=(const Vector& r)  { x += r.x; y += r.y; z += r.z; return *this; }
+   typedef T value_type;
+
+   T x,y,z;
+   constexpr VectorT() :x(0),y(0),z(0){}
+   constexpr VectorT(const T& a, const T& b, const T& c) :x(a), y(b), z(c){}
+   /// @brief Convert from a vector of another precision
+   template <typename U>
+   constexpr explicit VectorT(const VectorT<U>& r) :x(T(r.x)), y(T(r.y)), z(T(r.z)){}
+   constexpr VectorT& operator-=(const VectorT& r)  { x -= r.x; y -= r.y; z -= r.z; return *this; }
+   constexpr VectorT& operator+=(const VectorT& r)  { x += r.x; y += r.y; z += r.z; return *this; }
    /// Subtract operator returns a Vector; does not affect vector
-   const Vector operator-(const Vector& r)  const { return Vector(x-r.x, y-r.y, z-r.z); }
+   constexpr const VectorT operator-(const VectorT& r)  const { return VectorT(x-r.x, y-r.y, z-r.z); }
    /// Addition operator returns a Vector; does not affect vector
-   const Vector operator+(const Vector& r)  const { return Vector(x+r.x, y+r.y, z+r.z); }
-   /// Dot product operator returns a double; does not affect the vector
-   const double operator*(const Vector& r) const { return (x*r.x + y*r.y + z*r.z); }
+   constexpr const VectorT operator+(const VectorT& r)  const { return VectorT(x+r.x, y+r.y, z+r.z); }
+   /// Dot product operator returns a T; does not affect the vector
+   constexpr const T operator*(const VectorT& r) const { return (x*r.x + y*r.y + z*r.z); }
    /// @brief Multiply vector by a scale factor; does ot affect the current vector
-   const Vector operator*(const double& s)  const { return Vector(s*x, s*y, s*z); }
+   constexpr const VectorT operator*(const T& s)  const { return VectorT(s*x, s*y, s*z); }
+   T GetMagnitude() const { return std::sqrt(x*x+y*y+z*z);}
    /// @brief Return vector in string format;
-   double GetMagnitude() const { return sqrt(x*x+y*y+z*z);}
    std::string ToString() const;
-   bool operator==(const Vector& r) const { return (x==r.x && y==r.y && z==r.z); }
+   constexpr bool operator==(const VectorT& r) const { return (x==r.x && y==r.y && z==r.z); }
 
    /// @brief Assign a char* string of three values to a vector
-   Vector& operator=(char *str);
+   VectorT& operator=(char *str);
 };
 
+typedef VectorT<double> Vector;
+typedef VectorT<float> VectorF;
+
 /// @brief Vector comparison for use in an stl:set
+///
+/// Orders by x, then y, then z, consistent with Vector::operator==
 struct VectorComp
 {
    /// @brief Comparator operator for use in an stl:set
-   bool operator() (const Vector& lhs, const Vector& rhs) const {return lhs.ToString()<rhs.ToString();}
+   template <typename T>
+   bool operator() (const VectorT<T>& lhs, const VectorT<T>& rhs) const
+   {
+      if (lhs.x != rhs.x) return lhs.x < rhs.x;
+      if (lhs.y != rhs.y) return lhs.y < rhs.y;
+      return lhs.z < rhs.z;
+   }
 };
+
+/// @brief Hash value of a Vector, consistent with Vector::operator== (0.0 and -0.0 hash alike)
+///
+/// Components are hashed as doubles, so a VectorF hashes like the Vector it converts to.
+template <typename T>
+inline size_t GetHash(const VectorT<T>& v)
+{
+   const double c[3] = {v.x + 0.0, v.y + 0.0, v.z + 0.0};    // + 0.0 turns -0.0 into 0.0
+   uint64_t h(0);
+   for (int i=0; i<3; ++i)
+   {
+      uint64_t bits;
+      memcpy(&bits, &c[i], sizeof(bits));
+      // splitmix64 step with the component added to the state
+      h += bits + 0x9e3779b97f4a7c15ULL;
+      h = (h ^ (h >> 30))*0xbf58476d1ce4e5b9ULL;
+      h = (h ^ (h >> 27))*0x94d049bb133111ebULL;
+      h ^= h >> 31;
+   }
+   return (size_t)h;
+}
 /// @brief Used for printing a vector
-std::ostream& operator<< (std::ostream& os, const Vector &v);
+template <typename T>
+std::ostream& operator<< (std::ostream& os, const VectorT<T> &v);
+
+// ToString, operator=(char*) and operator<< are compiled once in Vector.cpp
+extern template VectorT<double>& VectorT<double>::operator=(char* str);
+extern template VectorT<float>& VectorT<float>::operator=(char* str);
+extern template std::string VectorT<double>::ToString() const;
+extern template std::string VectorT<float>::ToString() const;
+extern template std::ostream& operator<< (std::ostream& os, const VectorT<double> &v);
+extern template std::ostream& operator<< (std::ostream& os, const VectorT<float> &v);
 
 } // end namespace Csi
+
+namespace std
+{
+/// @brief Hash for unordered containers of Csi::Vector and Csi::VectorF
+template <typename T> struct hash<Csi::VectorT<T> >
+{
+   size_t operator()(const Csi::VectorT<T>& v) const { return Csi::GetHash(v); }
+};
+} // end namespace std
 #endif // _Csi_Vector_h_
 
 
@@ -0,0 +1,287 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   VectorArray.cpp
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Array of 3 dimensional vectors stored as structure of arrays
+///
+///  @details 
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#include "VectorArray.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Csi
+{
+
+namespace
+{
+
+void CrossKernel(size_t n, const double* __restrict x, const double* __restrict y, const double* __restrict z,
+                 const double* __restrict rx, const double* __restrict ry, const double* __restrict rz,
+                 double* __restrict ox, double* __restrict oy, double* __restrict oz)
+{
+   for (size_t i=0; i<n; ++i)
+   {
+      ox[i] = y[i]*rz[i] - z[i]*ry[i];
+      oy[i] = z[i]*rx[i] - x[i]*rz[i];
+      oz[i] = x[i]*ry[i] - y[i]*rx[i];
+   }
+}
+
+} // end namespace
+
+//----------------------------------------------------
+//
+// The kernels loop over restrict qualified component
+// pointers so the compiler can vectorize them
+//
+//----------------------------------------------------
+
+void VectorArray::Assign(const Vector* v, size_t n)
+{
+   Resize(n);
+   double* __restrict x = GetX();
+   double* __restrict y = GetY();
+   double* __restrict z = GetZ();
+   for (size_t i=0; i<n; ++i)
+   {
+      x[i] = v[i].x;
+      y[i] = v[i].y;
+      z[i] = v[i].z;
+   }
+}
+
+void VectorArray::CopyTo(Vector* v) const
+{
+   const size_t n = GetSize();
+   const double* __restrict x = GetX();
+   const double* __restrict y = GetY();
+   const double* __restrict z = GetZ();
+   for (size_t i=0; i<n; ++i)
+   {
+      v[i].x = x[i];
+      v[i].y = y[i];
+      v[i].z = z[i];
+   }
+}
+
+std::vector<Vector> VectorArray::ToVectors() const
+{
+   std::vector<Vector> v(GetSize());
+   if (!v.empty()) CopyTo(&v[0]);
+   return v;
+}
+
+VectorArray& VectorArray::operator+=(const VectorArray& r)
+{
+   Axpy(1.0, r);
+   return *this;
+}
+
+VectorArray& VectorArray::operator-=(const VectorArray& r)
+{
+   Axpy(-1.0, r);
+   return *this;
+}
+
+VectorArray& VectorArray::operator*=(double s)
+{
+   const size_t n = GetSize();
+   double* __restrict x = GetX();
+   double* __restrict y = GetY();
+   double* __restrict z = GetZ();
+   for (size_t i=0; i<n; ++i) x[i] *= s;
+   for (size_t i=0; i<n; ++i) y[i] *= s;
+   for (size_t i=0; i<n; ++i) z[i] *= s;
+   return *this;
+}
+
+VectorArray& VectorArray::operator+=(const Vector& v)
+{
+   const size_t n = GetSize();
+   double* __restrict x = GetX();
+   double* __restrict y = GetY();
+   double* __restrict z = GetZ();
+   for (size_t i=0; i<n; ++i) x[i] += v.x;
+   for (size_t i=0; i<n; ++i) y[i] += v.y;
+   for (size_t i=0; i<n; ++i) z[i] += v.z;
+   return *this;
+}
+
+void VectorArray::Axpy(double a, const VectorArray& r)
+{
+   if (&r == this)
+   {
+      // the kernels below require r not to alias this
+      const VectorArray copy(r);
+      Axpy(a, copy);
+      return;
+   }
+   const size_t n = GetSize();
+   double* __restrict x = GetX();
+   double* __restrict y = GetY();
+   double* __restrict z = GetZ();
+   const double* __restrict rx = r.GetX();
+   const double* __restrict ry = r.GetY();
+   const double* __restrict rz = r.GetZ();
+   if (a == 1.0)
+   {
+      // exact sums, as Vector::operator+=
+      for (size_t i=0; i<n; ++i) x[i] += rx[i];
+      for (size_t i=0; i<n; ++i) y[i] += ry[i];
+      for (size_t i=0; i<n; ++i) z[i] += rz[i];
+   }
+   else if (a == -1.0)
+   {
+      for (size_t i=0; i<n; ++i) x[i] -= rx[i];
+      for (size_t i=0; i<n; ++i) y[i] -= ry[i];
+      for (size_t i=0; i<n; ++i) z[i] -= rz[i];
+   }
+   else
+   {
+      for (size_t i=0; i<n; ++i) x[i] += a*rx[i];
+      for (size_t i=0; i<n; ++i) y[i] += a*ry[i];
+      for (size_t i=0; i<n; ++i) z[i] += a*rz[i];
+   }
+}
+
+void VectorArray::Dot(const VectorArray& r, double* __restrict out) const
+{
+   const size_t n = GetSize();
+   const double* __restrict x = GetX();
+   const double* __restrict y = GetY();
+   const double* __restrict z = GetZ();
+   const double* __restrict rx = r.GetX();
+   const double* __restrict ry = r.GetY();
+   const double* __restrict rz = r.GetZ();
+   for (size_t i=0; i<n; ++i) out[i] = x[i]*rx[i] + y[i]*ry[i] + z[i]*rz[i];
+}
+
+void VectorArray::Dot(const Vector& v, double* __restrict out) const
+{
+   const size_t n = GetSize();
+   const double* __restrict x = GetX();
+   const double* __restrict y = GetY();
+   const double* __restrict z = GetZ();
+   const double vx(v.x), vy(v.y), vz(v.z);
+   for (size_t i=0; i<n; ++i) out[i] = x[i]*vx + y[i]*vy + z[i]*vz;
+}
+
+void VectorArray::GetMagnitudes(double* __restrict out) const
+{
+   Dot(*this, out);
+   const size_t n = GetSize();
+   for (size_t i=0; i<n; ++i) out[i] = sqrt(out[i]);
+}
+
+void VectorArray::Normalize()
+{
+   const size_t n = GetSize();
+   double* __restrict x = GetX();
+   double* __restrict y = GetY();
+   double* __restrict z = GetZ();
+   // zero vectors and lengths whose squares underflow or overflow take the scalar loop
+   const double minSquare = std::numeric_limits<double>::min();
+   const double maxSquare = std::numeric_limits<double>::max();
+   bool special(false);
+   for (size_t i=0; i<n && !special; ++i)
+   {
+      const double d2 = x[i]*x[i] + y[i]*y[i] + z[i]*z[i];
+      special = !(d2 >= minSquare && d2 <= maxSquare);
+   }
+   if (!special)
+   {
+      for (size_t i=0; i<n; ++i)
+      {
+         double s = 1.0/sqrt(x[i]*x[i] + y[i]*y[i] + z[i]*z[i]);
+         x[i] *= s;
+         y[i] *= s;
+         z[i] *= s;
+      }
+      return;
+   }
+   for (size_t i=0; i<n; ++i)
+   {
+      double d2 = x[i]*x[i] + y[i]*y[i] + z[i]*z[i];
+      if (x[i] == 0.0 && y[i] == 0.0 && z[i] == 0.0) continue;
+      double a(x[i]), b(y[i]), c(z[i]);
+      if (!(d2 >= minSquare && d2 <= maxSquare))
+      {
+         // divide by the largest component first so the squares are close to 1
+         const double m = std::max(fabs(a), std::max(fabs(b), fabs(c)));
+         if (!(m > 0.0) || std::isinf(m)) continue;
+         a /= m;
+         b /= m;
+         c /= m;
+         d2 = a*a + b*b + c*c;
+      }
+      const double s = 1.0/sqrt(d2);
+      x[i] = a*s;
+      y[i] = b*s;
+      z[i] = c*s;
+   }
+}
+
+void VectorArray::Cross(const VectorArray& r, VectorArray& out) const
+{
+   if (&out == this || &out == &r)
+   {
+      VectorArray tmp;
+      Cross(r, tmp);
+      out.m_x.swap(tmp.m_x);
+      out.m_y.swap(tmp.m_y);
+      out.m_z.swap(tmp.m_z);
+      return;
+   }
+   out.Resize(GetSize());
+   CrossKernel(GetSize(), GetX(), GetY(), GetZ(), r.GetX(), r.GetY(), r.GetZ(), out.GetX(), out.GetY(), out.GetZ());
+}
+
+void VectorArray::Apply(const double m[3][3])
+{
+   const size_t n = GetSize();
+   double* __restrict x = GetX();
+   double* __restrict y = GetY();
+   double* __restrict z = GetZ();
+   const double m00(m[0][0]), m01(m[0][1]), m02(m[0][2]);
+   const double m10(m[1][0]), m11(m[1][1]), m12(m[1][2]);
+   const double m20(m[2][0]), m21(m[2][1]), m22(m[2][2]);
+   for (size_t i=0; i<n; ++i)
+   {
+      double a(x[i]), b(y[i]), c(z[i]);
+      x[i] = m00*a + m01*b + m02*c;
+      y[i] = m10*a + m11*b + m12*c;
+      z[i] = m20*a + m21*b + m22*c;
+   }
+}
+
+} // end namespace Csi
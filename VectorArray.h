@@ -0,0 +1,145 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   VectorArray.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Array of 3 dimensional vectors stored as structure of arrays
+///
+///  @details The x, y and z components are held in separate 64 byte aligned arrays so the batched
+///           kernels run over contiguous doubles and vectorize.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_VectorArray_h_
+#define _Csi_VectorArray_h_
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "Vector.h"
+
+namespace Csi
+{
+
+///@brief   Allocator returning memory aligned to Alignment bytes
+template <class T, size_t Alignment = 64>
+struct AlignedAllocator
+{
+   typedef T value_type;
+   template <class U> struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+   AlignedAllocator() {}
+   template <class U> AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+   T* allocate(size_t n)
+   {
+      // aligned_alloc needs a size that is a multiple of the alignment
+      size_t bytes = (n*sizeof(T) + Alignment - 1)/Alignment*Alignment;
+      void* p = std::aligned_alloc(Alignment, bytes > 0 ? bytes : Alignment);
+      if (!p) throw std::bad_alloc();
+      return static_cast<T*>(p);
+   }
+   void deallocate(T* p, size_t) { std::free(p); }
+
+   template <class U> bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+   template <class U> bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+///@brief   Array of 3 dimensional (x,y,z) vectors in structure of arrays layout
+///
+/// The element wise operations require arrays of the same size.
+class VectorArray
+{
+public:
+   typedef std::vector<double, AlignedAllocator<double> > Component;
+
+   VectorArray() {}
+   /// @brief n zero vectors
+   explicit VectorArray(size_t n) : m_x(n), m_y(n), m_z(n) {}
+   /// @brief Copy of the n vectors at v
+   VectorArray(const Vector* v, size_t n) { Assign(v, n); }
+
+   size_t GetSize() const { return m_x.size(); }
+   bool IsEmpty() const { return m_x.empty(); }
+   void Resize(size_t n) { m_x.resize(n); m_y.resize(n); m_z.resize(n); }
+   void Reserve(size_t n) { m_x.reserve(n); m_y.reserve(n); m_z.reserve(n); }
+   void Clear() { m_x.clear(); m_y.clear(); m_z.clear(); }
+
+   void PushBack(const Vector& v) { m_x.push_back(v.x); m_y.push_back(v.y); m_z.push_back(v.z); }
+   Vector Get(size_t i) const { return Vector(m_x[i], m_y[i], m_z[i]); }
+   void Set(size_t i, const Vector& v) { m_x[i] = v.x; m_y[i] = v.y; m_z[i] = v.z; }
+
+   /// @brief Component arrays, GetSize() elements each
+   double* GetX() { return m_x.data(); }
+   double* GetY() { return m_y.data(); }
+   double* GetZ() { return m_z.data(); }
+   const double* GetX() const { return m_x.data(); }
+   const double* GetY() const { return m_y.data(); }
+   const double* GetZ() const { return m_z.data(); }
+
+   /// @brief Replace the contents by the n vectors at v
+   void Assign(const Vector* v, size_t n);
+   /// @brief Copy the vectors to v, which holds GetSize() vectors
+   void CopyTo(Vector* v) const;
+   /// @brief Contents as a std::vector<Vector>
+   std::vector<Vector> ToVectors() const;
+
+   /// @brief Add r element wise
+   VectorArray& operator+=(const VectorArray& r);
+   /// @brief Subtract r element wise
+   VectorArray& operator-=(const VectorArray& r);
+   /// @brief Multiply every vector by s
+   VectorArray& operator*=(double s);
+   /// @brief Add v to every vector
+   VectorArray& operator+=(const Vector& v);
+   /// @brief this += a*r
+   void Axpy(double a, const VectorArray& r);
+
+   /// @brief Dot products with r; out holds GetSize() values
+   void Dot(const VectorArray& r, double* out) const;
+   /// @brief Dot products with a single vector v
+   void Dot(const Vector& v, double* out) const;
+   /// @brief Magnitudes; out holds GetSize() values
+   void GetMagnitudes(double* out) const;
+   /// @brief Scale every vector to unit length; zero vectors stay zero
+   void Normalize();
+   /// @brief Element wise cross products this x r into out, which is resized
+   void Cross(const VectorArray& r, VectorArray& out) const;
+   /// @brief Replace every vector v by m*v, m row major
+   void Apply(const double m[3][3]);
+
+   bool operator==(const VectorArray& r) const { return m_x == r.m_x && m_y == r.m_y && m_z == r.m_z; }
+
+protected:
+   Component m_x;
+   Component m_y;
+   Component m_z;
+};
+
+} // end namespace Csi
+#endif // _Csi_VectorArray_h_
@@ -0,0 +1,287 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   VectorIO.cpp
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Bulk reading and writing of text files of 3 dimensional points
+///
+///  @details 
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#include "VectorIO.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Csi
+{
+
+namespace
+{
+
+inline bool IsSpace(char c) { return c==' ' || c=='\t' || c=='\r' || c=='\n'; }
+
+/// @brief Parse the next number of [p,end) into value, skipping white space before it
+inline bool ParseValue(const char*& p, const char* end, double& value)
+{
+   while (p!=end && IsSpace(*p)) ++p;
+   if (p == end) return false;
+   if (*p == '+') ++p;     // from_chars does not accept an explicit plus sign
+   std::from_chars_result res = std::from_chars(p, end, value);
+   if (res.ec != std::errc() || (res.ptr!=end && !IsSpace(*res.ptr))) return false;
+   p = res.ptr;
+   return true;
+}
+
+/// @brief Points and malformed lines of one chunk of the input
+struct ParsedChunk
+{
+   ParsedChunk() : lines(0), malformed(0), firstMalformed(0) {}
+   std::vector<Vector> points;
+   uint64_t lines;
+   uint64_t malformed;
+   uint64_t firstMalformed;     ///< 1 based line within the chunk
+};
+
+void ParseChunk(const char* p, const char* end, ParsedChunk& chunk)
+{
+   chunk.points.reserve((end - p)/24);
+   while (p < end)
+   {
+      const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+      const char* lineEnd = nl ? nl : end;
+      ++chunk.lines;
+      const char* q = p;
+      while (q!=lineEnd && IsSpace(*q)) ++q;
+      if (q != lineEnd)
+      {
+         Vector v;
+         if (ParseValue(q, lineEnd, v.x) && ParseValue(q, lineEnd, v.y) && ParseValue(q, lineEnd, v.z))
+         {
+            chunk.points.push_back(v);
+         }
+         else if (chunk.malformed++ == 0) chunk.firstMalformed = chunk.lines;
+      }
+      p = nl ? nl + 1 : end;
+   }
+}
+
+void AppendPoints(std::vector<Vector>& out, const std::vector<Vector>& points)
+{
+   out.insert(out.end(), points.begin(), points.end());
+}
+
+void AppendPoints(VectorArray& out, const std::vector<Vector>& points)
+{
+   const size_t n = out.GetSize();
+   out.Resize(n + points.size());
+   for (size_t i=0; i<points.size(); ++i) out.Set(n + i, points[i]);
+}
+
+/// @brief Parse [data, data+size) on threads, appending the points in input order
+template <class Output>
+void ParseBuffer(const char* data, size_t size, uint32_t threads, Output& out, uint64_t& malformed, uint64_t& firstMalformed)
+{
+   if (threads == 0)
+   {
+      threads = std::thread::hardware_concurrency();
+      if (threads == 0) threads = 1;
+   }
+   // chunks are split after a newline; small inputs are not worth a thread
+   if (size < threads*(size_t)(1 << 20)) threads = size/(1 << 20) + 1;
+   std::vector<const char*> bounds(threads + 1, data + size);
+   bounds[0] = data;
+   for (uint32_t t=1; t<threads; ++t)
+   {
+      const char* p = std::max(bounds[t-1], data + size*t/threads);
+      const char* nl = p < data + size ? static_cast<const char*>(memchr(p, '\n', data + size - p)) : 0;
+      bounds[t] = nl ? nl + 1 : data + size;
+   }
+   std::vector<ParsedChunk> chunks(threads);
+   if (threads == 1) ParseChunk(bounds[0], bounds[1], chunks[0]);
+   else
+   {
+      std::vector<std::thread> pool;
+      for (uint32_t t=0; t<threads; ++t)
+      {
+         pool.push_back(std::thread([&, t]() { ParseChunk(bounds[t], bounds[t+1], chunks[t]); }));
+      }
+      for (size_t t=0; t<pool.size(); ++t) pool[t].join();
+   }
+   malformed = 0;
+   firstMalformed = 0;
+   uint64_t lines(0);
+   for (uint32_t t=0; t<threads; ++t)
+   {
+      if (chunks[t].malformed > 0 && malformed == 0) firstMalformed = lines + chunks[t].firstMalformed;
+      malformed += chunks[t].malformed;
+      lines += chunks[t].lines;
+      AppendPoints(out, chunks[t].points);
+      std::vector<Vector>().swap(chunks[t].points);
+   }
+}
+
+} // end namespace
+
+void VectorReader::Parse(const char* data, size_t size, std::vector<Vector>& out)
+{
+   ParseBuffer(data, size, m_threads, out, m_malformed, m_firstMalformed);
+}
+
+void VectorReader::Parse(const char* data, size_t size, VectorArray& out)
+{
+   ParseBuffer(data, size, m_threads, out, m_malformed, m_firstMalformed);
+}
+
+bool VectorReader::Load(const std::string& fname, std::vector<Vector>& out)
+{
+   return LoadFile(fname, out);
+}
+
+bool VectorReader::Load(const std::string& fname, VectorArray& out)
+{
+   return LoadFile(fname, out);
+}
+
+template <class Output>
+bool VectorReader::LoadFile(const std::string& fname, Output& out)
+{
+   m_error.clear();
+   m_malformed = m_firstMalformed = 0;
+   int fd = (fname == "-") ? dup(STDIN_FILENO) : open(fname.c_str(), O_RDONLY);
+   if (fd < 0)
+   {
+      m_error = fname + ": " + strerror(errno);
+      return false;
+   }
+   struct stat st;
+   if (m_mapping && fstat(fd, &st)==0 && S_ISREG(st.st_mode) && st.st_size > 0)
+   {
+      void* p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED)
+      {
+         madvise(p, st.st_size, MADV_SEQUENTIAL);
+         ParseBuffer(static_cast<const char*>(p), st.st_size, m_threads, out, m_malformed, m_firstMalformed);
+         munmap(p, st.st_size);
+         close(fd);
+         return true;
+      }
+   }
+   // not mappable (pipes) or mapping disabled: read it all
+   std::vector<char> buffer;
+   size_t size(0);
+   for (;;)
+   {
+      if (size == buffer.size()) buffer.resize(buffer.empty() ? (4 << 20) : 2*buffer.size());
+      ssize_t n = read(fd, buffer.data() + size, buffer.size() - size);
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0)
+      {
+         m_error = fname + ": " + strerror(errno);
+         close(fd);
+         return false;
+      }
+      if (n == 0) break;
+      size += n;
+   }
+   close(fd);
+   ParseBuffer(buffer.data(), size, m_threads, out, m_malformed, m_firstMalformed);
+   return true;
+}
+
+char* VectorWriter::AppendValue(char* p, double value) const
+{
+   // 32 characters hold any shortest or 6 digit double
+   std::to_chars_result res = (m_format == FORMAT_STREAM) ?
+      std::to_chars(p, p + 32, value, std::chars_format::general, 6) : std::to_chars(p, p + 32, value);
+   return res.ptr;
+}
+
+void VectorWriter::Append(std::string& out, const Vector& v) const
+{
+   char line[3*32 + 3];
+   char* p = AppendValue(line, v.x);
+   *p++ = ' ';
+   p = AppendValue(p, v.y);
+   *p++ = ' ';
+   p = AppendValue(p, v.z);
+   *p++ = '\n';
+   out.append(line, p - line);
+}
+
+template <class Get>
+bool VectorWriter::WriteFile(const std::string& fname, size_t n, Get get) const
+{
+   FILE* f = (fname == "-") ? stdout : fopen(fname.c_str(), "wb");
+   if (!f) return false;
+   static const size_t blockSize = 4 << 20;
+   std::vector<char> buffer(blockSize + 3*32 + 3);
+   size_t used(0);
+   bool ok(true);
+   for (size_t i=0; i<n && ok; ++i)
+   {
+      const Vector v = get(i);
+      char* p = buffer.data() + used;
+      p = AppendValue(p, v.x);
+      *p++ = ' ';
+      p = AppendValue(p, v.y);
+      *p++ = ' ';
+      p = AppendValue(p, v.z);
+      *p++ = '\n';
+      used = p - buffer.data();
+      if (used >= blockSize)
+      {
+         ok = fwrite(buffer.data(), 1, used, f) == used;
+         used = 0;
+      }
+   }
+   if (ok && used > 0) ok = fwrite(buffer.data(), 1, used, f) == used;
+   if (f == stdout) ok = (fflush(f) == 0) && ok;
+   else ok = (fclose(f) == 0) && ok;
+   return ok;
+}
+
+bool VectorWriter::Write(const std::string& fname, const Vector* v, size_t n) const
+{
+   return WriteFile(fname, n, [v](size_t i) { return v[i]; });
+}
+
+bool VectorWriter::Write(const std::string& fname, const VectorArray& v) const
+{
+   return WriteFile(fname, v.GetSize(), [&v](size_t i) { return v.Get(i); });
+}
+
+} // end namespace Csi
@@ -0,0 +1,131 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   VectorIO.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Bulk reading and writing of text files of 3 dimensional points
+///
+///  @details A point file has one "x y z" point per line. VectorReader parses a whole buffer or file
+///           (memory mapped by default) in place with std::from_chars, optionally splitting it
+///           into chunks parsed on several threads. VectorWriter formats points into large
+///           buffers with std::to_chars.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_VectorIO_h_
+#define _Csi_VectorIO_h_
+#include <string>
+#include <vector>
+#include <inttypes.h>
+#include "Vector.h"
+#include "VectorArray.h"
+
+namespace Csi
+{
+
+///@brief   Reads "x y z" lines into Vectors
+///
+/// Blank lines are skipped and text after the third value is ignored, as with
+/// Vector::operator=(char*). Lines whose first three values cannot be read are skipped and
+/// counted as malformed.
+class VectorReader
+{
+public:
+   VectorReader() : m_threads(1), m_mapping(true), m_malformed(0), m_firstMalformed(0) {}
+
+   /// @brief Number of threads parsing a buffer; 0 uses one per hardware thread (default 1)
+   void SetThreads(uint32_t threads) { m_threads = threads; }
+   uint32_t GetThreads() const { return m_threads; }
+
+   /// @brief Memory map files instead of reading them into memory (default true)
+   void SetMapping(bool mapping) { m_mapping = mapping; }
+   bool GetMapping() const { return m_mapping; }
+
+   /// @brief Parse the points of a file, appending them to out; "-" reads standard input
+   ///@return false if the file cannot be read (see GetError)
+   bool Load(const std::string& fname, std::vector<Vector>& out);
+   bool Load(const std::string& fname, VectorArray& out);
+
+   /// @brief Parse the points in data, appending them to out
+   void Parse(const char* data, size_t size, std::vector<Vector>& out);
+   void Parse(const char* data, size_t size, VectorArray& out);
+
+   /// @brief Malformed lines skipped by the last Load or Parse
+   uint64_t GetMalformed() const { return m_malformed; }
+   /// @brief 1 based line number of the first malformed line, 0 if there was none
+   uint64_t GetFirstMalformedLine() const { return m_firstMalformed; }
+   /// @brief Description of the last Load failure
+   std::string GetError() const { return m_error; }
+
+protected:
+   template <class Output>
+   bool LoadFile(const std::string& fname, Output& out);
+
+   uint32_t m_threads;
+   bool m_mapping;
+   uint64_t m_malformed;
+   uint64_t m_firstMalformed;
+   std::string m_error;
+};
+
+///@brief   Writes Vectors as "x y z" lines
+class VectorWriter
+{
+public:
+   enum Format
+   {
+      FORMAT_SHORTEST = 0,     ///< shortest text that reads back to the same double (default)
+      FORMAT_STREAM            ///< the text of Vector::ToString and operator<< (6 significant digits)
+   };
+
+   explicit VectorWriter(Format format = FORMAT_SHORTEST) : m_format(format) {}
+
+   void SetFormat(Format format) { m_format = format; }
+   Format GetFormat() const { return m_format; }
+
+   /// @brief Append "x y z\n" to out
+   void Append(std::string& out, const Vector& v) const;
+
+   /// @brief Write n points to fname, or standard output for "-"
+   ///@return false if the file cannot be written
+   bool Write(const std::string& fname, const Vector* v, size_t n) const;
+   bool Write(const std::string& fname, const std::vector<Vector>& v) const { return Write(fname, v.data(), v.size()); }
+   bool Write(const std::string& fname, const VectorArray& v) const;
+
+protected:
+   /// @brief Write a double at p, returns the end of the text
+   char* AppendValue(char* p, double value) const;
+
+   template <class Get>
+   bool WriteFile(const std::string& fname, size_t n, Get get) const;
+
+   Format m_format;
+};
+
+} // end namespace Csi
+#endif // _Csi_VectorIO_h_
@@ -0,0 +1,178 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   VectorSet.cpp
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Set of points that merges points within a tolerance
+///
+///  @details 
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#include "VectorSet.h"
+
+namespace Csi
+{
+
+VectorGridSet::VectorGridSet(double tolerance)
+: m_tolerance(tolerance > 0.0 ? tolerance : 0.0), m_scale(tolerance > 0.0 ? 0.5/tolerance : 1.0), m_usedCells(0)
+{
+}
+
+void VectorGridSet::Reserve(size_t n)
+{
+   m_points.reserve(n);
+   if (m_tolerance == 0.0)
+   {
+      m_exact.reserve(n);
+      return;
+   }
+   m_next.reserve(n);
+   while (2*n > m_cells.size()) Grow();
+}
+
+void VectorGridSet::Clear()
+{
+   m_points.clear();
+   m_next.clear();
+   m_cells.clear();
+   m_usedCells = 0;
+   m_exact.clear();
+}
+
+int64_t VectorGridSet::GetCell(double c) const
+{
+   // clamp so far away points share the edge cells instead of overflowing
+   const double limit = 4.0e18;
+   c = floor(c*m_scale);
+   if (!(c > -limit)) return (int64_t)-limit;
+   if (c > limit) return (int64_t)limit;
+   return (int64_t)c;
+}
+
+uint64_t VectorGridSet::HashCell(int64_t i, int64_t j, int64_t k)
+{
+   uint64_t h = (uint64_t)i*0x9e3779b97f4a7c15ULL ^ (uint64_t)j*0xc2b2ae3d27d4eb4fULL ^ (uint64_t)k*0x165667b19e3779f9ULL;
+   h = (h ^ (h >> 30))*0xbf58476d1ce4e5b9ULL;
+   h = (h ^ (h >> 27))*0x94d049bb133111ebULL;
+   return h ^ (h >> 31);
+}
+
+size_t VectorGridSet::FindSlot(int64_t i, int64_t j, int64_t k) const
+{
+   const size_t mask = m_cells.size() - 1;
+   for (size_t s = HashCell(i, j, k) & mask; ; s = (s + 1) & mask)
+   {
+      const Cell& c = m_cells[s];
+      if (c.head == npos || (c.i == i && c.j == j && c.k == k)) return s;
+   }
+}
+
+void VectorGridSet::Grow()
+{
+   std::vector<Cell> old;
+   old.swap(m_cells);
+   Cell unused = {0, 0, 0, npos};
+   m_cells.assign(old.empty() ? 64 : 2*old.size(), unused);
+   for (size_t s=0; s<old.size(); ++s)
+   {
+      if (old[s].head != npos) m_cells[FindSlot(old[s].i, old[s].j, old[s].k)] = old[s];
+   }
+}
+
+size_t VectorGridSet::Find(const Vector& v) const
+{
+   if (m_tolerance == 0.0)
+   {
+      std::unordered_map<Vector, size_t>::const_iterator it = m_exact.find(v);
+      return it != m_exact.end() ? it->second : npos;
+   }
+   if (m_cells.empty()) return npos;
+   // the cells overlapping the cube of +/- tolerance around v, at most two per axis
+   const double t = m_tolerance;
+   const int64_t i0 = GetCell(v.x - t), i1 = GetCell(v.x + t);
+   const int64_t j0 = GetCell(v.y - t), j1 = GetCell(v.y + t);
+   const int64_t k0 = GetCell(v.z - t), k1 = GetCell(v.z + t);
+   const double tol2 = t*t;
+   size_t best(npos);
+   double bestDist2(0.0);
+   for (int64_t i=i0; i<=i1; ++i)
+   {
+      for (int64_t j=j0; j<=j1; ++j)
+      {
+         for (int64_t k=k0; k<=k1; ++k)
+         {
+            const Cell& c = m_cells[FindSlot(i, j, k)];
+            for (size_t p=c.head; p!=npos; p=m_next[p])
+            {
+               const Vector d = m_points[p] - v;
+               const double dist2 = d*d;
+               // the lower index wins a tie so the result does not depend on the chain order
+               if (dist2 <= tol2 && (best == npos || dist2 < bestDist2 || (dist2 == bestDist2 && p < best)))
+               {
+                  best = p;
+                  bestDist2 = dist2;
+               }
+            }
+         }
+      }
+   }
+   return best;
+}
+
+size_t VectorGridSet::Insert(const Vector& v, bool* inserted)
+{
+   if (m_tolerance == 0.0)
+   {
+      // equal points only, so a hash of the point finds them without a grid
+      std::pair<std::unordered_map<Vector, size_t>::iterator, bool> slot = m_exact.emplace(v, m_points.size());
+      if (inserted) *inserted = slot.second;
+      if (slot.second) m_points.push_back(v);
+      return slot.first->second;
+   }
+   size_t found = Find(v);
+   if (inserted) *inserted = (found == npos);
+   if (found != npos) return found;
+   if (2*(m_usedCells + 1) > m_cells.size()) Grow();
+   const int64_t i = GetCell(v.x), j = GetCell(v.y), k = GetCell(v.z);
+   Cell& c = m_cells[FindSlot(i, j, k)];
+   if (c.head == npos)
+   {
+      c.i = i;
+      c.j = j;
+      c.k = k;
+      ++m_usedCells;
+   }
+   const size_t index = m_points.size();
+   m_points.push_back(v);
+   m_next.push_back(c.head);
+   c.head = index;
+   return index;
+}
+
+} // end namespace Csi
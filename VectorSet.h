@@ -0,0 +1,103 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   VectorSet.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Set of points that merges points within a tolerance
+///
+///  @details Points are hashed into a grid of cubes of twice the tolerance, so a point within
+///           the tolerance of a new one is in one of at most 8 cells around it. The cells
+///           are an open addressing hash table and the points of a cell an index chain, so
+///           insertion allocates only when the tables grow.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_VectorSet_h_
+#define _Csi_VectorSet_h_
+#include <unordered_map>
+#include <vector>
+#include <inttypes.h>
+#include "Vector.h"
+
+namespace Csi
+{
+
+///@brief   Set of points in which points within a tolerance of each other are one point
+///
+/// Inserting a point returns the index of the stored point it merged with, or of the new
+/// point. The first point inserted in a neighbourhood is the one kept.
+class VectorGridSet
+{
+public:
+   static constexpr size_t npos = (size_t)-1;
+
+   /// @brief Points closer than or as close as tolerance are merged; 0 merges only equal points
+   explicit VectorGridSet(double tolerance = 0.0);
+
+   double GetTolerance() const { return m_tolerance; }
+   size_t GetSize() const { return m_points.size(); }
+   const Vector& Get(size_t i) const { return m_points[i]; }
+   /// @brief The points in insertion order
+   const std::vector<Vector>& GetPoints() const { return m_points; }
+
+   void Reserve(size_t n);
+   void Clear();
+
+   /// @brief Add v unless a point within the tolerance is stored
+   ///@param inserted If set, true when v was added
+   ///@return Index of v, or of the nearest stored point within the tolerance
+   size_t Insert(const Vector& v, bool* inserted = 0);
+
+   /// @brief Index of the nearest stored point within the tolerance of v, or npos
+   size_t Find(const Vector& v) const;
+
+protected:
+   struct Cell
+   {
+      int64_t i, j, k;        ///< grid coordinates
+      size_t head;            ///< last point inserted in the cell, npos for an unused slot
+   };
+
+   /// @brief Grid coordinate of a point coordinate
+   int64_t GetCell(double c) const;
+   static uint64_t HashCell(int64_t i, int64_t j, int64_t k);
+   /// @brief Slot of cell (i,j,k), or of the unused slot where it would go
+   size_t FindSlot(int64_t i, int64_t j, int64_t k) const;
+   void Grow();
+
+   double m_tolerance;
+   double m_scale;                 ///< 1/cell size, the cell size is twice the tolerance
+   std::vector<Vector> m_points;
+   std::vector<size_t> m_next;     ///< previous point of the same cell, npos at the end
+   std::vector<Cell> m_cells;      ///< open addressing table, power of two size
+   size_t m_usedCells;
+   std::unordered_map<Vector, size_t> m_exact;    ///< index of each point when the tolerance is 0
+};
+
+} // end namespace Csi
+#endif // _Csi_VectorSet_h_
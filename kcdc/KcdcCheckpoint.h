@@ -0,0 +1,209 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcCheckpoint.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Saved state of an AddFields or ProcessEventStats run, to resume or extend it
+///
+///  @details The input offset, counters, maps and open scrambling sets of a run.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcCheckpoint_h_
+#define _Csi_KcdcCheckpoint_h_
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <inttypes.h>
+#include <sys/stat.h>
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief State of a run after all input lines before position were processed
+struct KcdcCheckpoint
+{
+    ///@brief Histogram (SkyHistogram::GetData order) and open event set of a ProcessEventStats band
+    struct Band
+    {
+        Band() : setIndex(0), segment(0), windowBase(0), windowNext(0), nrealOutOfRange(0), nfakeOutOfRange(0) {}
+        uint64_t setIndex;
+        uint64_t segment;
+        uint64_t windowBase;                ///< sliding sets: segment index of the first event of the open set
+        uint64_t windowNext;                ///< sliding sets: segment index of the first event not yet scrambled
+        std::vector<uint64_t> nreal;
+        std::vector<uint64_t> nfake;
+        uint64_t nrealOutOfRange;
+        uint64_t nfakeOutOfRange;
+        std::vector<double> hourAngle;      ///< events of the open set, as kept by TimeScrambler
+        std::vector<double> dec;
+        std::vector<double> sidereal;
+    };
+
+    KcdcCheckpoint() : position(0), lines(0), malformed(0), inBand(0), energyPassed(0), written(0), outputSize(0) {}
+
+    std::string settings;       ///< operation and the settings its results depend on
+    std::string header;         ///< header line of the input
+    std::string lastLine;       ///< last line processed, to check that the input still has it
+    uint64_t position;          ///< input offset of the next line
+    uint64_t lines;             ///< data lines processed
+    uint64_t malformed;
+    uint64_t inBand;            ///< ProcessEventStats events in any band
+    uint64_t energyPassed;      ///< AddFields counters
+    uint64_t written;
+    uint64_t outputSize;        ///< bytes of AddFields output written
+    std::vector<Band> bands;    ///< ProcessEventStats bands, in the order they were given
+
+    static bool Exists(const std::string& fname)
+    {
+        struct stat st;
+        return stat(fname.c_str(), &st) == 0;
+    }
+
+    ///@brief Write the checkpoint to fname, replacing a previous one only once it is complete
+    bool Write(const std::string& fname) const
+    {
+        const std::string tmp = fname + ".tmp";
+        std::ofstream os(tmp.c_str(), std::ios::binary | std::ios::trunc);
+        os.write(s_magic, sizeof(s_magic));
+        Put(os, s_byteOrder);
+        Put(os, settings);
+        Put(os, header);
+        Put(os, lastLine);
+        const uint64_t counters[] = {position, lines, malformed, inBand, energyPassed, written, outputSize, bands.size()};
+        os.write(reinterpret_cast<const char*>(counters), sizeof(counters));
+        for (size_t b=0; b<bands.size(); ++b)
+        {
+            const Band& band = bands[b];
+            Put(os, band.setIndex);
+            Put(os, band.segment);
+            Put(os, band.windowBase);
+            Put(os, band.windowNext);
+            Put(os, band.nreal);
+            Put(os, band.nfake);
+            Put(os, band.nrealOutOfRange);
+            Put(os, band.nfakeOutOfRange);
+            Put(os, band.hourAngle);
+            Put(os, band.dec);
+            Put(os, band.sidereal);
+        }
+        os.close();
+        if (os.fail() || rename(tmp.c_str(), fname.c_str()) != 0)
+        {
+            remove(tmp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    ///@brief Read a checkpoint written by Write
+    ///@return false if fname cannot be read or is not a complete checkpoint
+    bool Read(const std::string& fname)
+    {
+        std::ifstream is(fname.c_str(), std::ios::binary);
+        char magic[sizeof(s_magic)];
+        uint32_t byteOrder(0);
+        if (!is.read(magic, sizeof(magic))) return false;
+        // version 1 checkpoints come from runs without sliding sets
+        const bool windows = memcmp(magic, s_magic, sizeof(magic)) == 0;
+        if (!windows && memcmp(magic, s_magicVersion1, sizeof(magic)) != 0) return false;
+        if (!Get(is, byteOrder) || byteOrder != s_byteOrder) return false;
+        if (!Get(is, settings) || !Get(is, header) || !Get(is, lastLine)) return false;
+        uint64_t counters[8];
+        if (!is.read(reinterpret_cast<char*>(counters), sizeof(counters))) return false;
+        position = counters[0];
+        lines = counters[1];
+        malformed = counters[2];
+        inBand = counters[3];
+        energyPassed = counters[4];
+        written = counters[5];
+        outputSize = counters[6];
+        if (counters[7] > s_maxItems) return false;
+        bands.assign(counters[7], Band());
+        for (size_t b=0; b<bands.size(); ++b)
+        {
+            Band& band = bands[b];
+            if (!Get(is, band.setIndex) || !Get(is, band.segment)) return false;
+            if (windows && (!Get(is, band.windowBase) || !Get(is, band.windowNext))) return false;
+            if (!Get(is, band.nreal) || !Get(is, band.nfake) ||
+                !Get(is, band.nrealOutOfRange) || !Get(is, band.nfakeOutOfRange) ||
+                !Get(is, band.hourAngle) || !Get(is, band.dec) || !Get(is, band.sidereal)) return false;
+        }
+        return true;
+    }
+
+protected:
+    template <typename T>
+    static void Put(std::ostream& os, const T& value) { os.write(reinterpret_cast<const char*>(&value), sizeof(value)); }
+
+    static void Put(std::ostream& os, const std::string& value)
+    {
+        Put(os, (uint64_t)value.size());
+        os.write(value.data(), value.size());
+    }
+
+    template <typename T>
+    static void Put(std::ostream& os, const std::vector<T>& values)
+    {
+        Put(os, (uint64_t)values.size());
+        os.write(reinterpret_cast<const char*>(values.data()), values.size()*sizeof(T));
+    }
+
+    template <typename T>
+    static bool Get(std::istream& is, T& value) { return (bool)is.read(reinterpret_cast<char*>(&value), sizeof(value)); }
+
+    static bool Get(std::istream& is, std::string& value)
+    {
+        uint64_t n;
+        if (!Get(is, n) || n > s_maxItems) return false;
+        value.resize(n);
+        return (bool)is.read(&value[0], n);
+    }
+
+    template <typename T>
+    static bool Get(std::istream& is, std::vector<T>& values)
+    {
+        uint64_t n;
+        if (!Get(is, n) || n > s_maxItems) return false;
+        values.resize(n);
+        return (bool)is.read(reinterpret_cast<char*>(values.data()), n*sizeof(T));
+    }
+
+    static constexpr char s_magic[8] = {'K', 'C', 'D', 'C', 'C', 'K', 'P', '2'};
+    static constexpr char s_magicVersion1[8] = {'K', 'C', 'D', 'C', 'C', 'K', 'P', '1'};
+    static constexpr uint32_t s_byteOrder = 0x01020304;
+    static constexpr uint64_t s_maxItems = 1ull << 32;     ///< sanity limit for lengths read from a file
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcCheckpoint_h_
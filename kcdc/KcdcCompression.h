@@ -0,0 +1,717 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcCompression.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Streaming gzip / zstd decompression of inputs and compression of outputs
+///
+///  @details gzip (zlib) and, with -DCSI_KCDC_ZSTD, zstd streams run on threads of their own.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcCompression_h_
+#define _Csi_KcdcCompression_h_
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#if defined(CSI_KCDC_ZSTD)
+#include <zstd.h>
+#endif
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+enum Compression
+{
+    COMPRESSION_NONE = 0,
+    COMPRESSION_GZIP,
+    COMPRESSION_ZSTD
+};
+
+///@brief True if zstd support is compiled in
+inline bool IsZstdAvailable()
+{
+#if defined(CSI_KCDC_ZSTD)
+    return true;
+#else
+    return false;
+#endif
+}
+
+///@brief Compression of a file from its first bytes (gzip or zstd magic number)
+inline Compression GetCompressionFromMagic(const unsigned char* data, size_t size)
+{
+    if (size >= 2 && data[0]==0x1f && data[1]==0x8b) return COMPRESSION_GZIP;
+    if (size >= 4 && data[0]==0x28 && data[1]==0xb5 && data[2]==0x2f && data[3]==0xfd) return COMPRESSION_ZSTD;
+    return COMPRESSION_NONE;
+}
+
+///@brief Compression of a file from its name: .gz or .zst
+inline Compression GetCompressionFromName(const std::string& fname)
+{
+    size_t n = fname.size();
+    if (n > 3 && fname.compare(n-3, 3, ".gz") == 0) return COMPRESSION_GZIP;
+    if (n > 4 && fname.compare(n-4, 4, ".zst") == 0) return COMPRESSION_ZSTD;
+    return COMPRESSION_NONE;
+}
+
+///@brief Bounded queue of data blocks between one producer and one consumer thread
+class KcdcBlockPipe
+{
+public:
+    static const size_t s_alignment = 4096;
+
+    explicit KcdcBlockPipe(size_t blocks=4, size_t blockSize=4<<20)
+    : m_blocks(blocks), m_data(blocks, 0), m_sizes(blocks, 0), m_blockSize(blockSize), m_written(0), m_read(0),
+      m_writeClosed(false), m_readClosed(false), m_writeStalls(0), m_writeWaitNs(0)
+    {
+        for (size_t i=0; i<blocks; ++i)
+        {
+            m_blocks[i].resize(blockSize + s_alignment);
+            const uintptr_t p = reinterpret_cast<uintptr_t>(m_blocks[i].data());
+            m_data[i] = m_blocks[i].data() + (s_alignment - p%s_alignment)%s_alignment;
+        }
+    }
+
+    size_t GetBlockSize() const { return m_blockSize; }
+
+    ///@brief Wait for a free block to fill
+    ///@return 0 if the reader closed the pipe
+    char* BeginWrite()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto ready = [&]() { return m_written - m_read < m_blocks.size() || m_readClosed; };
+        if (!ready())
+        {
+            // back pressure: every block is still waiting for the reader
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            m_changed.wait(lock, ready);
+            ++m_writeStalls;
+            m_writeWaitNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+        if (m_readClosed) return 0;
+        return m_data[m_written % m_blocks.size()];
+    }
+
+    ///@brief Number of BeginWrite calls that had to wait for the reader
+    uint64_t GetWriteStalls()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_writeStalls;
+    }
+
+    ///@brief Nanoseconds BeginWrite waited for the reader
+    uint64_t GetWriteWaitTime()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_writeWaitNs;
+    }
+
+    ///@brief Wait until the reader has taken back every block written
+    ///@return false if the reader closed the pipe
+    bool WaitEmpty()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_changed.wait(lock, [&]() { return m_read == m_written || m_readClosed; });
+        return !m_readClosed;
+    }
+
+    ///@brief Hand the block from BeginWrite, holding size bytes, to the reader
+    void EndWrite(size_t size)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_sizes[m_written % m_blocks.size()] = size;
+            ++m_written;
+        }
+        m_changed.notify_all();
+    }
+
+    ///@brief No more blocks will be written
+    void CloseWrite()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_writeClosed = true;
+        }
+        m_changed.notify_all();
+    }
+
+    ///@brief Wait for the next block
+    ///@return false at the end of the data
+    bool BeginRead(const char*& data, size_t& size)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_changed.wait(lock, [&]() { return m_read < m_written || m_writeClosed || m_readClosed; });
+        if (m_read == m_written || m_readClosed) return false;
+        data = m_data[m_read % m_blocks.size()];
+        size = m_sizes[m_read % m_blocks.size()];
+        return true;
+    }
+
+    ///@brief Return the block from BeginRead for reuse
+    void EndRead()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_read;
+        }
+        m_changed.notify_all();
+    }
+
+    ///@brief The reader stops; a waiting writer returns
+    void CloseRead()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_readClosed = true;
+        }
+        m_changed.notify_all();
+    }
+
+protected:
+    std::vector<std::vector<char> > m_blocks;
+    std::vector<char*> m_data;          ///< aligned start of each block
+    std::vector<size_t> m_sizes;
+    size_t m_blockSize;
+    uint64_t m_written;         ///< blocks written so far
+    uint64_t m_read;            ///< blocks read so far
+    bool m_writeClosed;
+    bool m_readClosed;
+    uint64_t m_writeStalls;
+    uint64_t m_writeWaitNs;
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+};
+
+///@brief Decompresses a gzip or zstd stream on a separate thread
+class KcdcDecompressor
+{
+public:
+    KcdcDecompressor() : m_fd(-1), m_data(0), m_size(0), m_pos(0), m_reading(false) {}
+    ~KcdcDecompressor() { Stop(); }
+
+    ///@brief Start decompressing fd, which the decompressor then owns
+    ///@return false if the compression is not supported
+    bool Start(int fd, Compression compression)
+    {
+        Stop();
+        m_error.clear();
+        if (compression == COMPRESSION_ZSTD && !IsZstdAvailable())
+        {
+            m_error = "zstd support not compiled in (build with -DCSI_KCDC_ZSTD -lzstd)";
+            close(fd);
+            return false;
+        }
+        m_fd = fd;
+        m_pipe.reset(new KcdcBlockPipe());
+        m_thread = std::thread([this, compression]()
+        {
+            if (compression == COMPRESSION_GZIP) RunGzip();
+            else RunZstd();
+            m_pipe->CloseWrite();
+        });
+        return true;
+    }
+
+    ///@brief Stop the thread and close the input
+    void Stop()
+    {
+        if (m_pipe)
+        {
+            m_pipe->CloseRead();
+            if (m_thread.joinable()) m_thread.join();
+            m_pipe.reset();
+        }
+        m_fd = -1;
+        m_data = 0;
+        m_size = m_pos = 0;
+        m_reading = false;
+    }
+
+    ///@brief Copy up to n decompressed bytes to dst
+    ///@return number of bytes, 0 at the end of the data or after an error (see GetError)
+    size_t Read(char* dst, size_t n)
+    {
+        if (!m_pipe) return 0;
+        while (m_pos == m_size)
+        {
+            if (m_reading) m_pipe->EndRead();
+            m_reading = m_pipe->BeginRead(m_data, m_size);
+            m_pos = 0;
+            if (!m_reading)
+            {
+                m_size = 0;
+                return 0;
+            }
+        }
+        size_t len = m_size - m_pos < n ? m_size - m_pos : n;
+        memcpy(dst, m_data + m_pos, len);
+        m_pos += len;
+        return len;
+    }
+
+    ///@brief Description of a decompression error; empty if there was none
+    std::string GetError() const { return m_error; }
+
+protected:
+    void RunGzip()
+    {
+        gzFile gz = gzdopen(m_fd, "rb");
+        if (!gz)
+        {
+            close(m_fd);
+            m_error = "cannot open gzip stream";
+            return;
+        }
+        gzbuffer(gz, 1 << 20);
+        while (char* block = m_pipe->BeginWrite())
+        {
+            int n = gzread(gz, block, m_pipe->GetBlockSize());
+            int err(Z_OK);
+            const char* msg = gzerror(gz, &err);
+            if (n < 0 || (n == 0 && err != Z_OK))   // a truncated stream reads as 0 with Z_BUF_ERROR
+            {
+                m_error = std::string("gzip: ") + msg;
+                break;
+            }
+            if (n == 0) break;
+            m_pipe->EndWrite(n);
+        }
+        gzclose(gz);
+    }
+
+    void RunZstd()
+    {
+#if defined(CSI_KCDC_ZSTD)
+        ZSTD_DStream* zs = ZSTD_createDStream();
+        ZSTD_initDStream(zs);
+        std::vector<char> in(ZSTD_DStreamInSize());
+        ZSTD_inBuffer input = {in.data(), 0, 0};
+        bool eof(false), done(false);
+        size_t last(0);
+        while (!done)
+        {
+            char* block = m_pipe->BeginWrite();
+            if (!block) break;
+            ZSTD_outBuffer output = {block, m_pipe->GetBlockSize(), 0};
+            while (output.pos < output.size)
+            {
+                if (input.pos == input.size && !eof)
+                {
+                    ssize_t n;
+                    do
+                    {
+                        n = read(m_fd, in.data(), in.size());
+                    } while (n < 0 && errno == EINTR);
+                    if (n < 0)
+                    {
+                        m_error = std::string("zstd: cannot read input: ") + strerror(errno);
+                        done = true;
+                        break;
+                    }
+                    eof = n == 0;
+                    input.size = n;
+                    input.pos = 0;
+                }
+                if (eof && last == 0)
+                {
+                    done = true;
+                    break;
+                }
+                // at the end of the input the decoder may still hold output; it is done when it
+                // leaves space unused
+                last = ZSTD_decompressStream(zs, &output, &input);
+                if (ZSTD_isError(last))
+                {
+                    m_error = std::string("zstd: ") + ZSTD_getErrorName(last);
+                    done = true;
+                    break;
+                }
+                if (eof && output.pos < output.size)
+                {
+                    done = true;
+                    break;
+                }
+            }
+            if (output.pos > 0) m_pipe->EndWrite(output.pos);
+        }
+        if (done && m_error.empty() && last != 0) m_error = "zstd: truncated input";
+        ZSTD_freeDStream(zs);
+#endif
+        close(m_fd);
+    }
+
+    int m_fd;
+    std::unique_ptr<KcdcBlockPipe> m_pipe;
+    std::thread m_thread;
+    const char* m_data;         ///< current block
+    size_t m_size;
+    size_t m_pos;
+    bool m_reading;             ///< m_data is held from BeginRead
+    std::string m_error;        ///< written by the thread before it closes the pipe
+};
+
+///@brief Output file, gzip or zstd compressed on a separate thread if its name ends in .gz or .zst
+class KcdcOutputFile
+{
+public:
+    KcdcOutputFile() : m_compression(COMPRESSION_NONE), m_fd(-1), m_block(0), m_used(0), m_size(0), m_offset(0), m_ok(true),
+                       m_direct(false), m_stalls(0), m_waitNs(0), m_ioNs(0) {}
+    ~KcdcOutputFile() { Close(); }
+
+    ///@brief Write uncompressed output with O_DIRECT, bypassing the page cache, where the
+    /// file system supports it (default false); set before Open
+    void SetDirectIo(bool direct) { m_direct = direct; }
+
+    bool GetDirectIo() const { return m_direct; }
+
+    ///@brief Create fname
+    ///@param level Compression level; 0 selects the library default
+    ///@return false if the file cannot be created or the compression is not supported
+    bool Open(const std::string& fname, int level=0)
+    {
+        Close();
+        m_ok = true;
+        m_error.clear();
+        m_size = 0;
+        m_compression = GetCompressionFromName(fname);
+        if (m_compression == COMPRESSION_ZSTD && !IsZstdAvailable())
+        {
+            m_error = "zstd support not compiled in (build with -DCSI_KCDC_ZSTD -lzstd)";
+            return false;
+        }
+        if (m_compression == COMPRESSION_NONE) return OpenPlain(fname, O_WRONLY | O_CREAT | O_TRUNC, 0);
+        m_fd = open(fname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (m_fd < 0)
+        {
+            m_error = strerror(errno);
+            return false;
+        }
+        m_pipe.reset(new KcdcBlockPipe());
+        m_thread = std::thread([this, level]()
+        {
+            if (m_compression == COMPRESSION_GZIP) RunGzip(level);
+            else RunZstd(level);
+        });
+        return true;
+    }
+
+    ///@brief Open an uncompressed fname to continue writing after its first size bytes;
+    /// anything behind them is cut off
+    ///@return false if fname is compressed, cannot be opened or is shorter than size
+    bool OpenAppend(const std::string& fname, uint64_t size)
+    {
+        Close();
+        m_ok = true;
+        m_error.clear();
+        m_compression = GetCompressionFromName(fname);
+        if (m_compression != COMPRESSION_NONE)
+        {
+            m_error = "compressed output cannot be appended to";
+            return false;
+        }
+        struct stat st;
+        if (stat(fname.c_str(), &st) != 0 || (uint64_t)st.st_size < size || truncate(fname.c_str(), size) != 0)
+        {
+            m_error = "output is missing or shorter than expected";
+            return false;
+        }
+        m_size = size;
+        return OpenPlain(fname, O_WRONLY, size);
+    }
+
+    bool IsOpen() const { return (bool)m_pipe; }
+
+    ///@brief Bytes written (before compression), including those kept by OpenAppend
+    uint64_t GetSize() const { return m_size; }
+
+    ///@brief Hand what was written so far to the operating system and wait until it has it;
+    /// uncompressed output only
+    ///@return false if writing failed
+    bool Flush()
+    {
+        if (!m_pipe || m_compression != COMPRESSION_NONE) return true;
+        if (m_block && m_used > 0)
+        {
+            m_pipe->EndWrite(m_used);
+            m_block = 0;
+        }
+        return m_pipe->WaitEmpty();
+    }
+
+    void Write(const char* data, size_t size)
+    {
+        m_size += size;
+        if (!m_pipe) return;
+        while (size > 0)
+        {
+            if (!m_block)
+            {
+                m_block = m_pipe->BeginWrite();
+                m_used = 0;
+                if (!m_block) return;       // compressor failed
+            }
+            size_t len = m_pipe->GetBlockSize() - m_used;
+            if (len > size) len = size;
+            memcpy(m_block + m_used, data, len);
+            m_used += len;
+            data += len;
+            size -= len;
+            if (m_used == m_pipe->GetBlockSize())
+            {
+                m_pipe->EndWrite(m_used);
+                m_block = 0;
+            }
+        }
+    }
+
+    ///@brief Finish compression and close the file
+    ///@return false if anything failed to be written
+    bool Close()
+    {
+        if (m_pipe)
+        {
+            if (m_block) m_pipe->EndWrite(m_used);
+            m_block = 0;
+            m_pipe->CloseWrite();
+            m_thread.join();
+            m_stalls = m_pipe->GetWriteStalls();
+            m_waitNs = m_pipe->GetWriteWaitTime();
+            m_pipe.reset();
+            m_ok = m_ok && m_error.empty();
+        }
+        return m_ok;
+    }
+
+    ///@brief Description of a write or compression error; valid after Close
+    std::string GetError() const { return m_error; }
+
+    ///@brief Number of times Write waited for the writer thread; valid after Close
+    uint64_t GetWriteStalls() const { return m_stalls; }
+
+    ///@brief Nanoseconds Write waited for the writer thread; valid after Close
+    uint64_t GetWriteWaitTime() const { return m_waitNs; }
+
+    ///@brief Nanoseconds the writer thread spent in write calls (uncompressed output);
+    /// valid after Close
+    uint64_t GetIoTime() const { return m_ioNs; }
+
+protected:
+    ///@brief Open an uncompressed file and start the thread writing it from offset
+    bool OpenPlain(const std::string& fname, int flags, uint64_t offset)
+    {
+        m_stalls = m_waitNs = m_ioNs = 0;
+        m_fd = -1;
+#if defined(O_DIRECT)
+        if (m_direct) m_fd = open(fname.c_str(), flags | O_DIRECT, 0644);
+#endif
+        // without O_DIRECT support (EINVAL on tmpfs, for one) use the page cache
+        if (m_fd < 0) m_fd = open(fname.c_str(), flags, 0644);
+        if (m_fd < 0)
+        {
+            m_error = strerror(errno);
+            return false;
+        }
+        m_offset = offset;
+        m_pipe.reset(new KcdcBlockPipe());
+        m_thread = std::thread([this]() { RunPlain(); });
+        return true;
+    }
+
+    void RunPlain()
+    {
+        const bool direct = (fcntl(m_fd, F_GETFL) & GetDirectFlag()) != 0;
+        const bool seekable = lseek(m_fd, 0, SEEK_CUR) >= 0;     // not a pipe or terminal
+        bool directActive = direct;
+        uint64_t offset = m_offset;
+        const char* data;
+        size_t size;
+        while (m_pipe->BeginRead(data, size))
+        {
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            // O_DIRECT needs aligned offsets and sizes
+            const bool aligned = offset%KcdcBlockPipe::s_alignment == 0 && size%KcdcBlockPipe::s_alignment == 0;
+            if (direct && aligned != directActive)
+            {
+                const int flags = fcntl(m_fd, F_GETFL);
+                fcntl(m_fd, F_SETFL, aligned ? (flags | GetDirectFlag()) : (flags & ~GetDirectFlag()));
+                directActive = aligned;
+            }
+            const bool ok = seekable ? PwriteAll(data, size, offset) : WriteAll(data, size);
+            m_ioNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            if (!ok)
+            {
+                m_error = std::string("write failed: ") + strerror(errno);
+                m_pipe->EndRead();
+                m_pipe->CloseRead();
+                break;
+            }
+            offset += size;
+            m_pipe->EndRead();
+        }
+        if (close(m_fd) != 0 && m_error.empty()) m_error = "error closing output";
+    }
+
+    static int GetDirectFlag()
+    {
+#if defined(O_DIRECT)
+        return O_DIRECT;
+#else
+        return 0;
+#endif
+    }
+
+    bool PwriteAll(const char* data, size_t size, uint64_t offset)
+    {
+        while (size > 0)
+        {
+            ssize_t n = pwrite(m_fd, data, size, offset);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data += n;
+            size -= n;
+            offset += n;
+        }
+        return true;
+    }
+
+    void RunGzip(int level)
+    {
+        std::string mode = "wb";
+        if (level > 0 && level <= 9) mode += char('0' + level);
+        gzFile gz = gzdopen(m_fd, mode.c_str());
+        if (!gz)
+        {
+            close(m_fd);
+            m_error = "cannot open gzip stream";
+            m_pipe->CloseRead();
+            return;
+        }
+        gzbuffer(gz, 1 << 20);
+        const char* data;
+        size_t size;
+        while (m_pipe->BeginRead(data, size))
+        {
+            if (size > 0 && gzwrite(gz, data, size) != (int)size)
+            {
+                int err;
+                m_error = std::string("gzip: ") + gzerror(gz, &err);
+                m_pipe->EndRead();
+                m_pipe->CloseRead();
+                break;
+            }
+            m_pipe->EndRead();
+        }
+        if (gzclose(gz) != Z_OK && m_error.empty()) m_error = "gzip: error closing output";
+    }
+
+    void RunZstd(int level)
+    {
+#if defined(CSI_KCDC_ZSTD)
+        ZSTD_CCtx* zc = ZSTD_createCCtx();
+        if (level > 0) ZSTD_CCtx_setParameter(zc, ZSTD_c_compressionLevel, level);
+        std::vector<char> out(ZSTD_CStreamOutSize());
+        const char* data(0);
+        size_t size(0);
+        bool more(true);
+        while (m_error.empty())
+        {
+            more = m_pipe->BeginRead(data, size);
+            if (!more) size = 0;
+            ZSTD_inBuffer input = {data, size, 0};
+            ZSTD_EndDirective mode = more ? ZSTD_e_continue : ZSTD_e_end;
+            size_t left;
+            do
+            {
+                ZSTD_outBuffer output = {out.data(), out.size(), 0};
+                left = ZSTD_compressStream2(zc, &output, &input, mode);
+                if (ZSTD_isError(left))
+                {
+                    m_error = std::string("zstd: ") + ZSTD_getErrorName(left);
+                    break;
+                }
+                if (!WriteAll(out.data(), output.pos)) m_error = "zstd: write failed";
+            } while (m_error.empty() && (more ? input.pos < input.size : left != 0));
+            if (more) m_pipe->EndRead();
+            if (!more) break;
+        }
+        if (!m_error.empty()) m_pipe->CloseRead();
+        ZSTD_freeCCtx(zc);
+#else
+        (void)level;
+#endif
+        if (close(m_fd) != 0 && m_error.empty()) m_error = "error closing output";
+    }
+
+    bool WriteAll(const char* data, size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t n = write(m_fd, data, size);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    Compression m_compression;
+    int m_fd;
+    std::unique_ptr<KcdcBlockPipe> m_pipe;
+    std::thread m_thread;
+    char* m_block;                      ///< block being filled, from BeginWrite
+    size_t m_used;
+    uint64_t m_size;                    ///< bytes given to Write, see GetSize
+    uint64_t m_offset;                  ///< file offset uncompressed output starts at
+    bool m_ok;
+    bool m_direct;
+    uint64_t m_stalls;
+    uint64_t m_waitNs;
+    uint64_t m_ioNs;                    ///< written by the thread before it exits
+    std::string m_error;                ///< written by the thread before it exits
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcCompression_h_
@@ -0,0 +1,60 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcConstants.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Observatory and astronomical constants for KCDC data processing
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcConstants_h_
+#define _Csi_KcdcConstants_h_
+#include <cmath>
+
+namespace Csi
+{
+namespace Kcdc
+{
+namespace DataConstants
+{
+    const double KASCADE_LATITUDE = 49.0994;
+    const double KASCADE_LONGITUDE = 8.4378;
+    const double DEG2RAD = M_PI/180.0;
+    const double RAD2DEG = 180.0/M_PI;
+    const double PI_2 = M_PI*0.5;
+    const double GAL_N_POLE_RA = 192.859508;
+    const double GAL_N_POLE_DEC = 27.128336;
+    const double GAL_LON0 = 122.932;
+    /// B1950 galactic pole, used by libnova's ln_get_gal_from_equ (Meeus eq. 13.7)
+    const double GAL_N_POLE_RA_B1950 = 192.25;
+    const double GAL_N_POLE_DEC_B1950 = 27.4;
+    const double GAL_LON0_B1950 = 123.0;
+}
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcConstants_h_
@@ -38,15 +38,39 @@
 ///
 //-------------------------------------------------------------------------
 #ifndef _Csi_KcdcData_h_
+#include <chrono>
 #include <cmath>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
+#include <mutex>
 #include <sstream>
-#include <valarray>
+#include <vector>
 #include <inttypes.h>
 #include <libnova/transform.h>
 #include <stdlib.h>
+#include "KcdcCheckpoint.h"
+#include "KcdcConstants.h"
+#include "KcdcEventCache.h"
+#include "KcdcEventStore.h"
+#include "KcdcFormatter.h"
+#include "KcdcHistogram.h"
+#include "KcdcInputFile.h"
+#include "KcdcMapFile.h"
+#include "KcdcPipeline.h"
+#include "KcdcProjection.h"
+#include "KcdcRandom.h"
+#include "KcdcReader.h"
+#include "KcdcRecord.h"
+#include "KcdcRegions.h"
+#include "KcdcScrambler.h"
+#include "KcdcShard.h"
+#include "KcdcSignificance.h"
+#include "KcdcSidereal.h"
+#include "KcdcSinks.h"
+#include "KcdcStats.h"
+#include "KcdcTransform.h"
 
 
 
@@ -54,24 +78,15 @@ namespace Csi
 {
 namespace Kcdc
 {
-namespace DataConstants
-{
-    const double KASCADE_LATITUDE = 49.0994;
-    const double KASCADE_LONGITUDE = 8.4378;
-    const double DEG2RAD = M_PI/180.0;
-    const double RAD2DEG = 180.0/M_PI;
-    const double PI_2 = M_PI*0.5;
-    const double GAL_N_POLE_RA = 192.859508;
-    const double GAL_N_POLE_DEC = 27.128336;
-    const double GAL_LON0 = 122.932;
-}
 
 ///  @brief   Data processing and class for KASCADE Cosmic Ray Data Centre (KCDC) datasets
 ///           https://kcdc.ikp.kit.edu/
 class KcdcData
 {
 public:
-    KcdcData() {}
+    KcdcData() : m_threads(1), m_transformMode(TRANSFORM_LIBNOVA), m_oversampling(TimeScrambler::s_defaultOversampling), m_seed(13),
+                  m_eventSetSize(KcdcScramblerSink::s_defaultSetSize), m_slidingEventSets(false), m_lazyDecoding(false), m_progressInterval(0.0), m_segmentSize(KcdcShard::s_defaultSegmentSize),
+                  m_checkpointInterval(300.0), m_resume(false), m_mapFormat(MAP_FORMAT_TEXT) {}
 
     ///@brief Add fields to data input file
     ///
@@ -93,105 +108,319 @@ public:
     {
         using namespace std;
         using namespace Kcdc::DataConstants;
-        m_in.open(ifname.c_str(), std::ios::binary);
-        m_out.open(ofname.c_str(), std::ios::binary);
-        string s;
-        getline(m_in, s);
-        // output header line
-        m_out.precision(4);
-        m_out << fixed;
-        m_out << s
-                << setw(12) << right << "RA"
-                << setw(12) << right << "DEC"
-                << setw(12) << right << "LON"
-                << setw(12) << right << "LAT"
-                << setw(20) << right << "JDAYS"
-                << setw(12) << right << "DIST"
-                << "\n";
-        uint64_t lines(0);
+        // an event cache written by WriteEventCache is read instead of text
+        KcdcReader reader(m_in);
+        if (!reader.Open(ifname))
+        {
+            std::cout << "\nUnable to open input (" << ifname << ")\n";
+            return;
+        }
+        const bool fromCache = reader.IsCache();
+        if (!fromCache && !CanShardInput())
+        {
+            std::cout << "\nUnable to shard input (" << ifname << "), it must be an uncompressed regular file\n";
+            reader.Close();
+            return;
+        }
+        const bool checkpointing = IsCheckpointing();
+        if (checkpointing && (fromCache || GetCompressionFromName(ofname) != COMPRESSION_NONE))
+        {
+            std::cout << "\nCheckpoints need a text input and an uncompressed output\n";
+            reader.Close();
+            return;
+        }
+        const std::string inputHeader(reader.GetInputHeader());
+        if (fromCache) SetCacheShard(reader);
+        else SetInputShard();
+        std::ostringstream settings;
+        settings << "AddFields max_distance=" << std::setprecision(17) << maxDistance << " transform_mode=" << m_transformMode;
+        if (!m_regions.IsEmpty()) settings << " regions=" << m_regions.GetChecksum();
+        KcdcCheckpoint checkpoint;
+        bool resumed(false);
+        if (checkpointing && !LoadCheckpoint(ifname, settings.str(), inputHeader, checkpoint, resumed))
+        {
+            reader.Close();
+            return;
+        }
+        if (resumed ? !m_out.OpenAppend(ofname, checkpoint.outputSize) : !m_out.Open(ofname))
+        {
+            std::cout << "\nUnable to create output (" << ofname << ") " << m_out.GetError() << "\n";
+            reader.Close();
+            return;
+        }
+        if (!resumed)
+        {
+            // output header line
+            KcdcOutputBuffer header(inputHeader.size() + 128);
+            KcdcRecordFormatter::AppendHeader(header, inputHeader, !m_regions.IsEmpty());
+            m_out.Write(header.GetData(), header.GetSize());
+        }
+        uint64_t lines(checkpoint.lines);
+        uint64_t malformed(checkpoint.malformed);
+        const uint32_t threads = GetThreadCount(m_threads);
         std::cout << "\nProcessing input (" << ifname << ") output (" << ofname << ")";
         if (maxDistance>0.0) std::cout << " using max distance (" << maxDistance << ")";
+        if (!m_regions.IsEmpty()) std::cout << " using " << m_regions.GetSize() << " sources";
+        if (threads>1) std::cout << " using " << threads << " threads";
+        if (!m_shard.IsWhole()) std::cout << " shard " << m_shard.ToString();
         std::cout << "\n";
-        //while (!m_in.eof() && !m_in.fail() && lines<100)
-        while (!m_in.eof() && !m_in.fail())
-        {
-            ++lines;
-            getline(m_in, s);
-            if (m_in.eof()) break;
-            std::istringstream iss(s);
-            // existing
-            double e(0.0), yc(0.0), xc(0.0), ze(0.0), az(0.0), ne(0.0), nmu(0.0),
-                   esumhad(0.0);
-            int64_t nhad(0);
-            double t(0.0), p(0.0);
-            uint64_t gt(0), mt(0), ymd(0), hms(0), r(0), ev(0);
-            double age(0.0);
-            // missing
-            uint64_t mmn(0);
-            // new
-            double ra(0.0), dec(0.0), lon(0.0), lat(0.0), jdays(0.0), dist(0.0);
-
-            iss>>e; iss>>yc; iss>>xc; iss>>ze; iss>>az; iss>>ne; iss>>nmu; iss>>esumhad; iss>>nhad; iss>>t; iss>>p;
-            iss>>gt; iss>>mt; iss>>ymd; iss>>hms; iss>>r; iss>>ev; iss>>age;
-
-            jdays = GetJulianDate(ymd, hms, mmn);    /// no mmn in data
-            ln_hrz_posn inHrzPos;
-            ln_lnlat_posn observerPos;
-            ln_equ_posn equPos;
-            inHrzPos.alt = 90.0 - ze;
-            inHrzPos.az = EnsureCorrectRange(az + 180.0);
-            observerPos.lat = KASCADE_LATITUDE;
-            observerPos.lng = KASCADE_LONGITUDE;
-            ln_get_equ_from_hrz(&inHrzPos, &observerPos, jdays, &equPos);
-            ra = Convert360To180(equPos.ra);
-            dec = equPos.dec;
-            ln_gal_posn galacticPos;
-            ln_get_gal_from_equ(&equPos, &galacticPos);
-            lat = galacticPos.b;
-            lon = galacticPos.l;
-
-             //dist = sqrt(pow((dec-40.95),2.0) + pow((ra-308.0),2.0)/pow(cos(40.95*DEG2RAD),2.0));
-            dist = sqrt(pow((dec-40.95),2.0) + pow((ra+52.0),2.0)/pow(cos(40.95*DEG2RAD),2.0));
-            if (e>=15.0 && dist<=maxDistance)
+        BeginRun("AddFields", ifname, ofname, threads);
+        m_run.SetSetting("max_distance", std::to_string(maxDistance));
+        if (!m_regions.IsEmpty()) m_run.SetSetting("sources", std::to_string(m_regions.GetSize()));
+        // a catalog selects by its sources alone unless a max distance is given
+        const double distanceLimit = (!m_regions.IsEmpty() && !(maxDistance > 0.0)) ? std::numeric_limits<double>::infinity() : maxDistance;
+        KcdcFieldsSink fields(m_out, distanceLimit, m_regions);
+        fields.SetCounts(checkpoint.energyPassed, checkpoint.written);
+        ConfigureReader(reader);
+        reader.AddEnergyRange(s_minEnergy, std::numeric_limits<double>::infinity());
+        reader.SetGalacticMaxDistance(distanceLimit);
+        reader.AddSink(fields);
+        uint64_t position = m_in.GetPosition();     // input offset after the last batch written
+        std::string lastLine(checkpoint.lastLine);
+        reader.Scan([&](const KcdcRecordBatch& batch, KcdcStageTimes& times)
             {
-                m_out   //<< s
-                        << setw(11) << right << e
-                        << setw(12) << right << yc
-                        << setw(12) << right << xc
-                        << setw(12) << right << ze
-                        << setw(12) << right << az
-                        << setw(12) << right << ne
-                        << setw(12) << right << nmu
-                        << setw(12) << right << esumhad
-                        << setw(12) << right << nhad
-                        << setw(12) << right << t
-                        << setw(12) << right << p
-                        << setw(12) << right << gt
-                        << setw(12) << right << mt
-                        << setw(12) << right << ymd
-                        << setw(12) << right << hms
-                        << setw(12) << right << r
-                        << setw(12) << right << ev
-                        << setw(12) << right << age
-
-                        << setw(13) << right << ra
-                        << setw(12) << right << dec
-                        << setw(12) << right << lon
-                        << setw(12) << right << lat
-                        << setw(20) << right << setprecision(6) <<  jdays << setprecision(4)
-                        << setw(12) << right << dist
-                        << "\n";
-            }
+                ReportBatch(reader, batch, times, lines, malformed);
+                if (checkpointing && batch.count > 0)
+                {
+                    position = batch.offset + batch.lines.size();
+                    lastLine = GetLastLine(batch.lines);
+                    if (IsCheckpointDue())
+                    {
+                        m_out.Flush();
+                        SaveFieldsCheckpoint(settings.str(), inputHeader, lastLine, position, lines, malformed,
+                                             fields.GetEnergyPassed(), fields.GetWritten());
+                    }
+                }
+            });
+        ReportInputError();
+        reader.Close();
+        const bool outputOk = m_out.Close();
+        if (!outputOk) std::cout << "\nError writing output (" << ofname << ") " << m_out.GetError() << "\n";
+        // the final checkpoint continues the run when the input grows
+        if (checkpointing && outputOk)
+        {
+            SaveFieldsCheckpoint(settings.str(), inputHeader, lastLine, position, lines, malformed,
+                                 fields.GetEnergyPassed(), fields.GetWritten());
+        }
+        ReportMalformedTotal(malformed);
+        m_run.SetMalformed(malformed);
+        m_run.SetCounter("energy_passed", fields.GetEnergyPassed());
+        m_run.SetCounter("written", fields.GetWritten());
+        m_run.SetCounter("output_stalls", m_out.GetWriteStalls());
+        m_run.SetCounter("output_wait_us", m_out.GetWriteWaitTime()/1000);
+        m_run.SetCounter("output_io_us", m_out.GetIoTime()/1000);
+        EndRun();
+        std::cout << "\nComplete!\n";
+    }
 
-            if ((lines%1000000)==0) std::cout << " " << lines <<" records processed\n";
-            else if ((lines%50000)==0) std::cout << "." << std::flush;
+    ///@brief Convert a KCDC input file into an event cache
+    ///@param ifname The input file name, KCDC text format as described for AddFields
+    ///@param ofname The event cache file name
+    void WriteEventCache(const std::string& ifname, const std::string& ofname)
+    {
+        using namespace std;
+        KcdcReader reader(m_in);
+        if (!reader.Open(ifname))
+        {
+            std::cout << "\nUnable to open input (" << ifname << ")\n";
+            return;
+        }
+        KcdcEventCacheWriter writer;
+        if (!writer.Open(ofname, reader.GetInputHeader()))
+        {
+            std::cout << "\nUnable to create event cache (" << ofname << ")\n";
+            reader.Close();
+            return;
+        }
+        uint64_t lines(0);
+        uint64_t malformed(0);
+        const uint32_t threads = GetThreadCount(m_threads);
+        std::cout << "\nConverting input (" << ifname << ") to event cache (" << ofname << ")";
+        if (threads>1) std::cout << " using " << threads << " threads";
+        std::cout << "\n";
+        BeginRun("WriteEventCache", ifname, ofname, threads);
+        KcdcEventCacheSink sink(writer);
+        ConfigureReader(reader);
+        reader.AddSink(sink);
+        reader.Scan([&](const KcdcRecordBatch& batch, KcdcStageTimes& times) { ReportBatch(reader, batch, times, lines, malformed); });
+        ReportInputError();
+        reader.Close();
+        if (!writer.Close()) std::cout << "\nError writing event cache (" << ofname << ")\n";
+        ReportMalformedTotal(malformed);
+        m_run.SetMalformed(malformed);
+        m_run.SetCounter("written", writer.GetRows());
+        EndRun();
+        std::cout << "\n" << writer.GetRows() << " records written\nComplete!\n";
+    }
 
+    ///@brief Load a dataset into an in memory event store for ad hoc selections
+    ///@param ifname The input file name
+    ///@param store Replaced by the records of the input
+    ///@return false if the input cannot be read or a value does not fit the store
+    bool LoadEventStore(const std::string& ifname, KcdcEventStore& store)
+    {
+        using namespace std;
+        store.Clear();
+        KcdcReader reader(m_in);
+        if (!reader.Open(ifname))
+        {
+            std::cout << "\nUnable to open input (" << ifname << ")\n";
+            return false;
         }
-        m_in.close();
-        m_out.close();
-        std::cout << "\nComplete!\n";
+        const uint32_t threads = GetThreadCount(m_threads);
+        std::cout << "\nLoading input (" << ifname << ") into an event store";
+        if (threads>1) std::cout << " using " << threads << " threads";
+        std::cout << "\n";
+        store.SetInputHeader(reader.GetInputHeader());
+        if (reader.IsCache()) store.Reserve(reader.GetCache().GetRows());
+        uint64_t lines(0);
+        uint64_t malformed(0);
+        BeginRun("LoadEventStore", ifname, "", threads);
+        KcdcEventStoreSink sink(store);
+        ConfigureReader(reader);
+        reader.AddSink(sink);
+        reader.Scan([&](const KcdcRecordBatch& batch, KcdcStageTimes& times)
+            {
+                ReportBatch(reader, batch, times, lines, malformed);
+                if (!sink.IsOk()) reader.Stop();
+            });
+        ReportInputError();
+        const bool ok = sink.IsOk() && m_in.GetError().empty();
+        reader.Close();
+        store.ShrinkToFit();
+        ReportMalformedTotal(malformed);
+        m_run.SetMalformed(malformed);
+        m_run.SetCounter("loaded", store.GetRows());
+        m_run.SetCounter("store_bytes", store.GetMemorySize());
+        EndRun();
+        if (!store.GetError().empty()) std::cout << "\nError loading input (" << ifname << ") " << store.GetError() << "\n";
+        if (!ok) return false;
+        std::cout << "\n" << store.GetRows() << " records loaded (" << store.GetMemorySize()/(1 << 20) << " MB)\nComplete!\n";
+        return true;
+    }
+
+    ///@brief Set the number of threads that read the input (KcdcReader) and make the
+    /// ProcessEventStats fake events; 0 uses one per hardware thread
+    void SetThreads(uint32_t threads) { m_threads = threads; }
+
+    ///@brief Get the number of threads set by SetThreads
+    uint32_t GetThreads() const { return m_threads; }
+
+    ///@brief Select how AddFields and the ProcessEventStats real events are transformed
+    /// (TRANSFORM_LIBNOVA and TRANSFORM_CACHED agree with libnova to about 1e-11 degrees, TRANSFORM_BATCH to
+    /// better than 1e-9, so a printed value can differ in its last digit at a rounding boundary)
+    void SetTransformMode(TransformMode mode) { m_transformMode = mode; }
+
+    ///@brief Get the mode set by SetTransformMode
+    TransformMode GetTransformMode() const { return m_transformMode; }
+
+    ///@brief Set the number of fake events ProcessEventStats generates per real event (default 20)
+    void SetOversampling(uint32_t oversampling) { m_oversampling = oversampling; }
+
+    ///@brief Get the factor set by SetOversampling
+    uint32_t GetOversampling() const { return m_oversampling; }
+
+    ///@brief Set the seed of the ProcessEventStats fake event draws (default 13)
+    void SetSeed(uint64_t seed) { m_seed = seed; }
+
+    ///@brief Get the seed set by SetSeed
+    uint64_t GetSeed() const { return m_seed; }
+
+    ///@brief Set the number of real events ProcessEventStats draws the fake event times from
+    /// (default KcdcScramblerSink::s_defaultSetSize, 100000)
+    void SetEventSetSize(uint64_t events, bool sliding=false)
+    {
+        m_eventSetSize = events > 0 ? events : 1;
+        m_slidingEventSets = sliding;
     }
 
+    ///@brief Get the size set by SetEventSetSize
+    uint64_t GetEventSetSize() const { return m_eventSetSize; }
+
+    ///@brief Check whether SetEventSetSize selected sliding sets
+    bool IsSlidingEventSets() const { return m_slidingEventSets; }
+
+    ///@brief Decode E first and the rest of a line only if the record can pass the energy cut
+    void SetLazyDecoding(bool lazy) { m_lazyDecoding = lazy; }
+
+    ///@brief Get the setting of SetLazyDecoding
+    bool GetLazyDecoding() const { return m_lazyDecoding; }
+
+    ///@brief Print a throughput line every seconds instead of the progress dots; 0 (the default)
+    /// prints the dots
+    void SetProgressInterval(double seconds) { m_progressInterval = seconds; }
+
+    ///@brief Get the interval set by SetProgressInterval
+    double GetProgressInterval() const { return m_progressInterval; }
+
+    ///@brief Write a JSON summary of each AddFields, WriteEventCache and ProcessEventStats run
+    /// to fname (overwritten by every run); empty (the default) for none
+    void SetStatsFile(const std::string& fname) { m_statsFile = fname; }
+
+    ///@brief Get the file name set by SetStatsFile
+    std::string GetStatsFile() const { return m_statsFile; }
+
+    ///@brief Counters and stage times of the last run
+    const KcdcRunStats& GetRunStats() const { return m_run; }
+
+    ///@brief Process only shard.index of shard.count of the input in AddFields and
+    /// ProcessEventStats; the default 0 of 1 is the whole input
+    void SetShard(const KcdcShard& shard) { m_shard = shard; }
+
+    ///@brief Get the shard set by SetShard
+    KcdcShard GetShard() const { return m_shard; }
+
+    ///@brief Set the segment size in bytes that shards and ProcessEventStats event sets are
+    /// made of (default KcdcShard::s_defaultSegmentSize, 1 GiB)
+    void SetSegmentSize(uint64_t bytes) { m_segmentSize = bytes > 0 ? bytes : 1; }
+
+    ///@brief Get the size set by SetSegmentSize
+    uint64_t GetSegmentSize() const { return m_segmentSize; }
+
+    ///@brief Write uncompressed AddFields output with O_DIRECT where the file system
+    /// supports it, so it does not fill the page cache (default false)
+    void SetDirectOutput(bool direct) { m_out.SetDirectIo(direct); }
+
+    ///@brief Get the setting of SetDirectOutput
+    bool GetDirectOutput() const { return m_out.GetDirectIo(); }
+
+    ///@brief Save the state of AddFields and ProcessEventStats runs to fname (KcdcCheckpoint)
+    /// every GetCheckpointInterval() seconds and at the end of the run; empty (the default)
+    /// for none
+    void SetCheckpointFile(const std::string& fname) { m_checkpointFile = fname; }
+
+    ///@brief Get the file name set by SetCheckpointFile
+    std::string GetCheckpointFile() const { return m_checkpointFile; }
+
+    ///@brief Set the seconds between checkpoints (default 300)
+    void SetCheckpointInterval(double seconds) { m_checkpointInterval = seconds; }
+
+    ///@brief Get the interval set by SetCheckpointInterval
+    double GetCheckpointInterval() const { return m_checkpointInterval; }
+
+    ///@brief Continue from the checkpoint file, if there is one (default false: start over)
+    void SetResume(bool resume) { m_resume = resume; }
+
+    ///@brief Get the setting of SetResume
+    bool GetResume() const { return m_resume; }
+
+    ///@brief Select the AddFields output by a catalog of sources instead of the single
+    /// region of DIST; an empty catalog (the default) selects by DIST only
+    void SetRegionCatalog(const KcdcRegionCatalog& catalog)
+    {
+        m_regions = catalog;
+        m_regions.Build();
+    }
+
+    ///@brief Get the catalog set by SetRegionCatalog
+    const KcdcRegionCatalog& GetRegionCatalog() const { return m_regions; }
+
+    ///@brief Set the file format of the ProcessEventStats and MergeEventStats maps
+    void SetMapFormat(MapFormat format) { m_mapFormat = format; }
+
+    ///@brief Get the format set by SetMapFormat
+    MapFormat GetMapFormat() const { return m_mapFormat; }
+
     struct EventInfo
     {
         EventInfo() : e(0.0), zenith(0.0), azimuth(0.0), jdate(0.0), dec(0.0), ra(0.0) {}
@@ -204,199 +433,373 @@ public:
         double ra;
     };
 
+    ///@brief Energy range ProcessEventStats makes maps for
+    struct EnergyBand
+    {
+        EnergyBand(const std::string& name_, double emin_, double emax_) : name(name_), emin(emin_), emax(emax_) {}
+        std::string name;       ///< output file prefix: name.nreal.dat and name.nfake.dat
+        double emin;            ///< lowest E (log10 energy) included
+        double emax;            ///< highest E included
+    };
+
+    ///@brief Make the real and fake (time scrambled) event maps of the events with emin <= E <= emax
     void ProcessEventStats(const std::string& ifname, const std::string& ofname, double emin, double emax )
+    {
+        ProcessEventStats(ifname, std::vector<EnergyBand>(1, EnergyBand(ofname, emin, emax)));
+    }
+
+    ///@brief Make the maps of several energy bands in one pass over the input
+    void ProcessEventStats(const std::string& ifname, const std::vector<EnergyBand>& bands)
     {
         using namespace std;
         using namespace Kcdc::DataConstants;
-        static const double binSize = 0.5;
-        static const uint64_t eventSetSize = 100000;
-        srandom(13);
-        m_in.open(ifname.c_str(), std::ios::binary);
-        std::string tmp = ofname + std::string(".nreal.dat");
-        std::ofstream nrealFile(tmp.c_str(), std::ios::binary);
-        tmp = ofname + std::string(".nfake.dat");
-        std::ofstream nfakeFile(tmp.c_str(), std::ios::binary);
-
-        string s;
-        getline(m_in, s);
-        std::valarray<EventInfo> events(eventSetSize);
-        class Array2D
-        {
-        public:
-            Array2D(uint32_t rows, uint32_t cols, uint32_t val)
-            : m_rows(rows), m_cols(cols), m_data(val, rows*cols) {}
-            /// @brief sets all matrix elements to 0.0
-            void zeroize() {m_data = 0.0;}
-            /************* column major  *****************/
-            uint64_t& operator()(uint i,uint j) {return m_data[i*m_cols+j];}
-            /************** row major **************/
-            //double& operator()(uint i,uint j) {return m_data[i*m_cols+j];}
-        protected:
-            std::valarray<uint64_t> m_data;
-            uint32_t m_rows;
-            uint32_t m_cols;
-        };
-        Array2D nreal(360, 720, 0);
-        Array2D nfake(360, 720, 0);
+        // an event cache written by WriteEventCache is read instead of text
+        KcdcReader reader(m_in);
+        if (!reader.Open(ifname))
+        {
+            std::cout << "\nUnable to open input (" << ifname << ")\n";
+            return;
+        }
+        const bool fromCache = reader.IsCache();
+        if (!fromCache && !CanShardInput())
+        {
+            std::cout << "\nUnable to shard input (" << ifname << "), it must be an uncompressed regular file\n";
+            reader.Close();
+            return;
+        }
+        const bool checkpointing = IsCheckpointing();
+        if (checkpointing && fromCache)
+        {
+            std::cout << "\nCheckpoints need a text input\n";
+            reader.Close();
+            return;
+        }
 
-        uint64_t lines(0);
-        std::cout << "\nProcessing input (" << ifname << ") output (" << ofname << ")";
+        const std::string inputHeader(reader.GetInputHeader());
+        if (fromCache) SetCacheShard(reader);
+        else SetInputShard();
+
+        std::cout << "\nProcessing input (" << ifname << ") output (";
+        for (size_t b=0; b<bands.size(); ++b) std::cout << (b>0 ? ", " : "") << bands[b].name;
+        std::cout << ")";
+        if (!m_shard.IsWhole()) std::cout << " shard " << m_shard.ToString();
         std::cout << "\n";
 
-        uint32_t eventCount(0);              // used to count events processed 0-100000;
-
-        ln_lnlat_posn observerPos;
-        observerPos.lat = KASCADE_LATITUDE;
-        observerPos.lng = KASCADE_LONGITUDE;
-
-        //while (!m_in.eof() && !m_in.fail() && lines<5000000)
-        while (!m_in.eof() && !m_in.fail())
-        {
-            ++lines;
-            getline(m_in, s);
-            if (m_in.eof()) break;
-            std::istringstream iss(s);
-            // existing
-            double e(0.0), yc(0.0), xc(0.0), ze(0.0), az(0.0), ne(0.0), nmu(0.0),
-                   esumhad(0.0);
-            int64_t nhad(0);
-            double t(0.0), p(0.0);
-            uint64_t gt(0), mt(0), ymd(0), hms(0), r(0), ev(0);
-            double age(0.0);
-            // missing
-            uint64_t mmn(0);
-            // new
-            double ra(0.0), dec(0.0), lon(0.0), lat(0.0), jdays(0.0), dist(0.0);
-
-            iss>>e; iss>>yc; iss>>xc; iss>>ze; iss>>az; iss>>ne; iss>>nmu; iss>>esumhad; iss>>nhad; iss>>t; iss>>p;
-            iss>>gt; iss>>mt; iss>>ymd; iss>>hms; iss>>r; iss>>ev; iss>>age;
-
-            jdays = GetJulianDate(ymd, hms, mmn);    /// no mmn in data
-            ln_hrz_posn inHrzPos;
-
-            ln_equ_posn equPos;
-            inHrzPos.alt = 90.0 - ze;
-            inHrzPos.az = EnsureCorrectRange(az + 180.0);
-
-            ln_get_equ_from_hrz(&inHrzPos, &observerPos, jdays, &equPos);
-            ra = Convert360To180(equPos.ra);
-            dec = equPos.dec;
-            ln_gal_posn galacticPos;
-            ln_get_gal_from_equ(&equPos, &galacticPos);
-            lat = galacticPos.b;
-            lon = galacticPos.l;
-             if (e>=emin && e<=emax)
-            {
-                //    minra  maxra   mindec   maxdec
-                //     -180    180 -10.8794  89.9953
-
-                EventInfo ei;
-                ei.e = e;
-                ei.zenith = inHrzPos.alt;
-                ei.azimuth= inHrzPos.az;
-                ei.jdate = jdays;
-                ei.dec = dec + 90.0;   // shift to match nreal indexing bins
-                ei.ra = ra + 180.0;    // shift to match nreal indexing bins
-
-                uint32_t decIdx(ei.dec/binSize);
-                uint32_t raIdx(ei.ra/binSize);
-                if (ei.dec<0 || ei.dec>180.0) std::cout << "Illegal dec= " << ei.dec << "\n";
-                if (ei.ra<0 || ei.ra>360.0) std::cout << "Illegal ra= " << ei.ra << "\n";
-                if (decIdx>359 || raIdx>719)
-                {
-                    std::cout << "Illegal index " << decIdx << ":"<<raIdx << "\n";
-                }
+        const uint32_t threads = GetThreadCount(m_threads);
+        std::vector<EventStatsBand> state;
+        state.reserve(bands.size());
+        for (size_t b=0; b<bands.size(); ++b)
+        {
+            state.emplace_back(bands[b], m_oversampling, m_seed, threads, m_segmentSize);
+            state.back().fake.SetEventSets(m_eventSetSize, m_slidingEventSets);
+        }
+        std::ostringstream settings;
+        settings << "ProcessEventStats seed=" << m_seed << " oversampling=" << m_oversampling << std::setprecision(17);
+        // the default sets add nothing, so checkpoints of earlier runs still match
+        if (m_eventSetSize != KcdcScramblerSink::s_defaultSetSize || m_slidingEventSets)
+        {
+            settings << " event_sets=" << m_eventSetSize << (m_slidingEventSets ? ":sliding" : "");
+        }
+        for (size_t b=0; b<bands.size(); ++b) settings << " band=" << bands[b].emin << ":" << bands[b].emax;
+        KcdcCheckpoint checkpoint;
+        bool resumed(false);
+        if (checkpointing && !LoadCheckpoint(ifname, settings.str(), inputHeader, checkpoint, resumed))
+        {
+            reader.Close();
+            return;
+        }
+        if (resumed) RestoreEventStats(checkpoint, state);
+        uint64_t lines(checkpoint.lines);
+        uint64_t malformed(checkpoint.malformed);
+        std::string outputs;
+        for (size_t b=0; b<bands.size(); ++b) outputs += (b>0 ? "," : "") + bands[b].name;
+        BeginRun("ProcessEventStats", ifname, outputs, threads);
+        m_run.SetSetting("oversampling", std::to_string(m_oversampling));
+        m_run.SetSetting("seed", std::to_string(m_seed));
+        m_run.SetSetting("event_set_size", std::to_string(m_eventSetSize));
+        m_run.SetSetting("sliding_event_sets", m_slidingEventSets ? "true" : "false");
+        m_run.SetSetting("segment_size", std::to_string(m_segmentSize));
+        uint64_t inBandEvents(checkpoint.inBand);
 
-                ++nreal(decIdx, raIdx);
-                events[eventCount] = ei; 
-                ++eventCount;
-                if (eventCount == eventSetSize)
+        // events outside every band are dropped by the reader; the maps need RA DEC only
+        ConfigureReader(reader);
+        reader.SetFieldMask(s_eventStatsFields);
+        reader.SetGalacticMaxDistance(-1.0);
+        for (size_t b=0; b<state.size(); ++b)
+        {
+            reader.AddEnergyRange(bands[b].emin, bands[b].emax);
+            reader.AddSink(state[b].real);
+            reader.AddSink(state[b].fake);
+        }
+        uint64_t position = m_in.GetPosition();     // input offset after the last batch counted
+        std::string lastLine(checkpoint.lastLine);
+        reader.Scan([&](const KcdcRecordBatch& batch, KcdcStageTimes& times)
+            {
+                inBandEvents += batch.records.size();
+                ReportBatch(reader, batch, times, lines, malformed);
+                if (checkpointing && batch.count > 0)
                 {
-                    // generate 20 random events for each real event
-                    // use zenith/azimuth of one real event
-                    // use jdate from 20 other real events (selected randomly)
-                    for (uint32_t n=0; n<eventSetSize; ++n)
+                    position = batch.offset + batch.lines.size();
+                    lastLine = GetLastLine(batch.lines);
+                    if (IsCheckpointDue())
                     {
-                        EventInfo ei = events[n];
-                        for (uint64_t i=0; i<20; ++i)
-                        {
-                            uint64_t idx((double)eventSetSize*((double)random()/(double)RAND_MAX));
-                            if (idx>=eventSetSize)
-                            {
-                                std::cout << "illegal event idx :" << idx << "\n";
-                            }
-                            ei.jdate = events[idx].jdate;
-                            ln_hrz_posn inHrzPos;
-                            ln_equ_posn equPos;
-                            inHrzPos.alt = ei.zenith;
-                            inHrzPos.az = ei.azimuth;
-                            ln_get_equ_from_hrz(&inHrzPos, &observerPos, ei.jdate, &equPos);
-                            double fakeRa = Convert360To180(equPos.ra)+180.0;
-                            double fakeDec = equPos.dec + 90.0;
-                            if (fakeDec<0 || fakeDec>180.0) std::cout << "Illegal fakeDec= " << fakeDec << "\n";
-                            if (fakeRa<0 || fakeRa>360.0) std::cout << "Illegal fakeRa= " << fakeRa << "\n";
-                            uint32_t fakeDecIdx(fakeDec/binSize);
-                            uint32_t fakeRaIdx(fakeRa/binSize);
-                            if (fakeDecIdx>359 || fakeRaIdx>719)
-                            {
-                                std::cout << "Illegal index " << fakeDecIdx << ":"<<fakeRaIdx << "\n";
-                            }
-                            ++nfake(fakeDecIdx,fakeRaIdx);
-                        }
-                        eventCount = 0;
+                        SaveEventStatsCheckpoint(settings.str(), inputHeader, lastLine, position, lines, malformed, inBandEvents, state);
                     }
                 }
+            });
+        ReportInputError();
+        // the final checkpoint, with the open sets not yet scrambled, continues the run when the input grows
+        if (checkpointing) SaveEventStatsCheckpoint(settings.str(), inputHeader, lastLine, position, lines, malformed, inBandEvents, state);
+        reader.Close();
+        KcdcStageClock clock(IsTiming());
+        KcdcStageTimes times;
+        // the last set of the input (or shard) ends with its segment
+        reader.Finish(times);
+        ReportMalformedTotal(malformed);
+        std::cout << "\nComplete!\n";
+        for (size_t b=0; b<state.size(); ++b)
+        {
+            const SkyHistogram<>& nreal = state[b].real.GetMap();
+            const SkyHistogram<>& nfake = state[b].fake.GetMap();
+            if (nreal.GetOutOfRange() > 0 || nfake.GetOutOfRange() > 0)
+            {
+                std::cout << state[b].band.name << ": events outside the map put into the edge bins: "
+                          << nreal.GetOutOfRange() << " real, " << nfake.GetOutOfRange() << " fake\n";
             }
+        }
+        std::cout << "Outputting matrices ...";
+        clock.Start();
+        for (size_t b=0; b<state.size(); ++b)
+        {
+            const EventStatsBand& band = state[b];
+            KcdcMapFile map;
+            map.name = band.band.name;
+            map.emin = band.band.emin;
+            map.emax = band.band.emax;
+            map.oversampling = m_oversampling;
+            map.kind = KcdcMapFile::KIND_REAL;
+            map.SetMap(band.real.GetMap());
+            WriteMap(map);
+            map.kind = KcdcMapFile::KIND_FAKE;
+            map.SetMap(band.fake.GetMap());
+            WriteMap(map);
+        }
+        clock.Lap(times, STAGE_WRITE);
+        if (clock.IsEnabled()) m_run.AddTimes(times);
+        m_run.SetMalformed(malformed);
+        m_run.SetCounter("in_band", inBandEvents);
+        for (size_t b=0; b<state.size(); ++b)
+        {
+            const EventStatsBand& band = state[b];
+            m_run.SetCounter(band.band.name + ".real", band.real.GetMap().GetTotal());
+            m_run.SetCounter(band.band.name + ".fake", band.fake.GetMap().GetTotal());
+            m_run.SetCounter(band.band.name + ".real_out_of_range", band.real.GetMap().GetOutOfRange());
+            m_run.SetCounter(band.band.name + ".fake_out_of_range", band.fake.GetMap().GetOutOfRange());
+        }
+        EndRun();
+        std::cout << "\nComplete!\n";
+    }
 
-            if ((lines%1000000)==0) std::cout << " " << lines <<" records processed\n";
-            else if ((lines%50000)==0) std::cout << "." << std::flush;
+    ///@brief Join the AddFields outputs of the shards of an input, given in shard order
+    ///@return false if a part cannot be read or has another header, or ofname cannot be written
+    bool MergeFields(const std::vector<std::string>& ifnames, const std::string& ofname)
+    {
+        if (!m_out.Open(ofname))
+        {
+            std::cout << "\nUnable to create output (" << ofname << ") " << m_out.GetError() << "\n";
+            return false;
+        }
+        std::cout << "\nMerging " << ifnames.size() << " parts into (" << ofname << ")\n";
+        std::string header;
+        bool ok(true);
+        for (size_t i=0; i<ifnames.size() && ok; ++i)
+        {
+            if (!m_in.Open(ifnames[i]))
+            {
+                std::cout << "\nUnable to open input (" << ifnames[i] << ")\n";
+                ok = false;
+                break;
+            }
+            std::string_view s;
+            if (!m_in.GetLine(s)) s = std::string_view();
+            if (i == 0)
+            {
+                header.assign(s.data(), s.size());
+                m_out.Write(header.data(), header.size());
+                m_out.Write("\n", 1);
+            }
+            else if (s != header)
+            {
+                std::cout << "\nHeader of (" << ifnames[i] << ") differs from (" << ifnames[0] << ")\n";
+                ok = false;
+            }
+            bool newline(true);
+            while (ok && m_in.GetChunk(s_chunkSize, s))
+            {
+                m_out.Write(s.data(), s.size());
+                newline = s.back() == '\n';
+            }
+            if (!newline) m_out.Write("\n", 1);
+            if (!m_in.GetError().empty())
+            {
+                ReportInputError();
+                ok = false;
+            }
+            m_in.Close();
+        }
+        if (!m_out.Close())
+        {
+            std::cout << "\nError writing output (" << ofname << ") " << m_out.GetError() << "\n";
+            ok = false;
+        }
+        if (ok) std::cout << "\nComplete!\n";
+        return ok;
+    }
 
+    ///@brief Add up the ProcessEventStats maps of the shards of an input
+    ///@return false if a map cannot be read or written, or the maps differ in binning or band
+    bool MergeEventStats(const std::vector<std::string>& names, const std::string& oname)
+    {
+        static const KcdcMapFile::Kind kinds[] = {KcdcMapFile::KIND_REAL, KcdcMapFile::KIND_FAKE};
+        std::cout << "\nMerging " << names.size() << " parts into (" << oname << ")\n";
+        for (int k=0; k<2; ++k)
+        {
+            KcdcMapFile sum, part;
+            bool band(false);       // true once sum has the band of a binary part
+            for (size_t i=0; i<names.size(); ++i)
+            {
+                bool binary(false);
+                if (!ReadMap(names[i], kinds[k], part, binary))
+                {
+                    const MapFormat format = binary ? MAP_FORMAT_BINARY : MAP_FORMAT_TEXT;
+                    std::cout << "\nUnable to read map (" << KcdcMapFile::GetFileName(names[i], kinds[k], format) << ")\n";
+                    return false;
+                }
+                if (binary && band && (part.emin != sum.emin || part.emax != sum.emax || part.oversampling != sum.oversampling))
+                {
+                    std::cout << "\nMap of (" << names[i] << ") is of another energy band\n";
+                    return false;
+                }
+                if (i == 0) sum = part;
+                else if (!sum.Merge(part))
+                {
+                    std::cout << "\nMap of (" << names[i] << ") has another binning\n";
+                    return false;
+                }
+                if (binary && !band)
+                {
+                    sum.emin = part.emin;
+                    sum.emax = part.emax;
+                    sum.oversampling = part.oversampling;
+                    band = true;
+                }
+            }
+            sum.name = oname;
+            sum.kind = kinds[k];
+            if (!WriteMap(sum)) return false;
+            std::cout << KcdcMapFile::GetFileName(oname, kinds[k], m_mapFormat) << ": " << sum.GetTotal() << " events\n";
         }
-        m_in.close();
         std::cout << "\nComplete!\n";
-        std::cout << "Outputting matrices ...";
-        // dec row, ra col
-        // upper left dec=90, ra=-180
-        for (int64_t i=359; i>=0; --i)
+        return true;
+    }
+
+    ///@brief Make excess and Li-Ma significance maps from the ProcessEventStats maps of bands
+    ///@return false if a map cannot be read or written
+    bool ProcessSignificance(const std::vector<std::string>& names, const std::vector<double>& radii)
+    {
+        const uint32_t threads = GetThreadCount(m_threads);
+        std::cout << "\nSignificance maps of " << names.size() << " bands for " << radii.size() << " radii";
+        if (threads>1) std::cout << " using " << threads << " threads";
+        std::cout << "\n";
+        for (size_t b=0; b<names.size(); ++b)
         {
-            for(uint32_t j=0; j<720; ++j)
+            KcdcMapFile real, fake;
+            bool binary(false);
+            for (int k=0; k<2; ++k)
             {
-                nrealFile << nreal(i,j) << " ";
-                //nfakeFile << (nfake(i,j)/20) << " ";
-                nfakeFile << (nfake(i,j)) << " ";
+                const KcdcMapFile::Kind kind = k == 0 ? KcdcMapFile::KIND_REAL : KcdcMapFile::KIND_FAKE;
+                if (!ReadMap(names[b], kind, k == 0 ? real : fake, binary))
+                {
+                    const MapFormat format = binary ? MAP_FORMAT_BINARY : MAP_FORMAT_TEXT;
+                    std::cout << "\nUnable to read map (" << KcdcMapFile::GetFileName(names[b], kind, format) << ")\n";
+                    return false;
+                }
+            }
+            const uint32_t oversampling = binary && fake.oversampling > 0 ? fake.oversampling : m_oversampling;
+            std::vector<KcdcSignificanceMap> maps;
+            if (!KcdcSignificance::Compute(real, fake, 1.0/oversampling, radii, threads, maps))
+            {
+                std::cout << "\nMaps of (" << names[b] << ") differ in binning\n";
+                return false;
+            }
+            for (size_t r=0; r<maps.size(); ++r)
+            {
+                const KcdcSignificanceMap& map = maps[r];
+                char radius[32];
+                const std::to_chars_result res = std::to_chars(radius, radius + sizeof(radius), map.radius);
+                const std::string prefix = names[b] + ".r" + std::string(radius, res.ptr);
+                static const char* suffixes[] = {".excess.dat", ".lima.dat"};
+                for (int k=0; k<2; ++k)
+                {
+                    const std::string fname = prefix + suffixes[k];
+                    std::ofstream os(fname.c_str(), std::ios::binary);
+                    map.Write(os, k == 0 ? map.excess : map.significance);
+                    if (!os)
+                    {
+                        std::cout << "\nUnable to write map (" << fname << ")\n";
+                        return false;
+                    }
+                }
+                const size_t best = map.GetMaxBin();
+                std::cout << prefix << ": max significance " << std::fixed << std::setprecision(2) << map.significance[best]
+                          << " at RA " << real.raMin + (best%map.raBins + 0.5)*real.binSize
+                          << " DEC " << real.decMin + (best/map.raBins + 0.5)*real.binSize << std::defaultfloat << "\n";
             }
-            nrealFile << "\n";
-            nfakeFile << "\n";
         }
         std::cout << "\nComplete!\n";
+        return true;
     }
 
+    ///@brief Render the ProcessEventStats maps of bands as Hammer-Aitoff all-sky images
+    ///@return false if a map cannot be read or an image written
+    bool RenderMaps(const std::vector<std::string>& names, uint32_t width=1440, uint32_t height=720)
+    {
+        static const KcdcMapFile::Kind kinds[] = {KcdcMapFile::KIND_REAL, KcdcMapFile::KIND_FAKE};
+        const uint32_t threads = GetThreadCount(m_threads);
+        KcdcSkyImage image(width, height);
+        for (size_t b=0; b<names.size(); ++b)
+        {
+            for (int k=0; k<2; ++k)
+            {
+                KcdcMapFile map;
+                bool binary(false);
+                if (!ReadMap(names[b], kinds[k], map, binary))
+                {
+                    const MapFormat format = binary ? MAP_FORMAT_BINARY : MAP_FORMAT_TEXT;
+                    std::cout << "\nUnable to read map (" << KcdcMapFile::GetFileName(names[b], kinds[k], format) << ")\n";
+                    return false;
+                }
+                image.SetMap(map.counts.data(), map.raBins, map.decBins, map.binSize, map.raMin, map.decMin, threads);
+                double min, max;
+                image.GetRange(min, max);
+                const std::string prefix = names[b] + (kinds[k] == KcdcMapFile::KIND_FAKE ? ".nfake" : ".nreal");
+                if (!image.WritePgm(prefix + ".pgm", 0.0, max) || !image.WritePfm(prefix + ".pfm"))
+                {
+                    std::cout << "\nUnable to write image (" << prefix << ".pgm)\n";
+                    return false;
+                }
+                std::cout << prefix << ".pgm: " << width << "x" << height << ", max " << max << "\n";
+            }
+        }
+        return true;
+    }
 
     ///@brief Get Julian date from input
     ///
     /// Based on or translated from golang https://github.com/soniakeys/meeus.git
     double GetJulianDate(uint64_t ymd, uint64_t hms, uint64_t mmn)
     {
-        using namespace std;
-
-        double years = floor(ymd / 10000);
-        double months = floor((ymd - years * 10000) / 100);
-        double days = (ymd - years * 10000 - months *100);
-
-        if (months <= 2) {
-            months += 12;
-            years--;
-        }
-
-        double hours = hms / 10000;
-        double minutes = (hms - hours * 10000.0) / 100.0;
-        double seconds = (double)(hms - hours * 10000.0 - minutes *100.0) + mmn*1e-9;
-
-        days += (hours + (minutes + seconds / 60.0) / 60.0) / 24.0;
-        double b = floor(years / 100.0);
-        b = 2 - b + floor(b / 4);
-
-        return floor(365.25 * floor(years + 4716.0)) + floor(306 * (months+1.0)/10.) + b + days - 1524.5;
+        return ComputeJulianDate(ymd, hms, mmn);
     }
 
     ///@brief Get GST from Julian Days
@@ -419,20 +822,10 @@ public:
     }
 
     ///@brief Ensures input is in range 0-360
-    double EnsureCorrectRange(double alpha)
-    {
-        double tmp = (int)(alpha / 360);
-        if (alpha < 0.0) tmp --;
-        tmp *= 360.0;
-        return alpha - tmp;
-    }
+    double EnsureCorrectRange(double alpha) { return Kcdc::EnsureCorrectRange(alpha); }
 
     ///@brief Convert from 360 degrees to +/-180
-    double Convert360To180(double alpha)
-    {
-        if(alpha >= 180.)return alpha - 360.;
-        return alpha;
-    }
+    double Convert360To180(double alpha) { return Kcdc::Convert360To180(alpha); }
 
     ///@brief Apply Hammer projection to input ra and dec
     void ProjectHammerAitoff(double &ra, double &dec)
@@ -444,8 +837,363 @@ public:
     }
 
 protected:
-    std::ofstream m_out;
-    std::ifstream m_in;
+    ///@brief Print a diagnostic for a record that could not be parsed
+    void ReportMalformed(uint64_t lines, KcdcRecordParser::Status status, uint32_t field, uint64_t& malformed)
+    {
+        static const uint64_t maxReported = 10;
+        ++malformed;
+        if (malformed <= maxReported)
+        {
+            // lines counts data records; the header is line 1 of the file
+            std::cout << "\nMalformed record at line " << lines+1 << ": " << KcdcRecordParser::GetStatusMessage(status)
+                      << " (" << GetFieldName(field) << ")";
+            if (malformed == maxReported) std::cout << ", further malformed records are only counted";
+            std::cout << "\n";
+        }
+    }
+
+    ///@brief Print a '.' every 50000 and a count every 1000000 records between before and after,
+    /// or with a progress interval, the progress line when it is due
+    ///@param bytes Input bytes read so far
+    void ReportProgress(uint64_t before, uint64_t after, uint64_t bytes)
+    {
+        m_run.SetProgress(after, bytes);
+        if (m_progressInterval > 0.0)
+        {
+            if (m_run.IsReportDue()) m_run.ReportLine(std::cout);
+            return;
+        }
+        for (uint64_t n=(before/50000+1)*50000; n<=after; n+=50000)
+        {
+            if ((n%1000000)==0) std::cout << " " << n <<" records processed\n";
+            else std::cout << "." << std::flush;
+        }
+    }
+
+    ///@brief True if stage times are collected: for progress lines or a stats file
+    bool IsTiming() const { return m_progressInterval > 0.0 || !m_statsFile.empty(); }
+
+    ///@brief Start m_run for an operation
+    void BeginRun(const std::string& operation, const std::string& ifname, const std::string& ofname, uint32_t threads)
+    {
+        static const char* modes[] = {"libnova", "batch", "cached"};
+        m_run.Begin(operation, ifname, ofname, m_progressInterval);
+        m_lastCheckpoint = std::chrono::steady_clock::now();
+        m_run.SetSetting("threads", std::to_string(threads));
+        m_run.SetSetting("transform_mode", modes[m_transformMode]);
+        m_run.SetSetting("lazy_decoding", m_lazyDecoding ? "true" : "false");
+        m_run.SetSetting("shard", m_shard.ToString());
+        m_run.SetSetting("compression", m_in.GetCompression() == COMPRESSION_GZIP ? "gzip" :
+                                        m_in.GetCompression() == COMPRESSION_ZSTD ? "zstd" : "none");
+    }
+
+    ///@brief Finish m_run: print the summary and write the stats file, if enabled
+    void EndRun()
+    {
+        m_run.End();
+        if (!IsTiming()) return;
+        m_run.Report(std::cout);
+        if (!m_statsFile.empty() && !m_run.WriteJson(m_statsFile))
+        {
+            std::cout << "\nUnable to write stats file (" << m_statsFile << ")\n";
+        }
+    }
+
+    ///@brief True if m_in can be read in shards: always for the whole input, otherwise if it
+    /// is memory mapped
+    bool CanShardInput() const { return m_shard.IsWhole() || m_in.IsMapped(); }
+
+    ///@brief Restrict m_in to the segments of m_shard; call after the header line is read
+    void SetInputShard()
+    {
+        if (m_shard.IsWhole()) return;
+        const uint64_t segments = KcdcShard::GetSegmentCount(m_in.GetSize(), m_segmentSize);
+        size_t begin = m_in.FindLineStart(m_shard.GetFirstSegment(segments)*m_segmentSize);
+        size_t end = m_in.FindLineStart(m_shard.GetEndSegment(segments)*m_segmentSize);
+        // the header line is not data, in any shard
+        if (begin < m_in.GetPosition()) begin = m_in.GetPosition();
+        if (end < begin) end = begin;
+        m_in.SetRange(begin, end);
+    }
+
+    ///@brief Rows [begin, end) of an event cache that hold the records of m_shard
+    void GetShardRows(const KcdcEventCache& cache, uint64_t& begin, uint64_t& end)
+    {
+        const uint64_t rows = cache.GetRows();
+        begin = 0;
+        end = rows;
+        if (m_shard.IsWhole() || rows == 0) return;
+        // segments without a record start do not matter; count up to the last record
+        const uint64_t segments = KcdcShard::GetSegment(cache.GetRowOffset(rows - 1), m_segmentSize) + 1;
+        begin = cache.FindRow(m_shard.GetFirstSegment(segments)*m_segmentSize);
+        end = cache.FindRow(m_shard.GetEndSegment(segments)*m_segmentSize);
+    }
+
+    ///@brief True if runs save checkpoints
+    bool IsCheckpointing() const { return !m_checkpointFile.empty(); }
+
+    ///@brief True if a checkpoint is due; reads the clock
+    bool IsCheckpointDue() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_lastCheckpoint).count() >= m_checkpointInterval;
+    }
+
+    ///@brief Last line of a chunk of whole lines, with its '\n'
+    static std::string_view GetLastLine(std::string_view lines)
+    {
+        if (lines.empty()) return lines;
+        const size_t end = lines.size() - (lines.back() == '\n');
+        const void* nl = end > 0 ? memrchr(lines.data(), '\n', end) : 0;
+        return lines.substr(nl ? static_cast<const char*>(nl) - lines.data() + 1 : 0);
+    }
+
+    ///@brief Read m_checkpointFile for a run with settings and move m_in, just past its header
+    /// line (and within its shard), to the first line after the checkpoint
+    ///@param resumed Set if the run continues from checkpoint; not if resuming is off or there
+    /// is no checkpoint yet
+    ///@return false, after printing why, if the checkpoint cannot be used
+    bool LoadCheckpoint(const std::string& ifname, const std::string& settings, const std::string& header,
+                        KcdcCheckpoint& checkpoint, bool& resumed)
+    {
+        resumed = false;
+        if (!m_resume || !KcdcCheckpoint::Exists(m_checkpointFile)) return true;
+        if (!checkpoint.Read(m_checkpointFile))
+        {
+            std::cout << "\nUnable to read checkpoint (" << m_checkpointFile << ")\n";
+            return false;
+        }
+        std::ostringstream expected;
+        expected << settings << " shard=" << m_shard.ToString() << " segment_size=" << m_segmentSize;
+        if (checkpoint.settings != expected.str())
+        {
+            std::cout << "\nCheckpoint (" << m_checkpointFile << ") is of another run: " << checkpoint.settings << "\n";
+            return false;
+        }
+        // the line before the checkpoint must still be there
+        std::string_view line;
+        const uint64_t lineStart = checkpoint.position - checkpoint.lastLine.size();
+        std::string_view expectedLine(checkpoint.lastLine);
+        if (!expectedLine.empty() && expectedLine.back() == '\n') expectedLine.remove_suffix(1);
+        bool match = (checkpoint.header == header);
+        if (match && checkpoint.lastLine.empty()) match = m_in.SkipTo(checkpoint.position);
+        else if (match) match = m_in.SkipTo(lineStart) && m_in.GetLine(line) && line == expectedLine &&
+                                m_in.GetPosition() == checkpoint.position;
+        if (!match)
+        {
+            std::cout << "\nInput (" << ifname << ") does not have the lines of checkpoint (" << m_checkpointFile << ")\n";
+            return false;
+        }
+        std::cout << "\nResuming from checkpoint (" << m_checkpointFile << ") after " << checkpoint.lines << " records\n";
+        resumed = true;
+        return true;
+    }
+
+    ///@brief Fill the common part of a checkpoint
+    void SetCheckpoint(KcdcCheckpoint& checkpoint, const std::string& settings, const std::string& header,
+                       std::string_view lastLine, uint64_t position, uint64_t lines, uint64_t malformed)
+    {
+        std::ostringstream full;
+        full << settings << " shard=" << m_shard.ToString() << " segment_size=" << m_segmentSize;
+        checkpoint.settings = full.str();
+        checkpoint.header = header;
+        checkpoint.lastLine.assign(lastLine.data(), lastLine.size());
+        checkpoint.position = position;
+        checkpoint.lines = lines;
+        checkpoint.malformed = malformed;
+    }
+
+    ///@brief Write a checkpoint to m_checkpointFile and restart the checkpoint clock
+    void WriteCheckpoint(const KcdcCheckpoint& checkpoint)
+    {
+        if (!checkpoint.Write(m_checkpointFile)) std::cout << "\nUnable to write checkpoint (" << m_checkpointFile << ")\n";
+        m_lastCheckpoint = std::chrono::steady_clock::now();
+    }
+
+    ///@brief Save the AddFields state after the lines before position; m_out must be flushed
+    void SaveFieldsCheckpoint(const std::string& settings, const std::string& header, std::string_view lastLine,
+                              uint64_t position, uint64_t lines, uint64_t malformed, uint64_t energyPassed, uint64_t written)
+    {
+        KcdcCheckpoint checkpoint;
+        SetCheckpoint(checkpoint, settings, header, lastLine, position, lines, malformed);
+        checkpoint.energyPassed = energyPassed;
+        checkpoint.written = written;
+        checkpoint.outputSize = m_out.GetSize();
+        WriteCheckpoint(checkpoint);
+    }
+
+    /// @brief Real and fake event maps of one ProcessEventStats energy band
+    struct EventStatsBand
+    {
+        EventStatsBand(const EnergyBand& band_, uint32_t oversampling, uint64_t seed, uint32_t threads, uint64_t segmentSize)
+        : band(band_), real(band_.emin, band_.emax, s_binSize), fake(band_.emin, band_.emax, oversampling, seed, threads, segmentSize, s_binSize) {}
+        EnergyBand band;
+        KcdcSkyMapSink real;
+        KcdcScramblerSink fake;
+    };
+
+    ///@brief Save the ProcessEventStats state after the lines before position
+    void SaveEventStatsCheckpoint(const std::string& settings, const std::string& header, std::string_view lastLine,
+                                  uint64_t position, uint64_t lines, uint64_t malformed, uint64_t inBand,
+                                  const std::vector<EventStatsBand>& state)
+    {
+        KcdcCheckpoint checkpoint;
+        SetCheckpoint(checkpoint, settings, header, lastLine, position, lines, malformed);
+        checkpoint.inBand = inBand;
+        checkpoint.bands.resize(state.size());
+        for (size_t b=0; b<state.size(); ++b)
+        {
+            const EventStatsBand& band = state[b];
+            KcdcCheckpoint::Band& saved = checkpoint.bands[b];
+            saved.setIndex = band.fake.GetSetIndex();
+            saved.segment = band.fake.GetSegment();
+            saved.windowBase = band.fake.GetWindowBase();
+            saved.windowNext = band.fake.GetWindowNext();
+            const SkyHistogram<>& nreal = band.real.GetMap();
+            const size_t bins = (size_t)nreal.GetRaBins()*nreal.GetDecBins();
+            saved.nreal.assign(nreal.GetData(), nreal.GetData() + bins);
+            saved.nrealOutOfRange = nreal.GetOutOfRange();
+            // the fake maps of the threads are added up
+            SkyHistogram<> nfake;
+            band.fake.GetCurrentMap(nfake);
+            saved.nfake.assign(nfake.GetData(), nfake.GetData() + bins);
+            saved.nfakeOutOfRange = nfake.GetOutOfRange();
+            const TimeScrambler& scrambler = band.fake.GetScrambler();
+            const size_t n = scrambler.GetSize();
+            saved.hourAngle.resize(n);
+            saved.dec.resize(n);
+            saved.sidereal.resize(n);
+            for (size_t i=0; i<n; ++i) scrambler.GetEvent(i, saved.hourAngle[i], saved.dec[i], saved.sidereal[i]);
+        }
+        WriteCheckpoint(checkpoint);
+    }
+
+    ///@brief Put the maps and open event sets of a checkpoint into state
+    void RestoreEventStats(const KcdcCheckpoint& checkpoint, std::vector<EventStatsBand>& state)
+    {
+        for (size_t b=0; b<state.size() && b<checkpoint.bands.size(); ++b)
+        {
+            EventStatsBand& band = state[b];
+            const KcdcCheckpoint::Band& saved = checkpoint.bands[b];
+            band.real.GetMap().Assign(saved.nreal, saved.nrealOutOfRange);
+            band.fake.Restore(saved.setIndex, saved.segment, saved.nfake, saved.nfakeOutOfRange, saved.windowBase, saved.windowNext);
+            for (size_t i=0; i<saved.dec.size(); ++i) band.fake.AddEvent(saved.hourAngle[i], saved.dec[i], saved.sidereal[i]);
+        }
+    }
+
+    ///@brief Apply the threads, transform mode, lazy decoding and timing settings to reader
+    void ConfigureReader(KcdcReader& reader) const
+    {
+        reader.SetThreads(m_threads);
+        reader.SetTransformMode(m_transformMode);
+        reader.SetLazyDecoding(m_lazyDecoding);
+        reader.SetTiming(IsTiming());
+    }
+
+    ///@brief Restrict an event cache opened by reader to the rows of m_shard
+    void SetCacheShard(KcdcReader& reader)
+    {
+        uint64_t begin(0), end(0);
+        GetShardRows(reader.GetCache(), begin, end);
+        reader.SetCacheRows(begin, end);
+    }
+
+    ///@brief Report the malformed records, stage times and progress of a batch read by reader
+    ///@param lines Lines before the batch; the batch is added
+    void ReportBatch(const KcdcReader& reader, const KcdcRecordBatch& batch, KcdcStageTimes& times, uint64_t& lines, uint64_t& malformed)
+    {
+        for (size_t i=0; i<batch.malformed.size(); ++i)
+        {
+            const KcdcMalformedRecord& m = batch.malformed[i];
+            ReportMalformed(lines + m.line, m.status, m.field, malformed);
+        }
+        if (IsTiming()) m_run.AddTimes(times);
+        times.Clear();
+        ReportProgress(lines, lines + batch.count, reader.IsCache() ? 0 : m_in.GetOffset());
+        lines += batch.count;
+    }
+
+    /// @brief Write a map of name map.name and kind map.kind in the format of SetMapFormat
+    bool WriteMap(const KcdcMapFile& map)
+    {
+        const std::string fname = KcdcMapFile::GetFileName(map.name, KcdcMapFile::Kind(map.kind), m_mapFormat);
+        bool ok(false);
+        if (m_mapFormat == MAP_FORMAT_TEXT)
+        {
+            // dec row, ra col
+            // upper left dec=90, ra=-180
+            SkyHistogram<> h;
+            std::ofstream os(fname.c_str(), std::ios::binary);
+            if (map.GetMap(h))
+            {
+                h.Write(os);
+                ok = (bool)os;
+            }
+        }
+        else
+        {
+            KcdcMapFile::Encoding encoding = m_mapFormat == MAP_FORMAT_DENSE ? KcdcMapFile::ENCODING_DENSE : KcdcMapFile::ENCODING_SPARSE;
+            if (m_mapFormat == MAP_FORMAT_BINARY) encoding = map.GetSmallerEncoding();
+            ok = map.Write(fname, encoding);
+        }
+        if (!ok) std::cout << "\nUnable to write map (" << fname << ")\n";
+        return ok;
+    }
+
+    /// @brief Read the map of name and kind: a .map file if there is one, else a .dat file
+    ///@param binary Set true if the map was read from a .map file
+    bool ReadMap(const std::string& name, KcdcMapFile::Kind kind, KcdcMapFile& map, bool& binary)
+    {
+        const std::string fname = KcdcMapFile::GetFileName(name, kind, MAP_FORMAT_BINARY);
+        binary = KcdcMapFile::IsMapFile(fname);
+        if (binary) return map.Read(fname);
+        SkyHistogram<> h(s_binSize);
+        std::ifstream is(KcdcMapFile::GetFileName(name, kind, MAP_FORMAT_TEXT).c_str(), std::ios::binary);
+        if (!is || !h.Read(is)) return false;
+        map = KcdcMapFile();
+        map.name = name;
+        map.kind = kind;
+        map.SetMap(h);
+        return true;
+    }
+
+    ///@brief Print the number of malformed records skipped, if any
+    void ReportMalformedTotal(uint64_t malformed)
+    {
+        if (malformed > 0) std::cout << "\nSkipped " << malformed << " malformed records";
+    }
+
+    /// @brief Report a read or decompression error that ended m_in early
+    void ReportInputError()
+    {
+        if (!m_in.GetError().empty()) std::cout << "\nInput ended early: " << m_in.GetError() << "\n";
+    }
+
+    static constexpr double s_minEnergy = 15.0;    ///< AddFields writes records with E >= this
+    static const size_t s_chunkSize = 1 << 20;     ///< input bytes per MergeFields read
+    static constexpr double s_binSize = 0.5;       ///< ProcessEventStats map bin size in degrees
+    /// Fields ProcessEventStats decodes with lazy decoding
+    static const uint32_t s_eventStatsFields = (1u<<FIELD_E) | (1u<<FIELD_ZE) | (1u<<FIELD_AZ) | (1u<<FIELD_YMD) | (1u<<FIELD_HMS);
+
+    KcdcOutputFile m_out;
+    KcdcInputFile m_in;
+    uint32_t m_threads;
+    TransformMode m_transformMode;
+    uint32_t m_oversampling;
+    uint64_t m_seed;
+    uint64_t m_eventSetSize;
+    bool m_slidingEventSets;
+    bool m_lazyDecoding;
+    double m_progressInterval;
+    KcdcShard m_shard;
+    uint64_t m_segmentSize;
+    std::string m_checkpointFile;
+    double m_checkpointInterval;
+    bool m_resume;
+    KcdcRegionCatalog m_regions;
+    MapFormat m_mapFormat;
+    std::chrono::steady_clock::time_point m_lastCheckpoint;
+    std::string m_statsFile;
+    KcdcRunStats m_run;                 ///< counters and times of the current (or last) run
 
 };
 
@@ -0,0 +1,422 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcEventCache.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Binary columnar cache of a KCDC dataset and its derived coordinates
+///
+///  @details Column blocks of native 8 byte values behind a header with the schema and column ranges,
+///           read through a memory mapping.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcEventCache_h_
+#define _Csi_KcdcEventCache_h_
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "KcdcRecord.h"
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief Column index in a KcdcEventCache: the KcdcField input columns followed by these
+enum KcdcCacheColumn
+{
+    CACHE_RA = FIELD_COUNT,     ///< +/-180, as written by AddFields
+    CACHE_DEC,
+    CACHE_LON,
+    CACHE_LAT,
+    CACHE_JDAYS,
+    CACHE_OFFSET,               ///< byte offset of the record's line in the text input (KcdcShard segments)
+    CACHE_COLUMN_COUNT
+};
+
+///@brief On disk structures and schema of the event cache format
+struct KcdcEventCacheFormat
+{
+    enum ColumnType { TYPE_DOUBLE = 0, TYPE_INT64, TYPE_UINT64 };
+
+    struct FileHeader
+    {
+        char magic[8];          ///< "KCDCEVC1"
+        uint32_t version;
+        uint32_t byteOrder;     ///< s_byteOrder as written by the producing machine
+        uint64_t rows;
+        uint32_t columns;
+        uint32_t blockRows;
+        uint64_t dataOffset;    ///< file offset of the first block
+        uint32_t textSize;      ///< length of the input header line
+        uint32_t reserved;
+    };
+
+    struct Column
+    {
+        char name[16];
+        uint32_t type;          ///< ColumnType
+        uint32_t reserved;
+        double min;             ///< smallest value, as a double
+        double max;             ///< largest value, as a double
+    };
+
+    static const uint32_t s_version = 2;     ///< 2 added CACHE_OFFSET
+    static const uint32_t s_byteOrder = 0x01020304;
+    static const uint32_t s_blockRows = 65536;
+    static const uint64_t s_alignment = 4096;
+
+    static const char* GetMagic() { return "KCDCEVC1"; }
+
+    ///@brief Name of a KcdcCacheColumn
+    static const char* GetColumnName(uint32_t column)
+    {
+        static const char* derived[] = {"RA", "DEC", "LON", "LAT", "JDAYS", "OFFSET"};
+        if (column < FIELD_COUNT) return GetFieldName(column);
+        return column<CACHE_COLUMN_COUNT ? derived[column-FIELD_COUNT] : "?";
+    }
+
+    ///@brief Storage type of a KcdcCacheColumn
+    static ColumnType GetColumnType(uint32_t column)
+    {
+        if (column == FIELD_NHAD) return TYPE_INT64;
+        if ((column >= FIELD_GT && column <= FIELD_EV) || column == CACHE_OFFSET) return TYPE_UINT64;
+        return TYPE_DOUBLE;
+    }
+
+    ///@brief Byte offset of the first block for an input header line of textSize characters
+    static uint64_t GetDataOffset(uint32_t columns, uint32_t textSize)
+    {
+        uint64_t size = sizeof(FileHeader) + columns*sizeof(Column) + textSize;
+        return (size + s_alignment - 1)/s_alignment*s_alignment;
+    }
+};
+
+///@brief Writes records and their derived coordinates to an event cache file
+class KcdcEventCacheWriter
+{
+public:
+    typedef KcdcEventCacheFormat Format;
+
+    KcdcEventCacheWriter() : m_rows(0), m_blockUsed(0) {}
+    ~KcdcEventCacheWriter() { Close(); }
+
+    ///@brief Create fname; inputHeader is the header line of the input file
+    ///@return false if the file cannot be created
+    bool Open(const std::string& fname, std::string_view inputHeader)
+    {
+        Close();
+        m_text.assign(inputHeader.data(), inputHeader.size());
+        m_out.open(fname.c_str(), std::ios::binary | std::ios::trunc);
+        if (!m_out) return false;
+        m_rows = 0;
+        m_blockUsed = 0;
+        m_block.assign((size_t)CACHE_COLUMN_COUNT*Format::s_blockRows, 0);
+        m_columns.resize(CACHE_COLUMN_COUNT);
+        for (uint32_t c=0; c<CACHE_COLUMN_COUNT; ++c)
+        {
+            Format::Column& col = m_columns[c];
+            memset(&col, 0, sizeof(col));
+            strncpy(col.name, Format::GetColumnName(c), sizeof(col.name)-1);
+            col.type = Format::GetColumnType(c);
+            col.min = std::numeric_limits<double>::infinity();
+            col.max = -std::numeric_limits<double>::infinity();
+        }
+        WriteHeader();      // rewritten with the row count and min/max by Close()
+        return m_out.good();
+    }
+
+    bool IsOpen() const { return m_out.is_open(); }
+
+    ///@brief Append one row
+    ///@param offset Byte offset of the record's line in the text input
+    void Append(const KcdcRecord& rec, const KcdcDerived& d, uint64_t offset)
+    {
+        Set(FIELD_E, rec.e);
+        Set(FIELD_YC, rec.yc);
+        Set(FIELD_XC, rec.xc);
+        Set(FIELD_ZE, rec.ze);
+        Set(FIELD_AZ, rec.az);
+        Set(FIELD_NE, rec.ne);
+        Set(FIELD_NMU, rec.nmu);
+        Set(FIELD_ESUMHAD, rec.esumhad);
+        Set(FIELD_NHAD, rec.nhad);
+        Set(FIELD_T, rec.t);
+        Set(FIELD_P, rec.p);
+        Set(FIELD_GT, rec.gt);
+        Set(FIELD_MT, rec.mt);
+        Set(FIELD_YMD, rec.ymd);
+        Set(FIELD_HMS, rec.hms);
+        Set(FIELD_R, rec.r);
+        Set(FIELD_EV, rec.ev);
+        Set(FIELD_AGE, rec.age);
+        Set(CACHE_RA, d.ra);
+        Set(CACHE_DEC, d.dec);
+        Set(CACHE_LON, d.lon);
+        Set(CACHE_LAT, d.lat);
+        Set(CACHE_JDAYS, d.jdays);
+        Set(CACHE_OFFSET, offset);
+        ++m_rows;
+        if (++m_blockUsed == Format::s_blockRows) FlushBlock();
+    }
+
+    uint64_t GetRows() const { return m_rows; }
+
+    ///@brief Write the last block and the final header
+    ///@return false if writing failed
+    bool Close()
+    {
+        if (!m_out.is_open()) return true;
+        FlushBlock();
+        m_out.seekp(0);
+        WriteHeader();
+        bool ok = m_out.good();
+        m_out.close();
+        return ok;
+    }
+
+protected:
+    template <typename T>
+    void Set(uint32_t column, T value)
+    {
+        memcpy(&m_block[(size_t)column*Format::s_blockRows + m_blockUsed], &value, sizeof(value));
+        Format::Column& col = m_columns[column];
+        double v = (double)value;
+        if (v < col.min) col.min = v;
+        if (v > col.max) col.max = v;
+    }
+
+    void FlushBlock()
+    {
+        if (m_blockUsed == 0) return;
+        for (uint32_t c=0; c<CACHE_COLUMN_COUNT; ++c)
+        {
+            m_out.write(reinterpret_cast<const char*>(&m_block[(size_t)c*Format::s_blockRows]), m_blockUsed*sizeof(uint64_t));
+        }
+        m_blockUsed = 0;
+    }
+
+    void WriteHeader()
+    {
+        Format::FileHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, Format::GetMagic(), sizeof(h.magic));
+        h.version = Format::s_version;
+        h.byteOrder = Format::s_byteOrder;
+        h.rows = m_rows;
+        h.columns = CACHE_COLUMN_COUNT;
+        h.blockRows = Format::s_blockRows;
+        h.textSize = m_text.size();
+        h.dataOffset = Format::GetDataOffset(h.columns, h.textSize);
+        m_out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        m_out.write(reinterpret_cast<const char*>(&m_columns[0]), m_columns.size()*sizeof(Format::Column));
+        m_out.write(m_text.data(), m_text.size());
+        std::vector<char> pad(h.dataOffset - sizeof(h) - m_columns.size()*sizeof(Format::Column) - m_text.size(), 0);
+        m_out.write(pad.data(), pad.size());
+    }
+
+    std::ofstream m_out;
+    std::string m_text;
+    std::vector<Format::Column> m_columns;
+    std::vector<uint64_t> m_block;      ///< the current block, column by column, 8 bytes per value
+    uint64_t m_rows;
+    uint32_t m_blockUsed;               ///< rows in the current block
+};
+
+///@brief Read access to a memory mapped event cache file
+class KcdcEventCache
+{
+public:
+    typedef KcdcEventCacheFormat Format;
+
+    KcdcEventCache() : m_map(0), m_size(0), m_header(0), m_columns(0) {}
+    ~KcdcEventCache() { Close(); }
+
+    ///@brief True if fname starts with the event cache magic
+    static bool IsEventCache(const std::string& fname)
+    {
+        if (fname == "-") return false;
+        int fd = open(fname.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        char magic[8];
+        bool is = (read(fd, magic, sizeof(magic)) == (ssize_t)sizeof(magic) && memcmp(magic, Format::GetMagic(), sizeof(magic)) == 0);
+        close(fd);
+        return is;
+    }
+
+    ///@brief Map fname
+    ///@return false if it cannot be opened or is not a complete event cache of this version
+    bool Open(const std::string& fname)
+    {
+        Close();
+        int fd = open(fname.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st)==0 && (size_t)st.st_size >= sizeof(Format::FileHeader))
+        {
+            void* p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                m_map = static_cast<const char*>(p);
+                m_size = st.st_size;
+                madvise(p, m_size, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+        if (!m_map) return false;
+        m_header = reinterpret_cast<const Format::FileHeader*>(m_map);
+        m_columns = reinterpret_cast<const Format::Column*>(m_map + sizeof(Format::FileHeader));
+        if (!IsValid())
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+        if (m_map) munmap(const_cast<char*>(m_map), m_size);
+        m_map = 0;
+        m_size = 0;
+        m_header = 0;
+        m_columns = 0;
+    }
+
+    bool IsOpen() const { return m_map != 0; }
+
+    uint64_t GetRows() const { return m_header->rows; }
+    uint32_t GetColumnCount() const { return m_header->columns; }
+    const Format::Column& GetColumn(uint32_t column) const { return m_columns[column]; }
+
+    ///@brief Header line of the input file the cache was made from
+    std::string_view GetInputHeader() const
+    {
+        return std::string_view(m_map + sizeof(Format::FileHeader) + m_header->columns*sizeof(Format::Column), m_header->textSize);
+    }
+
+    uint64_t GetBlockCount() const { return (m_header->rows + m_header->blockRows - 1)/m_header->blockRows; }
+
+    ///@brief Number of rows in block
+    uint32_t GetBlockRows(uint64_t block) const
+    {
+        uint64_t begin = block*m_header->blockRows;
+        uint64_t left = m_header->rows - begin;
+        return left < m_header->blockRows ? left : m_header->blockRows;
+    }
+
+    ///@brief Values of column in block; T must match the column type
+    template <typename T>
+    const T* GetValues(uint64_t block, uint32_t column) const
+    {
+        const uint64_t blockBytes = (uint64_t)m_header->columns*m_header->blockRows*sizeof(uint64_t);
+        const char* p = m_map + m_header->dataOffset + block*blockBytes + (uint64_t)column*GetBlockRows(block)*sizeof(uint64_t);
+        return reinterpret_cast<const T*>(p);
+    }
+
+    ///@brief Copy row of block into rec and d (d.dist is not stored and set to 0)
+    void GetRow(uint64_t block, uint32_t row, KcdcRecord& rec, KcdcDerived& d) const
+    {
+        rec.e = GetValues<double>(block, FIELD_E)[row];
+        rec.yc = GetValues<double>(block, FIELD_YC)[row];
+        rec.xc = GetValues<double>(block, FIELD_XC)[row];
+        rec.ze = GetValues<double>(block, FIELD_ZE)[row];
+        rec.az = GetValues<double>(block, FIELD_AZ)[row];
+        rec.ne = GetValues<double>(block, FIELD_NE)[row];
+        rec.nmu = GetValues<double>(block, FIELD_NMU)[row];
+        rec.esumhad = GetValues<double>(block, FIELD_ESUMHAD)[row];
+        rec.nhad = GetValues<int64_t>(block, FIELD_NHAD)[row];
+        rec.t = GetValues<double>(block, FIELD_T)[row];
+        rec.p = GetValues<double>(block, FIELD_P)[row];
+        rec.gt = GetValues<uint64_t>(block, FIELD_GT)[row];
+        rec.mt = GetValues<uint64_t>(block, FIELD_MT)[row];
+        rec.ymd = GetValues<uint64_t>(block, FIELD_YMD)[row];
+        rec.hms = GetValues<uint64_t>(block, FIELD_HMS)[row];
+        rec.r = GetValues<uint64_t>(block, FIELD_R)[row];
+        rec.ev = GetValues<uint64_t>(block, FIELD_EV)[row];
+        rec.age = GetValues<double>(block, FIELD_AGE)[row];
+        d.ra = GetValues<double>(block, CACHE_RA)[row];
+        d.dec = GetValues<double>(block, CACHE_DEC)[row];
+        d.lon = GetValues<double>(block, CACHE_LON)[row];
+        d.lat = GetValues<double>(block, CACHE_LAT)[row];
+        d.jdays = GetValues<double>(block, CACHE_JDAYS)[row];
+        d.dist = 0.0;
+    }
+
+    ///@brief Text input offset (CACHE_OFFSET) of a row, counting rows over all blocks
+    uint64_t GetRowOffset(uint64_t row) const
+    {
+        return GetValues<uint64_t>(row/m_header->blockRows, CACHE_OFFSET)[row%m_header->blockRows];
+    }
+
+    ///@brief First row whose text input offset is at least offset, or GetRows() if there is none
+    uint64_t FindRow(uint64_t offset) const
+    {
+        // rows are in input order, so the offsets increase
+        uint64_t lo(0), hi(GetRows());
+        while (lo < hi)
+        {
+            uint64_t mid = lo + (hi - lo)/2;
+            if (GetRowOffset(mid) < offset) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+protected:
+    bool IsValid() const
+    {
+        const Format::FileHeader& h = *m_header;
+        if (memcmp(h.magic, Format::GetMagic(), sizeof(h.magic)) != 0) return false;
+        if (h.version != Format::s_version || h.byteOrder != Format::s_byteOrder) return false;
+        if (h.columns != CACHE_COLUMN_COUNT || h.blockRows == 0) return false;
+        if (h.dataOffset != Format::GetDataOffset(h.columns, h.textSize) || h.dataOffset > m_size) return false;
+        for (uint32_t c=0; c<h.columns; ++c)
+        {
+            if (m_columns[c].type != (uint32_t)Format::GetColumnType(c)) return false;
+        }
+        return m_size - h.dataOffset >= h.rows*h.columns*sizeof(uint64_t);
+    }
+
+    const char* m_map;
+    size_t m_size;
+    const Format::FileHeader* m_header;
+    const Format::Column* m_columns;
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcEventCache_h_
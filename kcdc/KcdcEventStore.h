@@ -0,0 +1,694 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcEventStore.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   In memory columnar event store with selections, histograms and export
+///
+///  @details One array per column; selections are bitmaps combined with And, Or and AndNot.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcEventStore_h_
+#define _Csi_KcdcEventStore_h_
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <inttypes.h>
+#include "KcdcCompression.h"
+#include "KcdcFormatter.h"
+#include "KcdcHistogram.h"
+#include "KcdcPipeline.h"
+#include "KcdcRecord.h"
+#include "KcdcRegions.h"
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief Column index in a KcdcEventStore: the KcdcField input columns followed by these
+enum KcdcStoreColumn
+{
+    STORE_RA = FIELD_COUNT,     ///< +/-180, as written by AddFields
+    STORE_DEC,
+    STORE_LON,
+    STORE_LAT,
+    STORE_JDAYS,
+    STORE_DIST,
+    STORE_COLUMN_COUNT
+};
+
+///@brief Set of rows of a KcdcEventStore, a bit per row
+class KcdcSelection
+{
+public:
+    KcdcSelection() : m_rows(0) {}
+    explicit KcdcSelection(uint64_t rows, bool value=false) : m_rows(0) { Resize(rows, value); }
+
+    ///@brief Select none (or with value all) of rows rows
+    void Resize(uint64_t rows, bool value=false)
+    {
+        m_rows = rows;
+        m_words.assign((rows + 63)/64, value ? ~uint64_t(0) : 0);
+        ClearTail();
+    }
+
+    uint64_t GetRows() const { return m_rows; }
+    size_t GetWordCount() const { return m_words.size(); }
+    uint64_t* GetWords() { return m_words.data(); }
+    const uint64_t* GetWords() const { return m_words.data(); }
+
+    ///@brief Number of selected rows
+    uint64_t GetCount() const
+    {
+        uint64_t n(0);
+        for (size_t w=0; w<m_words.size(); ++w) n += __builtin_popcountll(m_words[w]);
+        return n;
+    }
+
+    bool IsSelected(uint64_t row) const { return (m_words[row/64] >> (row%64)) & 1; }
+
+    void Set(uint64_t row, bool value=true)
+    {
+        const uint64_t bit = uint64_t(1) << (row%64);
+        if (value) m_words[row/64] |= bit;
+        else m_words[row/64] &= ~bit;
+    }
+
+    ///@brief Keep the rows also selected in rhs
+    ///@return false, leaving this selection unchanged, if rhs has a different row count
+    bool And(const KcdcSelection& rhs)
+    {
+        if (rhs.m_rows != m_rows) return false;
+        for (size_t w=0; w<m_words.size(); ++w) m_words[w] &= rhs.m_words[w];
+        return true;
+    }
+
+    ///@brief Add the rows selected in rhs
+    bool Or(const KcdcSelection& rhs)
+    {
+        if (rhs.m_rows != m_rows) return false;
+        for (size_t w=0; w<m_words.size(); ++w) m_words[w] |= rhs.m_words[w];
+        return true;
+    }
+
+    ///@brief Remove the rows selected in rhs
+    bool AndNot(const KcdcSelection& rhs)
+    {
+        if (rhs.m_rows != m_rows) return false;
+        for (size_t w=0; w<m_words.size(); ++w) m_words[w] &= ~rhs.m_words[w];
+        return true;
+    }
+
+    ///@brief Select the rows that are not selected
+    void Invert()
+    {
+        for (size_t w=0; w<m_words.size(); ++w) m_words[w] = ~m_words[w];
+        ClearTail();
+    }
+
+    ///@brief Call f(row) for every selected row, in row order
+    template <class F>
+    void ForEach(F f) const
+    {
+        for (size_t w=0; w<m_words.size(); ++w)
+        {
+            for (uint64_t word=m_words[w]; word; word&=word-1) f(w*64 + __builtin_ctzll(word));
+        }
+    }
+
+    ///@brief Word of 64 flags, each 0 or 1; flags[j] becomes bit j
+    static uint64_t Pack(const uint8_t* flags)
+    {
+        uint64_t word(0);
+        for (uint32_t b=0; b<8; ++b)
+        {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            for (uint32_t j=0; j<8; ++j) word |= uint64_t(flags[8*b+j]) << (8*b + j);
+#else
+            uint64_t x;
+            memcpy(&x, flags + 8*b, sizeof(x));
+            // byte j moves to bit 56+j; the partial products do not overlap, so nothing carries
+            word |= ((x*0x0102040810204080ULL) >> 56) << (8*b);
+#endif
+        }
+        return word;
+    }
+
+protected:
+    /// @brief Clear the bits past the last row
+    void ClearTail()
+    {
+        if (m_rows%64 != 0) m_words.back() &= (uint64_t(1) << (m_rows%64)) - 1;
+    }
+
+    std::vector<uint64_t> m_words;
+    uint64_t m_rows;
+};
+
+///@brief Counts of the values of a store column in bins of equal width over [min, max)
+struct KcdcColumnHistogram
+{
+    KcdcColumnHistogram(double min_=0.0, double max_=1.0, uint32_t bins=100) : min(min_), max(max_), counts(bins, 0), below(0), above(0) {}
+    double min;
+    double max;
+    std::vector<uint64_t> counts;
+    uint64_t below;     ///< values < min
+    uint64_t above;     ///< values >= max
+
+    double GetBinWidth() const { return (max - min)/counts.size(); }
+
+    ///@brief Lower edge of bin
+    double GetBinLow(uint32_t bin) const { return min + bin*GetBinWidth(); }
+
+    ///@brief Sum of the bins, below and above
+    uint64_t GetTotal() const
+    {
+        uint64_t total = below + above;
+        for (size_t i=0; i<counts.size(); ++i) total += counts[i];
+        return total;
+    }
+};
+
+///@brief Columns of a dataset in memory, for selections and aggregations without re-reading it
+class KcdcEventStore
+{
+public:
+    enum ColumnType { TYPE_FLOAT = 0, TYPE_DOUBLE, TYPE_INT32, TYPE_UINT32 };
+
+    KcdcEventStore() : m_rows(0), m_threads(1) {}
+
+    ///@brief Name of a KcdcStoreColumn
+    static const char* GetColumnName(uint32_t column)
+    {
+        static const char* derived[] = {"RA", "DEC", "LON", "LAT", "JDAYS", "DIST"};
+        if (column < FIELD_COUNT) return GetFieldName(column);
+        return column<STORE_COLUMN_COUNT ? derived[column-FIELD_COUNT] : "?";
+    }
+
+    ///@brief Column of a name (GetColumnName), or STORE_COLUMN_COUNT if there is none
+    static uint32_t FindColumn(std::string_view name)
+    {
+        for (uint32_t c=0; c<STORE_COLUMN_COUNT; ++c)
+        {
+            if (name == GetColumnName(c)) return c;
+        }
+        return STORE_COLUMN_COUNT;
+    }
+
+    ///@brief Storage type of a KcdcStoreColumn
+    static ColumnType GetColumnType(uint32_t column)
+    {
+        if (column == FIELD_NHAD) return TYPE_INT32;
+        if (column >= FIELD_GT && column <= FIELD_EV) return TYPE_UINT32;
+        if (column == FIELD_P || column == STORE_JDAYS) return TYPE_DOUBLE;
+        return TYPE_FLOAT;
+    }
+
+    ///@brief Set the number of threads of the queries; 0 uses one per hardware thread
+    void SetThreads(uint32_t threads) { m_threads = threads; }
+
+    uint32_t GetThreads() const { return m_threads; }
+
+    uint64_t GetRows() const { return m_rows; }
+
+    ///@brief Bytes allocated for the columns
+    size_t GetMemorySize() const
+    {
+        size_t size(0);
+        for (uint32_t c=0; c<STORE_COLUMN_COUNT; ++c)
+        {
+            Visit(c, m_columns[c], [&](const auto& values) { size += values.capacity()*sizeof(values[0]); });
+        }
+        return size;
+    }
+
+    ///@brief Header line of the input the rows come from, written by WriteText
+    void SetInputHeader(std::string_view header) { m_inputHeader.assign(header.data(), header.size()); }
+
+    const std::string& GetInputHeader() const { return m_inputHeader; }
+
+    ///@brief Description of the last Append or WriteText failure
+    const std::string& GetError() const { return m_error; }
+
+    void Clear()
+    {
+        for (uint32_t c=0; c<STORE_COLUMN_COUNT; ++c)
+        {
+            Column& col = m_columns[c];
+            col.f.clear();
+            col.d.clear();
+            col.i.clear();
+            col.u.clear();
+        }
+        m_rows = 0;
+        m_inputHeader.clear();
+        m_error.clear();
+    }
+
+    ///@brief Allocate the columns for rows rows
+    void Reserve(uint64_t rows)
+    {
+        for (uint32_t c=0; c<STORE_COLUMN_COUNT; ++c)
+        {
+            Visit(c, m_columns[c], [&](auto& values) { values.reserve(rows); });
+        }
+    }
+
+    ///@brief Release the memory allocated beyond the rows
+    void ShrinkToFit()
+    {
+        for (uint32_t c=0; c<STORE_COLUMN_COUNT; ++c)
+        {
+            Visit(c, m_columns[c], [&](auto& values) { values.shrink_to_fit(); });
+        }
+    }
+
+    ///@brief Append a row
+    ///@return false, leaving the store unchanged, if an integer does not fit its 32 bit column
+    bool Append(const KcdcRecord& rec, const KcdcDerived& d)
+    {
+        if (rec.nhad < std::numeric_limits<int32_t>::min() || rec.nhad > std::numeric_limits<int32_t>::max())
+        {
+            return SetRangeError(FIELD_NHAD);
+        }
+        const uint64_t u[] = {rec.gt, rec.mt, rec.ymd, rec.hms, rec.r, rec.ev};
+        for (uint32_t k=0; k<sizeof(u)/sizeof(u[0]); ++k)
+        {
+            if (u[k] > std::numeric_limits<uint32_t>::max()) return SetRangeError(FIELD_GT + k);
+        }
+        m_columns[FIELD_E].f.push_back(rec.e);
+        m_columns[FIELD_YC].f.push_back(rec.yc);
+        m_columns[FIELD_XC].f.push_back(rec.xc);
+        m_columns[FIELD_ZE].f.push_back(rec.ze);
+        m_columns[FIELD_AZ].f.push_back(rec.az);
+        m_columns[FIELD_NE].f.push_back(rec.ne);
+        m_columns[FIELD_NMU].f.push_back(rec.nmu);
+        m_columns[FIELD_ESUMHAD].f.push_back(rec.esumhad);
+        m_columns[FIELD_NHAD].i.push_back(rec.nhad);
+        m_columns[FIELD_T].f.push_back(rec.t);
+        m_columns[FIELD_P].d.push_back(rec.p);
+        for (uint32_t k=0; k<sizeof(u)/sizeof(u[0]); ++k) m_columns[FIELD_GT + k].u.push_back(u[k]);
+        m_columns[FIELD_AGE].f.push_back(rec.age);
+        m_columns[STORE_RA].f.push_back(d.ra);
+        m_columns[STORE_DEC].f.push_back(d.dec);
+        m_columns[STORE_LON].f.push_back(d.lon);
+        m_columns[STORE_LAT].f.push_back(d.lat);
+        m_columns[STORE_JDAYS].d.push_back(d.jdays);
+        m_columns[STORE_DIST].f.push_back(d.dist);
+        ++m_rows;
+        return true;
+    }
+
+    ///@brief Copy row into rec and d, at the stored precision
+    void GetRow(uint64_t row, KcdcRecord& rec, KcdcDerived& d) const
+    {
+        rec.e = m_columns[FIELD_E].f[row];
+        rec.yc = m_columns[FIELD_YC].f[row];
+        rec.xc = m_columns[FIELD_XC].f[row];
+        rec.ze = m_columns[FIELD_ZE].f[row];
+        rec.az = m_columns[FIELD_AZ].f[row];
+        rec.ne = m_columns[FIELD_NE].f[row];
+        rec.nmu = m_columns[FIELD_NMU].f[row];
+        rec.esumhad = m_columns[FIELD_ESUMHAD].f[row];
+        rec.nhad = m_columns[FIELD_NHAD].i[row];
+        rec.t = m_columns[FIELD_T].f[row];
+        rec.p = m_columns[FIELD_P].d[row];
+        rec.gt = m_columns[FIELD_GT].u[row];
+        rec.mt = m_columns[FIELD_MT].u[row];
+        rec.ymd = m_columns[FIELD_YMD].u[row];
+        rec.hms = m_columns[FIELD_HMS].u[row];
+        rec.r = m_columns[FIELD_R].u[row];
+        rec.ev = m_columns[FIELD_EV].u[row];
+        rec.age = m_columns[FIELD_AGE].f[row];
+        d.ra = m_columns[STORE_RA].f[row];
+        d.dec = m_columns[STORE_DEC].f[row];
+        d.lon = m_columns[STORE_LON].f[row];
+        d.lat = m_columns[STORE_LAT].f[row];
+        d.jdays = m_columns[STORE_JDAYS].d[row];
+        d.dist = m_columns[STORE_DIST].f[row];
+    }
+
+    ///@brief Value of column in row
+    double GetValue(uint32_t column, uint64_t row) const
+    {
+        double value(0.0);
+        Visit(column, m_columns[column], [&](const auto& values) { value = values[row]; });
+        return value;
+    }
+
+    ///@brief Values of a column, or 0 if the column is of another type
+    const float* GetFloats(uint32_t column) const { return IsType(column, TYPE_FLOAT) ? m_columns[column].f.data() : 0; }
+    const double* GetDoubles(uint32_t column) const { return IsType(column, TYPE_DOUBLE) ? m_columns[column].d.data() : 0; }
+    const int32_t* GetInts(uint32_t column) const { return IsType(column, TYPE_INT32) ? m_columns[column].i.data() : 0; }
+    const uint32_t* GetUints(uint32_t column) const { return IsType(column, TYPE_UINT32) ? m_columns[column].u.data() : 0; }
+
+    ///@brief Select every row
+    void SelectAll(KcdcSelection& sel) const { sel.Resize(m_rows, true); }
+
+    ///@brief Select the rows with min <= column <= max; NaN is never selected
+    ///@return false if column is not a KcdcStoreColumn
+    bool Select(uint32_t column, double min, double max, KcdcSelection& sel) const
+    {
+        if (column >= STORE_COLUMN_COUNT) return false;
+        sel.Resize(m_rows);
+        Visit(column, m_columns[column], [&](const auto& values) { SelectRange(values.data(), min, max, sel); });
+        return true;
+    }
+
+    ///@brief Select the rows within a source of catalog, which must be built
+    void SelectRegions(const KcdcRegionCatalog& catalog, KcdcSelection& sel) const
+    {
+        sel.Resize(m_rows);
+        const float* ra = m_columns[STORE_RA].f.data();
+        const float* dec = m_columns[STORE_DEC].f.data();
+        uint64_t* words = sel.GetWords();
+        ForEachWord(sel.GetWordCount(), [&](size_t begin, size_t end)
+        {
+            std::vector<uint32_t> sources;
+            uint8_t flags[64];
+            for (size_t w=begin; w<end; ++w)
+            {
+                memset(flags, 0, sizeof(flags));
+                const uint64_t first = w*64;
+                const uint32_t n = GetWordRows(w);
+                for (uint32_t j=0; j<n; ++j)
+                {
+                    sources.clear();
+                    flags[j] = catalog.Match(ra[first+j], dec[first+j], sources) > 0;
+                }
+                words[w] = KcdcSelection::Pack(flags);
+            }
+        });
+    }
+
+    ///@brief Select the rows within radius degrees of (ra, dec)
+    ///@return false if the cone is not valid (see KcdcRegionCatalog::Add)
+    bool SelectCone(double ra, double dec, double radius, KcdcSelection& sel) const
+    {
+        KcdcRegionCatalog catalog;
+        if (!catalog.Add(KcdcRegion("cone", ra, dec, radius))) return false;
+        catalog.Build();
+        SelectRegions(catalog, sel);
+        return true;
+    }
+
+    ///@brief Count the values of column in the rows of sel into h, adding to its counts
+    ///@return false if column is not a KcdcStoreColumn, sel is of another store or h has no bins
+    bool FillHistogram(uint32_t column, const KcdcSelection& sel, KcdcColumnHistogram& h) const
+    {
+        if (column >= STORE_COLUMN_COUNT || sel.GetRows() != m_rows || h.counts.empty() || !(h.max > h.min)) return false;
+        const uint32_t threads = GetWordThreads(sel.GetWordCount());
+        const size_t bins = h.counts.size();
+        // bins, then below and above
+        std::vector<std::vector<uint64_t> > partial(threads, std::vector<uint64_t>(bins + 2, 0));
+        const double min(h.min), max(h.max), scale(bins/(h.max - h.min));
+        const uint64_t* words = sel.GetWords();
+        Visit(column, m_columns[column], [&](const auto& values)
+        {
+            RunParallel(threads, sel.GetWordCount(), [&](uint32_t thread, size_t begin, size_t end)
+            {
+                std::vector<uint64_t>& counts = partial[thread];
+                for (size_t w=begin; w<end; ++w)
+                {
+                    for (uint64_t word=words[w]; word; word&=word-1)
+                    {
+                        const double v = values[w*64 + __builtin_ctzll(word)];
+                        if (v < min) ++counts[bins];
+                        else if (v >= max) ++counts[bins+1];
+                        else if (v == v)
+                        {
+                            size_t bin = (v - min)*scale;
+                            ++counts[bin < bins ? bin : bins-1];
+                        }
+                    }
+                }
+            });
+        });
+        for (uint32_t t=0; t<threads; ++t)
+        {
+            for (size_t b=0; b<bins; ++b) h.counts[b] += partial[t][b];
+            h.below += partial[t][bins];
+            h.above += partial[t][bins+1];
+        }
+        return true;
+    }
+
+    ///@brief Count the RA and DEC of the rows of sel into map, adding to its counts
+    ///@return false if sel is of another store
+    template <typename Count>
+    bool FillSkyMap(const KcdcSelection& sel, SkyHistogram<Count>& map) const
+    {
+        if (sel.GetRows() != m_rows) return false;
+        const uint32_t threads = GetWordThreads(sel.GetWordCount());
+        std::vector<SkyHistogram<Count> > partial(threads > 1 ? threads : 0, map);
+        for (size_t t=0; t<partial.size(); ++t) partial[t].Clear();
+        const float* ra = m_columns[STORE_RA].f.data();
+        const float* dec = m_columns[STORE_DEC].f.data();
+        const uint64_t* words = sel.GetWords();
+        RunParallel(threads, sel.GetWordCount(), [&](uint32_t thread, size_t begin, size_t end)
+        {
+            SkyHistogram<Count>& part = threads > 1 ? partial[thread] : map;
+            // blocks of selected rows, so Fill can compute the bins of a block together
+            static const size_t block = 256;
+            double blockRa[block + 64];
+            double blockDec[block + 64];
+            size_t n(0);
+            for (size_t w=begin; w<end; ++w)
+            {
+                for (uint64_t word=words[w]; word; word&=word-1)
+                {
+                    const uint64_t row = w*64 + __builtin_ctzll(word);
+                    blockRa[n] = ra[row];
+                    blockDec[n] = dec[row];
+                    ++n;
+                }
+                if (n >= block)
+                {
+                    part.Fill(n, blockRa, blockDec);
+                    n = 0;
+                }
+            }
+            part.Fill(n, blockRa, blockDec);
+        });
+        for (size_t t=0; t<partial.size(); ++t) map.Merge(partial[t]);
+        return true;
+    }
+
+    ///@brief Copy the rows of sel to subset, replacing its rows
+    ///@return false if sel is of another store
+    bool Extract(const KcdcSelection& sel, KcdcEventStore& subset) const
+    {
+        if (sel.GetRows() != m_rows || &subset == this) return false;
+        subset.Clear();
+        subset.m_inputHeader = m_inputHeader;
+        const uint64_t rows = sel.GetCount();
+        subset.Reserve(rows);
+        for (uint32_t c=0; c<STORE_COLUMN_COUNT; ++c)
+        {
+            const Column& from = m_columns[c];
+            Column& to = subset.m_columns[c];
+            CopyRows(sel, from.f, to.f);
+            CopyRows(sel, from.d, to.d);
+            CopyRows(sel, from.i, to.i);
+            CopyRows(sel, from.u, to.u);
+        }
+        subset.m_rows = rows;
+        return true;
+    }
+
+    ///@brief Write the rows of sel to fname in the AddFields output format
+    ///@return false if sel is of another store or writing failed (GetError)
+    bool WriteText(const std::string& fname, const KcdcSelection& sel)
+    {
+        if (sel.GetRows() != m_rows)
+        {
+            m_error = "selection of another store";
+            return false;
+        }
+        KcdcOutputFile out;
+        if (!out.Open(fname))
+        {
+            m_error = "unable to create (" + fname + ") " + out.GetError();
+            return false;
+        }
+        KcdcOutputBuffer buffer;
+        KcdcRecordFormatter::AppendHeader(buffer, m_inputHeader);
+        KcdcRecord rec;
+        KcdcDerived d;
+        sel.ForEach([&](uint64_t row)
+        {
+            GetRow(row, rec, d);
+            KcdcRecordFormatter::AppendRecord(buffer, rec, d);
+            if (buffer.IsFull())
+            {
+                out.Write(buffer.GetData(), buffer.GetSize());
+                buffer.Clear();
+            }
+        });
+        out.Write(buffer.GetData(), buffer.GetSize());
+        if (!out.Close())
+        {
+            m_error = "error writing (" + fname + ") " + out.GetError();
+            return false;
+        }
+        return true;
+    }
+
+protected:
+    /// @brief Values of a column; only the vector of its type is used
+    struct Column
+    {
+        std::vector<float> f;
+        std::vector<double> d;
+        std::vector<int32_t> i;
+        std::vector<uint32_t> u;
+    };
+
+    /// @brief Call op with the vector of column's type of col
+    template <class ColumnT, class Op>
+    static void Visit(uint32_t column, ColumnT& col, Op op)
+    {
+        switch (GetColumnType(column))
+        {
+        case TYPE_FLOAT:  op(col.f); break;
+        case TYPE_DOUBLE: op(col.d); break;
+        case TYPE_INT32:  op(col.i); break;
+        case TYPE_UINT32: op(col.u); break;
+        }
+    }
+
+    static bool IsType(uint32_t column, ColumnType type) { return column < STORE_COLUMN_COUNT && GetColumnType(column) == type; }
+
+    bool SetRangeError(uint32_t column)
+    {
+        m_error = std::string(GetColumnName(column)) + " value out of range in row " + std::to_string(m_rows + 1);
+        return false;
+    }
+
+    /// @brief Number of rows of selection word w
+    uint32_t GetWordRows(size_t w) const
+    {
+        const uint64_t left = m_rows - (uint64_t)w*64;
+        return left < 64 ? left : 64;
+    }
+
+    /// @brief Threads for a query over words selection words: at most one per word
+    uint32_t GetWordThreads(size_t words) const
+    {
+        const uint32_t threads = GetThreadCount(m_threads);
+        return words < threads ? (words > 0 ? words : 1) : threads;
+    }
+
+    /// @brief Call work(begin, end) for ranges of selection words on the query threads
+    template <class Work>
+    void ForEachWord(size_t words, Work work) const
+    {
+        RunParallel(GetWordThreads(words), words, [&](uint32_t, size_t begin, size_t end) { work(begin, end); });
+    }
+
+    /// @brief Bounds of type T selecting the same values as min <= value <= max
+    ///@return false if no value of type T is in the range
+    static bool GetBounds(double min, double max, double& lo, double& hi)
+    {
+        lo = min;
+        hi = max;
+        return min <= max;
+    }
+
+    static bool GetBounds(double min, double max, float& lo, float& hi)
+    {
+        lo = min;
+        hi = max;
+        if (lo < min) lo = std::nextafter(lo, std::numeric_limits<float>::infinity());
+        if (hi > max) hi = std::nextafter(hi, -std::numeric_limits<float>::infinity());
+        return lo <= hi;
+    }
+
+    template <typename T>
+    static bool GetBounds(double min, double max, T& lo, T& hi)
+    {
+        const double tmin = std::numeric_limits<T>::min();
+        const double tmax = std::numeric_limits<T>::max();
+        if (!(min <= max) || min > tmax || max < tmin) return false;
+        lo = min > tmin ? (T)std::ceil(min) : std::numeric_limits<T>::min();
+        hi = max < tmax ? (T)std::floor(max) : std::numeric_limits<T>::max();
+        return lo <= hi;
+    }
+
+    /// @brief Set sel to the rows with min <= values <= max
+    template <typename T>
+    void SelectRange(const T* values, double min, double max, KcdcSelection& sel) const
+    {
+        // compared in the column type, a loop the compiler vectorizes, then the flags are packed
+        T lo, hi;
+        if (!GetBounds(min, max, lo, hi)) return;
+        uint64_t* words = sel.GetWords();
+        ForEachWord(sel.GetWordCount(), [&](size_t begin, size_t end)
+        {
+            uint8_t flags[64];
+            for (size_t w=begin; w<end; ++w)
+            {
+                const T* v = values + w*64;
+                const uint32_t n = GetWordRows(w);
+                if (n == 64)
+                {
+                    for (uint32_t j=0; j<64; ++j) flags[j] = (v[j] >= lo) & (v[j] <= hi);
+                }
+                else
+                {
+                    memset(flags, 0, sizeof(flags));
+                    for (uint32_t j=0; j<n; ++j) flags[j] = (v[j] >= lo) & (v[j] <= hi);
+                }
+                words[w] = KcdcSelection::Pack(flags);
+            }
+        });
+    }
+
+    /// @brief Append the values of the rows of sel in from to to
+    template <typename T>
+    static void CopyRows(const KcdcSelection& sel, const std::vector<T>& from, std::vector<T>& to)
+    {
+        if (from.empty()) return;
+        sel.ForEach([&](uint64_t row) { to.push_back(from[row]); });
+    }
+
+    Column m_columns[STORE_COLUMN_COUNT];
+    uint64_t m_rows;
+    uint32_t m_threads;
+    std::string m_inputHeader;
+    std::string m_error;
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcEventStore_h_
@@ -0,0 +1,232 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcFormatter.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Fixed width output formatting for AddFields
+///
+///  @details Same text as the iostream setw/fixed/setprecision insertions, via std::to_chars.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcFormatter_h_
+#define _Csi_KcdcFormatter_h_
+#include <charconv>
+#include <cstring>
+#include <ostream>
+#include <string_view>
+#include <vector>
+#include <inttypes.h>
+#include "KcdcRecord.h"
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief Growable byte buffer with right aligned fixed width number formatting
+class KcdcOutputBuffer
+{
+public:
+    static const size_t s_defaultCapacity = 4 << 20;
+
+    explicit KcdcOutputBuffer(size_t capacity = s_defaultCapacity) : m_size(0) { m_data.resize(capacity); }
+
+    const char* GetData() const { return m_data.data(); }
+    size_t GetSize() const { return m_size; }
+    size_t GetCapacity() const { return m_data.size(); }
+    void Clear() { m_size = 0; }
+
+    ///@brief True when the buffer is close to its capacity and should be flushed
+    bool IsFull() const { return m_size + s_maxField >= m_data.size(); }
+
+    ///@brief Write the buffer contents to os and clear it
+    void Flush(std::ostream& os)
+    {
+        if (m_size > 0) os.write(m_data.data(), m_size);
+        m_size = 0;
+    }
+
+    void Append(char c)
+    {
+        Reserve(1);
+        m_data[m_size++] = c;
+    }
+
+    void Append(std::string_view s)
+    {
+        Reserve(s.size());
+        memcpy(m_data.data() + m_size, s.data(), s.size());
+        m_size += s.size();
+    }
+
+    ///@brief Append s right aligned in a field of width characters (setw(width) << right << s)
+    void Append(std::string_view s, uint32_t width)
+    {
+        if (s.size() < width)
+        {
+            Reserve(width);
+            memset(m_data.data() + m_size, ' ', width - s.size());
+            m_size += width - s.size();
+        }
+        Append(s);
+    }
+
+    ///@brief Append value right aligned in width characters with precision decimals
+    void AppendFixed(double value, uint32_t width, uint32_t precision)
+    {
+        Reserve(s_maxField + width);
+        char* begin = m_data.data() + m_size;
+        std::to_chars_result res = std::to_chars(begin, begin + s_maxField, value, std::chars_format::fixed, precision);
+        Pad(begin, res.ptr, width);
+    }
+
+    ///@brief Append an integer right aligned in width characters
+    template <typename T>
+    void AppendInteger(T value, uint32_t width)
+    {
+        Reserve(s_maxField + width);
+        char* begin = m_data.data() + m_size;
+        std::to_chars_result res = std::to_chars(begin, begin + s_maxField, value);
+        Pad(begin, res.ptr, width);
+    }
+
+protected:
+    /// A fixed double with up to 17 decimals needs at most 309+1+1+17 characters
+    static const size_t s_maxField = 352;
+
+    void Reserve(size_t n)
+    {
+        if (m_size + n > m_data.size()) m_data.resize(2*(m_size + n));
+    }
+
+    /// @brief Shift the digits in [begin,end) right so the field is width characters wide
+    void Pad(char* begin, char* end, uint32_t width)
+    {
+        size_t len = end - begin;
+        if (len < width)
+        {
+            memmove(begin + (width - len), begin, len);
+            memset(begin, ' ', width - len);
+            len = width;
+        }
+        m_size += len;
+    }
+
+    std::vector<char> m_data;
+    size_t m_size;
+};
+
+///@brief Writes AddFields header and data lines in the fixed column layout
+class KcdcRecordFormatter
+{
+public:
+    ///@brief Append the input header line followed by the derived column names
+    ///@param sources Add the SOURCES column of a region catalog
+    static void AppendHeader(KcdcOutputBuffer& out, std::string_view inputHeader, bool sources=false)
+    {
+        out.Append(inputHeader);
+        out.Append("RA", 12);
+        out.Append("DEC", 12);
+        out.Append("LON", 12);
+        out.Append("LAT", 12);
+        out.Append("JDAYS", 20);
+        out.Append("DIST", 12);
+        if (sources) out.Append("SOURCES", 12);
+        out.Append('\n');
+    }
+
+    ///@brief Append the header line of a KCDC input file (as downloaded, with a trailing space)
+    static void AppendInputHeader(KcdcOutputBuffer& out)
+    {
+        for (uint32_t f=0; f<FIELD_COUNT; ++f) out.Append(GetFieldName(f), f==FIELD_E ? 11 : 12);
+        out.Append(" \n");
+    }
+
+    ///@brief Append a KCDC input data line: the input columns of rec and a trailing space
+    static void AppendInputRecord(KcdcOutputBuffer& out, const KcdcRecord& rec)
+    {
+        AppendInputFields(out, rec);
+        out.Append(" \n");
+    }
+
+    ///@brief Append one data line
+    static void AppendRecord(KcdcOutputBuffer& out, const KcdcRecord& rec, const KcdcDerived& d)
+    {
+        AppendInputFields(out, rec);
+        AppendDerivedFields(out, d);
+        out.Append('\n');
+    }
+
+    ///@brief Append one data line with a SOURCES column, the comma separated source ids
+    static void AppendRecord(KcdcOutputBuffer& out, const KcdcRecord& rec, const KcdcDerived& d, std::string_view sources)
+    {
+        AppendInputFields(out, rec);
+        AppendDerivedFields(out, d);
+        out.Append(' ');
+        out.Append(sources, 11);
+        out.Append('\n');
+    }
+
+protected:
+    static void AppendInputFields(KcdcOutputBuffer& out, const KcdcRecord& rec)
+    {
+        out.AppendFixed(rec.e, 11, 4);
+        out.AppendFixed(rec.yc, 12, 4);
+        out.AppendFixed(rec.xc, 12, 4);
+        out.AppendFixed(rec.ze, 12, 4);
+        out.AppendFixed(rec.az, 12, 4);
+        out.AppendFixed(rec.ne, 12, 4);
+        out.AppendFixed(rec.nmu, 12, 4);
+        out.AppendFixed(rec.esumhad, 12, 4);
+        out.AppendInteger(rec.nhad, 12);
+        out.AppendFixed(rec.t, 12, 4);
+        out.AppendFixed(rec.p, 12, 4);
+        out.AppendInteger(rec.gt, 12);
+        out.AppendInteger(rec.mt, 12);
+        out.AppendInteger(rec.ymd, 12);
+        out.AppendInteger(rec.hms, 12);
+        out.AppendInteger(rec.r, 12);
+        out.AppendInteger(rec.ev, 12);
+        out.AppendFixed(rec.age, 12, 4);
+    }
+
+    static void AppendDerivedFields(KcdcOutputBuffer& out, const KcdcDerived& d)
+    {
+        out.AppendFixed(d.ra, 13, 4);
+        out.AppendFixed(d.dec, 12, 4);
+        out.AppendFixed(d.lon, 12, 4);
+        out.AppendFixed(d.lat, 12, 4);
+        out.AppendFixed(d.jdays, 20, 6);
+        out.AppendFixed(d.dist, 12, 4);
+    }
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcFormatter_h_
@@ -0,0 +1,211 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcGenerator.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Synthetic KCDC event generator
+///
+///  @details Power law energies, sin(z)cos(z) zenith angles and exponential arrival times for benchmarks.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcGenerator_h_
+#define _Csi_KcdcGenerator_h_
+#include <cmath>
+#include <string>
+#include <inttypes.h>
+#include "KcdcCompression.h"
+#include "KcdcConstants.h"
+#include "KcdcFormatter.h"
+#include "KcdcRandom.h"
+#include "KcdcRecord.h"
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief Generates synthetic KcdcRecords in time order
+class KcdcEventGenerator
+{
+public:
+    explicit KcdcEventGenerator(uint64_t seed=1)
+    : m_seed(seed), m_startYmd(19980702), m_startHms(140000), m_rate(3.5), m_emin(14.5), m_index(2.7),
+      m_maxZenith(40.0)
+    {
+        Reset();
+    }
+
+    ///@brief Date and time (UTC) of the first event, as YMD and HMS
+    void SetStart(uint64_t ymd, uint64_t hms)
+    {
+        m_startYmd = ymd;
+        m_startHms = hms;
+        Reset();
+    }
+
+    ///@brief Mean number of events per second (default 3.5)
+    void SetRate(double eventsPerSecond) { m_rate = eventsPerSecond; }
+
+    ///@brief Energy spectrum dN/dE ~ E^-index above E = emin (log10 of the energy in eV)
+    void SetSpectrum(double emin, double index)
+    {
+        m_emin = emin;
+        m_index = index;
+    }
+
+    ///@brief Largest zenith angle in degrees (default 40)
+    void SetMaxZenith(double zenith) { m_maxZenith = zenith; }
+
+    ///@brief Start again with the first event
+    void Reset()
+    {
+        m_count = 0;
+        m_time = (double)GetDays(m_startYmd)*86400.0 + (m_startHms/10000)*3600.0 + (m_startHms/100%100)*60.0 + m_startHms%100;
+        m_run = 1000;
+        m_runStart = m_time;
+        m_event = 10000;
+    }
+
+    ///@brief Number of records generated since the start
+    uint64_t GetCount() const { return m_count; }
+
+    ///@brief Generate the next record
+    void Next(KcdcRecord& rec)
+    {
+        using namespace DataConstants;
+        EventRandomStream random(m_seed, 0, m_count++);
+        m_time += -log(1.0 - random.NextDouble())/m_rate;
+        if (m_time - m_runStart >= s_runLength)
+        {
+            ++m_run;
+            m_runStart = m_time;
+            m_event = 10000;
+        }
+        const double u = 1.0 - random.NextDouble();     // (0, 1]
+        rec.e = m_emin - log10(u)/(m_index - 1.0);
+        // sin(z)cos(z) dz: cos^2(z) is uniform
+        const double c2 = cos(m_maxZenith*DEG2RAD);
+        rec.ze = acos(sqrt(c2*c2 + (1.0 - c2*c2)*random.NextDouble()))*RAD2DEG;
+        rec.az = 360.0*random.NextDouble();
+        rec.yc = 180.0*random.NextDouble() - 90.0;
+        rec.xc = 180.0*random.NextDouble() - 90.0;
+        rec.ne = 0.9*rec.e - 8.1 + 0.15*Gaussian(random);
+        rec.nmu = 0.8*rec.e - 8.2 + 0.12*Gaussian(random);
+        rec.esumhad = -1.0;
+        rec.nhad = random.NextIndex(4) == 0 ? (int64_t)random.NextIndex(20) : -1;
+        // daily weather cycle
+        const double day = fmod(m_time, 86400.0)/86400.0;
+        rec.t = 15.0 + 6.0*sin(2.0*M_PI*(day - 0.375)) + 0.5*Gaussian(random);
+        rec.p = 1003.0 + 4.0*cos(2.0*M_PI*m_time/(7.0*86400.0)) + 0.2*Gaussian(random);
+        const int64_t seconds = (int64_t)floor(m_time);
+        rec.gt = seconds - s_unixEpochDays*86400;
+        rec.mt = (uint64_t)((m_time - seconds)*1e9);
+        rec.ymd = GetYmd(seconds/86400);
+        rec.hms = (seconds%86400/3600)*10000 + (seconds%3600/60)*100 + seconds%60;
+        rec.r = m_run;
+        rec.ev = m_event++;
+        rec.age = 1.1 + 0.12*Gaussian(random);
+    }
+
+    ///@brief Write a KCDC input file of n records, compressed if fname ends in .gz or .zst
+    ///@return false if the file cannot be written
+    bool WriteFile(const std::string& fname, uint64_t n)
+    {
+        KcdcOutputFile out;
+        if (!out.Open(fname)) return false;
+        KcdcOutputBuffer buffer;
+        KcdcRecordFormatter::AppendInputHeader(buffer);
+        KcdcRecord rec;
+        for (uint64_t i=0; i<n; ++i)
+        {
+            Next(rec);
+            KcdcRecordFormatter::AppendInputRecord(buffer, rec);
+            if (buffer.IsFull())
+            {
+                out.Write(buffer.GetData(), buffer.GetSize());
+                buffer.Clear();
+            }
+        }
+        out.Write(buffer.GetData(), buffer.GetSize());
+        return out.Close();
+    }
+
+    ///@brief Days since 0000-03-01 of a YMD date (proleptic Gregorian calendar)
+    static int64_t GetDays(uint64_t ymd)
+    {
+        int64_t y = ymd/10000, m = ymd/100%100, d = ymd%100;
+        if (m <= 2) --y;
+        int64_t era = (y >= 0 ? y : y - 399)/400;
+        int64_t yoe = y - era*400;
+        int64_t doy = (153*(m > 2 ? m - 3 : m + 9) + 2)/5 + d - 1;
+        int64_t doe = yoe*365 + yoe/4 - yoe/100 + doy;
+        return era*146097 + doe;
+    }
+
+    ///@brief YMD date of a day number of GetDays
+    static uint64_t GetYmd(int64_t days)
+    {
+        int64_t era = (days >= 0 ? days : days - 146096)/146097;
+        int64_t doe = days - era*146097;
+        int64_t yoe = (doe - doe/1460 + doe/36524 - doe/146096)/365;
+        int64_t doy = doe - (365*yoe + yoe/4 - yoe/100);
+        int64_t mp = (5*doy + 2)/153;
+        int64_t d = doy - (153*mp + 2)/5 + 1;
+        int64_t m = mp < 10 ? mp + 3 : mp - 9;
+        int64_t y = yoe + era*400 + (m <= 2);
+        return y*10000 + m*100 + d;
+    }
+
+protected:
+    static double Gaussian(EventRandomStream& random)
+    {
+        const double u = 1.0 - random.NextDouble();
+        return sqrt(-2.0*log(u))*cos(2.0*M_PI*random.NextDouble());
+    }
+
+    static constexpr double s_runLength = 8*3600.0;     ///< seconds per run number
+    static const int64_t s_unixEpochDays = 719468;      ///< GetDays(19700101)
+
+    uint64_t m_seed;
+    uint64_t m_startYmd;
+    uint64_t m_startHms;
+    double m_rate;
+    double m_emin;
+    double m_index;
+    double m_maxZenith;
+    uint64_t m_count;
+    double m_time;          ///< seconds since day 0 of GetDays
+    uint64_t m_run;
+    double m_runStart;
+    uint64_t m_event;
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcGenerator_h_
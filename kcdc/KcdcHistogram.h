@@ -0,0 +1,208 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcHistogram.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Equatorial sky map of event counts
+///
+///  @details Square RA/Dec bins, clamped to the map, mergeable when the binning is the same.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcHistogram_h_
+#define _Csi_KcdcHistogram_h_
+#include <cmath>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <inttypes.h>
+#include "KcdcFormatter.h"
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief RA/Dec histogram; Count is the counter type, e.g. uint32_t to halve the memory
+template <typename Count = uint64_t>
+class SkyHistogram
+{
+public:
+    SkyHistogram(double binSize=0.5, double raMin=-180.0, double raMax=180.0, double decMin=-90.0, double decMax=90.0)
+    : m_binSize(binSize), m_invBinSize(1.0/binSize), m_raMin(raMin), m_decMin(decMin),
+      m_raBins(GetBinCount(raMin, raMax, binSize)), m_decBins(GetBinCount(decMin, decMax, binSize)),
+      m_data(m_raBins*m_decBins, 0), m_outOfRange(0) {}
+
+    double GetBinSize() const { return m_binSize; }
+    double GetRaMin() const { return m_raMin; }
+    double GetDecMin() const { return m_decMin; }
+    uint32_t GetRaBins() const { return m_raBins; }
+    uint32_t GetDecBins() const { return m_decBins; }
+
+    ///@brief Number of entries that fell outside the map and were put into the nearest bin
+    uint64_t GetOutOfRange() const { return m_outOfRange; }
+
+    ///@brief Count of bin (decIdx, raIdx)
+    Count& operator()(uint32_t decIdx, uint32_t raIdx) { return m_data[(size_t)decIdx*m_raBins + raIdx]; }
+    Count operator()(uint32_t decIdx, uint32_t raIdx) const { return m_data[(size_t)decIdx*m_raBins + raIdx]; }
+
+    const Count* GetData() const { return m_data.data(); }
+
+    ///@brief Sum of all bins
+    uint64_t GetTotal() const
+    {
+        uint64_t total(0);
+        for (size_t i=0; i<m_data.size(); ++i) total += m_data[i];
+        return total;
+    }
+
+    ///@brief Replace all counts (GetData() order) and the out of range count, e.g. with those
+    /// saved in a KcdcCheckpoint
+    ///@return false, leaving the histogram unchanged, if counts does not have a count per bin
+    template <typename T>
+    bool Assign(const std::vector<T>& counts, uint64_t outOfRange)
+    {
+        if (counts.size() != m_data.size()) return false;
+        for (size_t i=0; i<m_data.size(); ++i) m_data[i] = counts[i];
+        m_outOfRange = outOfRange;
+        return true;
+    }
+
+    void Clear()
+    {
+        std::fill(m_data.begin(), m_data.end(), Count(0));
+        m_outOfRange = 0;
+    }
+
+    ///@brief Index into GetData() of the bin of (ra, dec), clamped to the map
+    size_t GetBin(double ra, double dec)
+    {
+        bool inside(true);
+        size_t bin = GetIndex(dec, m_decMin, m_decBins, inside)*m_raBins + GetIndex(ra, m_raMin, m_raBins, inside);
+        m_outOfRange += !inside;
+        return bin;
+    }
+
+    ///@brief Count one event
+    void Fill(double ra, double dec) { ++m_data[GetBin(ra, dec)]; }
+
+    ///@brief Count n events
+    void Fill(size_t n, const double* ra, const double* dec)
+    {
+        static const size_t block = 256;
+        size_t bins[block];
+        for (size_t begin=0; begin<n; begin+=block)
+        {
+            size_t count = n - begin < block ? n - begin : block;
+            for (size_t i=0; i<count; ++i) bins[i] = GetBin(ra[begin+i], dec[begin+i]);
+            for (size_t i=0; i<count; ++i) ++m_data[bins[i]];
+        }
+    }
+
+    ///@brief True if rhs has the same binning
+    bool IsCompatible(const SkyHistogram& rhs) const
+    {
+        return m_binSize==rhs.m_binSize && m_raMin==rhs.m_raMin && m_decMin==rhs.m_decMin &&
+               m_raBins==rhs.m_raBins && m_decBins==rhs.m_decBins;
+    }
+
+    ///@brief Add the counts of rhs
+    ///@return false, leaving this histogram unchanged, if the binning differs
+    template <typename RhsCount>
+    bool Merge(const SkyHistogram<RhsCount>& rhs)
+    {
+        if (m_binSize!=rhs.GetBinSize() || m_raMin!=rhs.GetRaMin() || m_decMin!=rhs.GetDecMin() ||
+            m_raBins!=rhs.GetRaBins() || m_decBins!=rhs.GetDecBins()) return false;
+        const RhsCount* data = rhs.GetData();
+        for (size_t i=0; i<m_data.size(); ++i) m_data[i] += data[i];
+        m_outOfRange += rhs.GetOutOfRange();
+        return true;
+    }
+
+    ///@brief Write the counts as text, highest Dec row first
+    void Write(std::ostream& os) const
+    {
+        KcdcOutputBuffer out(1 << 20);
+        for (int64_t i=m_decBins-1; i>=0; --i)
+        {
+            for (uint32_t j=0; j<m_raBins; ++j)
+            {
+                out.AppendInteger((*this)(i,j), 0);
+                out.Append(' ');
+            }
+            out.Append('\n');
+            if (out.IsFull()) out.Flush(os);
+        }
+        out.Flush(os);
+    }
+
+    ///@brief Read counts written by Write into a histogram of the same binning
+    ///@return false if the input ends early or holds something other than counts
+    bool Read(std::istream& is)
+    {
+        for (int64_t i=m_decBins-1; i>=0; --i)
+        {
+            for (uint32_t j=0; j<m_raBins; ++j)
+            {
+                if (!(is >> (*this)(i,j))) return false;
+            }
+        }
+        return true;
+    }
+
+protected:
+    static uint32_t GetBinCount(double min, double max, double binSize)
+    {
+        double n = std::ceil((max - min)/binSize - 1e-9);
+        return n > 0.0 ? (uint32_t)n : 1;
+    }
+
+    /// @brief Bin index of x along an axis of n bins starting at min, clamped to [0, n-1]
+    size_t GetIndex(double x, double min, uint32_t n, bool& inside) const
+    {
+        double t = (x - min)*m_invBinSize;
+        inside &= (t >= 0.0) & (t < (double)n);            // false for NaN as well
+        double hi = n - 1;
+        t = t > 0.0 ? t : 0.0;
+        t = t < hi ? t : hi;
+        return (size_t)t;
+    }
+
+    double m_binSize;
+    double m_invBinSize;
+    double m_raMin;
+    double m_decMin;
+    uint32_t m_raBins;
+    uint32_t m_decBins;
+    std::vector<Count> m_data;
+    uint64_t m_outOfRange;
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcHistogram_h_
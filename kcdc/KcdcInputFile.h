@@ -0,0 +1,336 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcInputFile.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Line reader for large KCDC input files
+///
+///  @details Regular files are memory mapped; pipes fall back to large buffered reads.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcInputFile_h_
+#define _Csi_KcdcInputFile_h_
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "KcdcCompression.h"
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief Sequential line reader over a memory mapped (or buffered) input file
+/// (GetLine views stay valid until Close() for a mapped file, else until the next GetLine)
+class KcdcInputFile
+{
+public:
+    KcdcInputFile()
+    : m_fd(-1), m_map(0), m_size(0), m_pos(0), m_limit(0), m_rangeBegin(0), m_begin(0), m_end(0), m_offset(0), m_eof(false),
+      m_compression(COMPRESSION_NONE)
+    {}
+    ~KcdcInputFile() { Close(); }
+
+    ///@brief Open fname for reading; "-" reads standard input
+    ///@return false if the file cannot be opened
+    bool Open(const std::string& fname)
+    {
+        Close();
+        m_fd = (fname == "-") ? dup(STDIN_FILENO) : open(fname.c_str(), O_RDONLY);
+        if (m_fd < 0) return false;
+        struct stat st;
+        bool regular = fstat(m_fd, &st)==0 && S_ISREG(st.st_mode);
+        if (regular)
+        {
+            unsigned char magic[4];
+            ssize_t n = pread(m_fd, magic, sizeof(magic), 0);
+            m_compression = GetCompressionFromMagic(magic, n > 0 ? n : 0);
+        }
+        else m_compression = GetCompressionFromName(fname);
+        if (m_compression != COMPRESSION_NONE)
+        {
+            // the decompressor owns the descriptor from here on
+            int fd = m_fd;
+            m_fd = -1;
+            if (!m_decompressor.Start(fd, m_compression)) return false;
+            m_buffer.resize(s_blockSize);
+            return true;
+        }
+        if (regular)
+        {
+            m_size = st.st_size;
+            if (m_size == 0)
+            {
+                m_eof = true;
+                return true;
+            }
+            void* p = mmap(0, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+            if (p != MAP_FAILED)
+            {
+                m_map = static_cast<const char*>(p);
+                m_limit = m_size;
+                madvise(p, m_size, MADV_SEQUENTIAL);
+                return true;
+            }
+            m_size = 0;
+        }
+        // not mappable; read in large blocks
+        m_buffer.resize(s_blockSize);
+        return true;
+    }
+
+    ///@brief Unmap and close the input
+    void Close()
+    {
+        if (m_map) munmap(const_cast<char*>(m_map), m_size);
+        m_decompressor.Stop();
+        if (m_fd >= 0) close(m_fd);
+        m_fd = -1;
+        m_compression = COMPRESSION_NONE;
+        m_map = 0;
+        m_size = m_pos = m_limit = m_rangeBegin = m_begin = m_end = m_offset = 0;
+        m_eof = false;
+        m_error.clear();
+        std::vector<char>().swap(m_buffer);
+    }
+
+    bool IsOpen() const { return m_fd >= 0 || m_compression != COMPRESSION_NONE; }
+
+    ///@brief True if the input is memory mapped rather than read through a buffer
+    bool IsMapped() const { return m_map != 0; }
+
+    ///@brief Compression of the input file
+    Compression GetCompression() const { return m_compression; }
+
+    ///@brief Description of a read or decompression error once the input has ended; empty if
+    /// the whole input was read
+    std::string GetError() const { return m_error; }
+
+    ///@brief Number of input bytes consumed so far (decompressed bytes for compressed input),
+    /// from the start of the range for SetRange
+    uint64_t GetOffset() const { return m_map ? m_pos - m_rangeBegin : m_offset; }
+
+    ///@brief Byte offset in the (decompressed) input of the next line
+    uint64_t GetPosition() const { return m_map ? m_pos : m_offset; }
+
+    ///@brief Size of a mapped input; 0 if it is not mapped
+    size_t GetSize() const { return m_map ? m_size : 0; }
+
+    ///@brief Offset of the first line of a mapped input that starts at or after offset, or
+    /// GetSize() if there is none
+    size_t FindLineStart(size_t offset) const
+    {
+        if (offset == 0 || !m_map) return 0;
+        if (offset >= m_size) return m_size;
+        if (m_map[offset-1] == '\n') return offset;
+        const char* nl = static_cast<const char*>(memchr(m_map + offset, '\n', m_size - offset));
+        return nl ? nl - m_map + 1 : m_size;
+    }
+
+    ///@brief Read only [begin, end) of a mapped input from here on; begin and end should be
+    /// line starts (FindLineStart)
+    ///@return false if the input is not mapped
+    bool SetRange(size_t begin, size_t end)
+    {
+        if (!m_map) return false;
+        m_limit = end < m_size ? end : m_size;
+        m_pos = m_rangeBegin = begin < m_limit ? begin : m_limit;
+        return true;
+    }
+
+    ///@brief Continue reading at position (GetPosition), which should be a line start
+    ///@return false if the input (or its SetRange range) ends before position
+    bool SkipTo(uint64_t position)
+    {
+        if (m_map)
+        {
+            if (position < m_rangeBegin || position > m_limit) return false;
+            m_pos = position;
+            return true;
+        }
+        if (!IsOpen() || position < m_offset) return false;
+        while (m_offset < position)
+        {
+            if (m_begin == m_end)
+            {
+                if (m_eof) return false;
+                Fill();
+                continue;
+            }
+            uint64_t n = m_end - m_begin;
+            if (n > position - m_offset) n = position - m_offset;
+            m_begin += n;
+            m_offset += n;
+        }
+        return true;
+    }
+
+    ///@brief Get the next line, without its '\n'
+    ///@return false at end of input
+    bool GetLine(std::string_view& line)
+    {
+        if (m_map)
+        {
+            if (m_pos >= m_limit) return false;
+            const char* begin = m_map + m_pos;
+            const char* nl = static_cast<const char*>(memchr(begin, '\n', m_limit - m_pos));
+            size_t len = nl ? nl - begin : m_limit - m_pos;
+            line = std::string_view(begin, len);
+            m_pos += nl ? len + 1 : len;
+            return true;
+        }
+        return GetBufferedLine(line);
+    }
+
+    ///@brief Get a block of whole lines of about maxBytes (longer if a single line is longer)
+    ///@return false at end of input
+    bool GetChunk(size_t maxBytes, std::string_view& chunk)
+    {
+        if (m_map)
+        {
+            if (m_pos >= m_limit) return false;
+            size_t len = FindChunkEnd(m_map + m_pos, m_limit - m_pos, maxBytes, true);
+            chunk = std::string_view(m_map + m_pos, len);
+            m_pos += len;
+            return true;
+        }
+        if (!IsOpen()) return false;
+        for (;;)
+        {
+            if (m_begin == m_end && m_eof) return false;
+            if (m_eof || m_end - m_begin > maxBytes)
+            {
+                size_t len = FindChunkEnd(m_buffer.data() + m_begin, m_end - m_begin, maxBytes, m_eof);
+                if (len > 0)
+                {
+                    chunk = std::string_view(m_buffer.data() + m_begin, len);
+                    m_begin += len;
+                    m_offset += len;
+                    return true;
+                }
+            }
+            Fill();
+        }
+    }
+
+protected:
+    /// @brief Length of the chunk of whole lines starting at data
+    static size_t FindChunkEnd(const char* data, size_t size, size_t maxBytes, bool atEnd)
+    {
+        if (size <= maxBytes && atEnd) return size;
+        size_t window = size < maxBytes ? size : maxBytes;
+        const char* nl = static_cast<const char*>(memrchr(data, '\n', window));
+        if (!nl) nl = static_cast<const char*>(memchr(data + window, '\n', size - window));
+        if (nl) return nl - data + 1;
+        return atEnd ? size : 0;
+    }
+
+    bool GetBufferedLine(std::string_view& line)
+    {
+        if (!IsOpen()) return false;
+        for (;;)
+        {
+            if (m_begin == m_end && m_eof) return false;
+            const char* begin = m_buffer.data() + m_begin;
+            const char* nl = static_cast<const char*>(memchr(begin, '\n', m_end - m_begin));
+            if (nl)
+            {
+                size_t len = nl - begin;
+                line = std::string_view(begin, len);
+                m_begin += len + 1;
+                m_offset += len + 1;
+                return true;
+            }
+            if (m_eof)
+            {
+                line = std::string_view(begin, m_end - m_begin);
+                m_offset += m_end - m_begin;
+                m_begin = m_end;
+                return true;
+            }
+            Fill();
+        }
+    }
+
+    /// @brief Move the partial line to the front of the buffer and read more behind it
+    void Fill()
+    {
+        if (m_begin > 0)
+        {
+            memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+            m_end -= m_begin;
+            m_begin = 0;
+        }
+        if (m_end == m_buffer.size()) m_buffer.resize(m_buffer.size()*2);   // line longer than the buffer
+        ssize_t n;
+        if (m_compression != COMPRESSION_NONE)
+        {
+            n = m_decompressor.Read(m_buffer.data() + m_end, m_buffer.size() - m_end);
+            if (n == 0) m_error = m_decompressor.GetError();
+        }
+        else
+        {
+            do
+            {
+                n = read(m_fd, m_buffer.data() + m_end, m_buffer.size() - m_end);
+            } while (n < 0 && errno == EINTR);
+            if (n < 0) m_error = strerror(errno);
+        }
+        if (n <= 0) m_eof = true;
+        else m_end += n;
+    }
+
+    static const size_t s_blockSize = 4 << 20;
+
+    int m_fd;
+    const char* m_map;
+    size_t m_size;              ///< size of the mapping
+    size_t m_pos;               ///< read position in the mapping
+    size_t m_limit;             ///< end of the mapping, or of the SetRange range
+    size_t m_rangeBegin;        ///< start of the SetRange range
+    std::vector<char> m_buffer; ///< buffer for non-mappable input
+    size_t m_begin;             ///< start of unread data in m_buffer
+    size_t m_end;               ///< end of valid data in m_buffer
+    uint64_t m_offset;          ///< bytes consumed from non-mappable input
+    bool m_eof;
+    Compression m_compression;
+    KcdcDecompressor m_decompressor;
+    std::string m_error;
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcInputFile_h_
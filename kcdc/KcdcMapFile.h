@@ -0,0 +1,342 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcMapFile.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Binary file format of ProcessEventStats sky maps
+///
+///  @details A header with binning and band, then the counts dense or as sparse varint pairs.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcMapFile_h_
+#define _Csi_KcdcMapFile_h_
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <inttypes.h>
+#include "KcdcHistogram.h"
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief File format of the ProcessEventStats maps
+enum MapFormat
+{
+    MAP_FORMAT_TEXT = 0,    ///< name.nreal.dat: text counts, highest Dec row first
+    MAP_FORMAT_DENSE,       ///< name.nreal.map: KcdcMapFile with all counts
+    MAP_FORMAT_SPARSE,      ///< name.nreal.map: KcdcMapFile with the non zero counts only
+    MAP_FORMAT_BINARY       ///< name.nreal.map: dense or sparse, whichever is smaller
+};
+
+///@brief A sky map with its binning and band, and the binary file it is written to
+struct KcdcMapFile
+{
+    enum Kind { KIND_UNKNOWN = 0, KIND_REAL, KIND_FAKE };
+    enum Encoding { ENCODING_DENSE = 0, ENCODING_SPARSE };
+
+    KcdcMapFile() : kind(KIND_UNKNOWN), emin(0.0), emax(0.0), oversampling(0), binSize(0.0), raMin(0.0), decMin(0.0),
+                    raBins(0), decBins(0), outOfRange(0) {}
+
+    std::string name;           ///< band name
+    uint32_t kind;              ///< Kind
+    double emin;                ///< band energy range
+    double emax;
+    uint32_t oversampling;      ///< fake events per real event of the run
+    double binSize;
+    double raMin;
+    double decMin;
+    uint32_t raBins;
+    uint32_t decBins;
+    uint64_t outOfRange;        ///< entries put into the edge bins
+    std::vector<uint64_t> counts;
+
+    ///@brief Take the binning and counts of map
+    template <typename Count>
+    void SetMap(const SkyHistogram<Count>& map)
+    {
+        binSize = map.GetBinSize();
+        raMin = map.GetRaMin();
+        decMin = map.GetDecMin();
+        raBins = map.GetRaBins();
+        decBins = map.GetDecBins();
+        outOfRange = map.GetOutOfRange();
+        counts.assign(map.GetData(), map.GetData() + (size_t)raBins*decBins);
+    }
+
+    ///@brief Replace map with a histogram of this binning and these counts
+    template <typename Count>
+    bool GetMap(SkyHistogram<Count>& map) const
+    {
+        SkyHistogram<Count> h(binSize, raMin, raMin + raBins*binSize, decMin, decMin + decBins*binSize);
+        if (h.GetRaBins() != raBins || h.GetDecBins() != decBins || !h.Assign(counts, outOfRange)) return false;
+        map = h;
+        return true;
+    }
+
+    ///@brief True if rhs has the same binning
+    bool IsCompatible(const KcdcMapFile& rhs) const
+    {
+        return binSize == rhs.binSize && raMin == rhs.raMin && decMin == rhs.decMin &&
+               raBins == rhs.raBins && decBins == rhs.decBins;
+    }
+
+    ///@brief Add the counts of rhs
+    ///@return false, leaving this map unchanged, if the binning differs
+    bool Merge(const KcdcMapFile& rhs)
+    {
+        if (!IsCompatible(rhs) || counts.size() != rhs.counts.size()) return false;
+        for (size_t i=0; i<counts.size(); ++i) counts[i] += rhs.counts[i];
+        outOfRange += rhs.outOfRange;
+        return true;
+    }
+
+    uint64_t GetTotal() const
+    {
+        uint64_t total(0);
+        for (size_t i=0; i<counts.size(); ++i) total += counts[i];
+        return total;
+    }
+
+    uint64_t GetNonZero() const
+    {
+        uint64_t n(0);
+        for (size_t i=0; i<counts.size(); ++i) n += counts[i] != 0;
+        return n;
+    }
+
+    ///@brief Encoding MAP_FORMAT_BINARY writes, the one with the smaller file
+    Encoding GetSmallerEncoding() const
+    {
+        size_t sparse(0);
+        uint64_t zeros(0);
+        for (size_t i=0; i<counts.size(); ++i)
+        {
+            if (counts[i] == 0)
+            {
+                ++zeros;
+                continue;
+            }
+            sparse += GetVarintSize(zeros) + GetVarintSize(counts[i]);
+            zeros = 0;
+        }
+        return sparse < counts.size()*sizeof(uint64_t) ? ENCODING_SPARSE : ENCODING_DENSE;
+    }
+
+    ///@brief Name of the file of a map: name.nreal.dat with MAP_FORMAT_TEXT, else name.nreal.map
+    static std::string GetFileName(const std::string& name, Kind kind, MapFormat format)
+    {
+        return name + (kind == KIND_FAKE ? ".nfake" : ".nreal") + (format == MAP_FORMAT_TEXT ? ".dat" : ".map");
+    }
+
+    ///@brief True if fname starts like a map file
+    static bool IsMapFile(const std::string& fname)
+    {
+        std::ifstream is(fname.c_str(), std::ios::binary);
+        char magic[sizeof(s_magic)];
+        return is.read(magic, sizeof(magic)) && memcmp(magic, s_magic, sizeof(magic)) == 0;
+    }
+
+    ///@brief Write the map to fname
+    bool Write(const std::string& fname, Encoding encoding) const
+    {
+        std::string data(s_magic, sizeof(s_magic));
+        PutInt(data, s_version, 4);
+        PutInt(data, encoding, 4);
+        PutInt(data, kind, 4);
+        PutInt(data, oversampling, 4);
+        PutDouble(data, emin);
+        PutDouble(data, emax);
+        PutDouble(data, binSize);
+        PutDouble(data, raMin);
+        PutDouble(data, decMin);
+        PutInt(data, raBins, 4);
+        PutInt(data, decBins, 4);
+        PutInt(data, outOfRange, 8);
+        PutInt(data, GetTotal(), 8);
+        PutInt(data, GetNonZero(), 8);
+        PutInt(data, name.size(), 4);
+        data += name;
+        if (encoding == ENCODING_SPARSE)
+        {
+            uint64_t zeros(0);
+            for (size_t i=0; i<counts.size(); ++i)
+            {
+                if (counts[i] == 0)
+                {
+                    ++zeros;
+                    continue;
+                }
+                PutVarint(data, zeros);
+                PutVarint(data, counts[i]);
+                zeros = 0;
+            }
+        }
+        else
+        {
+            data.reserve(data.size() + counts.size()*sizeof(uint64_t));
+            for (size_t i=0; i<counts.size(); ++i) PutInt(data, counts[i], 8);
+        }
+        std::ofstream os(fname.c_str(), std::ios::binary | std::ios::trunc);
+        os.write(data.data(), data.size());
+        os.close();
+        return !os.fail();
+    }
+
+    ///@brief Read a map written by Write
+    ///@return false if fname cannot be read, is not a map file or is incomplete
+    bool Read(const std::string& fname)
+    {
+        std::ifstream is(fname.c_str(), std::ios::binary);
+        if (!is) return false;
+        const std::string data((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+        if (is.bad() || data.size() < sizeof(s_magic) || memcmp(data.data(), s_magic, sizeof(s_magic)) != 0) return false;
+        Reader in(data, sizeof(s_magic));
+        uint64_t version, encoding, total, nonZero, nameSize;
+        uint64_t values[6];
+        if (!in.GetInt(version, 4) || version != s_version || !in.GetInt(encoding, 4) ||
+            !in.GetInt(values[0], 4) || !in.GetInt(values[1], 4) ||
+            !in.GetDouble(emin) || !in.GetDouble(emax) || !in.GetDouble(binSize) || !in.GetDouble(raMin) || !in.GetDouble(decMin) ||
+            !in.GetInt(values[2], 4) || !in.GetInt(values[3], 4) || !in.GetInt(outOfRange, 8) ||
+            !in.GetInt(total, 8) || !in.GetInt(nonZero, 8) || !in.GetInt(nameSize, 4) || !in.GetString(name, nameSize)) return false;
+        kind = values[0];
+        oversampling = values[1];
+        raBins = values[2];
+        decBins = values[3];
+        const uint64_t bins = (uint64_t)raBins*decBins;
+        if (bins == 0 || bins > s_maxBins) return false;
+        counts.assign(bins, 0);
+        if (encoding == ENCODING_SPARSE)
+        {
+            uint64_t bin(0);
+            for (uint64_t k=0; k<nonZero; ++k)
+            {
+                uint64_t zeros, count;
+                if (!in.GetVarint(zeros) || !in.GetVarint(count) || zeros >= bins - bin || count == 0) return false;
+                bin += zeros;
+                counts[bin++] = count;
+            }
+        }
+        else if (encoding == ENCODING_DENSE)
+        {
+            for (uint64_t i=0; i<bins; ++i)
+            {
+                if (!in.GetInt(counts[i], 8)) return false;
+            }
+        }
+        else return false;
+        return in.IsAtEnd() && GetTotal() == total;
+    }
+
+protected:
+    static void PutInt(std::string& data, uint64_t value, uint32_t bytes)
+    {
+        for (uint32_t i=0; i<bytes; ++i) data += static_cast<char>((value >> (8*i)) & 0xff);
+    }
+
+    static void PutDouble(std::string& data, double value)
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        PutInt(data, bits, 8);
+    }
+
+    static void PutVarint(std::string& data, uint64_t value)
+    {
+        for (; value >= 0x80; value >>= 7) data += static_cast<char>((value & 0x7f) | 0x80);
+        data += static_cast<char>(value);
+    }
+
+    static size_t GetVarintSize(uint64_t value)
+    {
+        size_t n(1);
+        for (; value >= 0x80; value >>= 7) ++n;
+        return n;
+    }
+
+    ///@brief Bounds checked reads from the bytes of a file
+    class Reader
+    {
+    public:
+        Reader(const std::string& data, size_t pos) : m_data(data), m_pos(pos) {}
+
+        bool IsAtEnd() const { return m_pos == m_data.size(); }
+
+        bool GetInt(uint64_t& value, uint32_t bytes)
+        {
+            if (m_data.size() - m_pos < bytes) return false;
+            value = 0;
+            for (uint32_t i=0; i<bytes; ++i) value |= (uint64_t)(unsigned char)m_data[m_pos++] << (8*i);
+            return true;
+        }
+
+        bool GetDouble(double& value)
+        {
+            uint64_t bits;
+            if (!GetInt(bits, 8)) return false;
+            memcpy(&value, &bits, sizeof(value));
+            return true;
+        }
+
+        bool GetString(std::string& value, uint64_t size)
+        {
+            if (m_data.size() - m_pos < size) return false;
+            value.assign(m_data, m_pos, size);
+            m_pos += size;
+            return true;
+        }
+
+        bool GetVarint(uint64_t& value)
+        {
+            value = 0;
+            for (uint32_t shift=0; shift<64 && m_pos<m_data.size(); shift+=7)
+            {
+                const unsigned char c = m_data[m_pos++];
+                value |= (uint64_t)(c & 0x7f) << shift;
+                if (!(c & 0x80)) return true;
+            }
+            return false;
+        }
+
+    protected:
+        const std::string& m_data;
+        size_t m_pos;
+    };
+
+    static constexpr char s_magic[8] = {'K', 'C', 'D', 'C', 'M', 'A', 'P', '1'};
+    static constexpr uint32_t s_version = 1;
+    static constexpr uint64_t s_maxBins = 1ull << 32;      ///< sanity limit for a map read from a file
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcMapFile_h_
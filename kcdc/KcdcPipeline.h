@@ -0,0 +1,172 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcPipeline.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Ordered producer / worker pool / consumer pipeline
+///
+///  @details Worker threads process items in between an ordered reader and consumer.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcPipeline_h_
+#define _Csi_KcdcPipeline_h_
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <inttypes.h>
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief Number of threads to use for a requested count; 0 means one per hardware thread
+inline uint32_t GetThreadCount(uint32_t requested)
+{
+    if (requested > 0) return requested;
+    uint32_t n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+///@brief Run produce -> work -> consume over a sequence of items, consuming in order
+template <class Item, class Produce, class Work, class Consume>
+void RunOrderedPipeline(uint32_t threads, Produce produce, Work work, Consume consume)
+{
+    if (threads <= 1)
+    {
+        Item item;
+        while (produce(item))
+        {
+            work(item);
+            consume(item);
+        }
+        return;
+    }
+
+    enum SlotState { SLOT_FREE, SLOT_QUEUED, SLOT_DONE };
+    const size_t slots = 2*threads + 2;     // items in flight
+    std::vector<Item> items(slots);
+    std::vector<SlotState> state(slots, SLOT_FREE);
+    std::deque<size_t> queue;
+    bool finished(false);
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable itemDone;
+
+    std::vector<std::thread> pool;
+    for (uint32_t t=0; t<threads; ++t)
+    {
+        pool.push_back(std::thread([&]()
+        {
+            for (;;)
+            {
+                size_t slot;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    workReady.wait(lock, [&]() { return !queue.empty() || finished; });
+                    if (queue.empty()) return;
+                    slot = queue.front();
+                    queue.pop_front();
+                }
+                work(items[slot]);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    state[slot] = SLOT_DONE;
+                }
+                itemDone.notify_all();
+            }
+        }));
+    }
+
+    uint64_t produced(0), consumed(0);
+    bool more(true);
+    while (more || consumed < produced)
+    {
+        // keep every slot busy, then hand back the oldest item
+        while (more && produced - consumed < slots)
+        {
+            size_t slot = produced % slots;
+            if (!produce(items[slot]))
+            {
+                more = false;
+                break;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                state[slot] = SLOT_QUEUED;
+                queue.push_back(slot);
+            }
+            workReady.notify_one();
+            ++produced;
+        }
+        if (consumed < produced)
+        {
+            size_t slot = consumed % slots;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                itemDone.wait(lock, [&]() { return state[slot] == SLOT_DONE; });
+                state[slot] = SLOT_FREE;
+            }
+            consume(items[slot]);
+            ++consumed;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    workReady.notify_all();
+    for (size_t t=0; t<pool.size(); ++t) pool[t].join();
+}
+
+///@brief Split [0, n) into one contiguous range per thread and call work(thread, begin, end)
+template <class Work>
+void RunParallel(uint32_t threads, size_t n, Work work)
+{
+    if (threads <= 1)
+    {
+        work(0, 0, n);
+        return;
+    }
+    std::vector<std::thread> pool;
+    for (uint32_t t=0; t<threads; ++t)
+    {
+        size_t begin = n*t/threads;
+        size_t end = n*(t+1)/threads;
+        pool.push_back(std::thread([&work, t, begin, end]() { work(t, begin, end); }));
+    }
+    for (size_t t=0; t<pool.size(); ++t) pool[t].join();
+}
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcPipeline_h_
@@ -0,0 +1,262 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcProjection.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Hammer-Aitoff projection of event arrays and all-sky images
+///
+///  @details Hammer-Aitoff projection of positions into PGM and PFM sky images.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcProjection_h_
+#define _Csi_KcdcProjection_h_
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+#include <inttypes.h>
+#include "KcdcConstants.h"
+#include "KcdcPipeline.h"
+#include "KcdcSimd.h"
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief Hammer-Aitoff equal area projection, RA centered on 0
+class KcdcHammerAitoff
+{
+public:
+    ///@brief Project n positions (degrees, RA of any range) to x and y
+    static void Project(size_t n, const double* ra, const double* dec, double* x, double* y)
+    {
+        using namespace Simd;
+        const size_t full = n - n%SIMD_LANES;
+        for (size_t i=0; i<full; i+=SIMD_LANES) Kernel(ra+i, dec+i, x+i, y+i);
+        if (full < n)
+        {
+            // pad the tail to a full vector
+            double in[2][SIMD_LANES] = {{0.0}}, out[2][SIMD_LANES];
+            for (size_t i=full; i<n; ++i)
+            {
+                in[0][i-full] = ra[i];
+                in[1][i-full] = dec[i];
+            }
+            Kernel(in[0], in[1], out[0], out[1]);
+            for (size_t i=full; i<n; ++i)
+            {
+                x[i] = out[0][i-full];
+                y[i] = out[1][i-full];
+            }
+        }
+    }
+
+    ///@brief True if (x, y) is inside the projected sphere, the ellipse (x/180)^2 + (y/90)^2 <= 1
+    static bool IsInside(double x, double y) { return (x/180.0)*(x/180.0) + (y/90.0)*(y/90.0) <= 1.0; }
+
+    ///@brief Position (degrees, RA -180 to 180) of a point of the projection
+    ///@return false if (x, y) is outside the projected sphere
+    static bool Unproject(double x, double y, double& ra, double& dec)
+    {
+        using namespace Kcdc::DataConstants;
+        if (!IsInside(x, y)) return false;
+        // scaled to the unit sphere projection, x in +/-2 sqrt(2), y in +/-sqrt(2)
+        const double xs = x*M_SQRT2/90.0;
+        const double ys = y*M_SQRT2/90.0;
+        double zz = 1.0 - xs*xs/16.0 - ys*ys/4.0;
+        const double z = sqrt(zz > 0.0 ? zz : 0.0);
+        ra = 2.0*atan2(z*xs, 2.0*(2.0*z*z - 1.0))*RAD2DEG;
+        double s = z*ys;
+        dec = asin(s < -1.0 ? -1.0 : (s > 1.0 ? 1.0 : s))*RAD2DEG;
+        return true;
+    }
+
+protected:
+    static void Kernel(const double* ra, const double* dec, double* x, double* y)
+    {
+        using namespace Simd;
+        VecI bits;
+        VecD vra = Load(ra);
+        vra = vra - Round(vra*Set(1.0/360.0), bits)*Set(360.0);     // -180 to 180
+        VecD sinDec, cosDec, sinHalf, cosHalf;
+        SinCosDeg(Load(dec), sinDec, cosDec);
+        SinCosDeg(vra*Set(0.5), sinHalf, cosHalf);
+        VecD z = Sqrt(Set(1.0) + cosDec*cosHalf);
+        Store(x, Set(180.0)*cosDec*sinHalf/z);
+        Store(y, Set(90.0)*sinDec/z);
+    }
+};
+
+///@brief All-sky image in the Hammer-Aitoff projection, row 0 at the top (y = 90)
+class KcdcSkyImage
+{
+public:
+    KcdcSkyImage(uint32_t width=1440, uint32_t height=720) : m_width(width), m_height(height), m_pixels((size_t)width*height, 0.0) {}
+
+    uint32_t GetWidth() const { return m_width; }
+    uint32_t GetHeight() const { return m_height; }
+    double& operator()(uint32_t row, uint32_t col) { return m_pixels[(size_t)row*m_width + col]; }
+    double operator()(uint32_t row, uint32_t col) const { return m_pixels[(size_t)row*m_width + col]; }
+    const double* GetData() const { return m_pixels.data(); }
+
+    void Clear() { std::fill(m_pixels.begin(), m_pixels.end(), 0.0); }
+
+    ///@brief Add one to the pixel of every event, or weights[i] if weights is set
+    void AddEvents(size_t n, const double* ra, const double* dec, const double* weights=0, uint32_t threads=1)
+    {
+        std::vector<std::vector<double> > partial(threads > 1 ? threads : 0, std::vector<double>(m_pixels.size(), 0.0));
+        RunParallel(threads, n, [&](uint32_t thread, size_t begin, size_t end)
+        {
+            std::vector<double>& pixels = threads > 1 ? partial[thread] : m_pixels;
+            double x[s_blockSize], y[s_blockSize];
+            for (size_t b=begin; b<end; b+=s_blockSize)
+            {
+                const size_t count = end - b < s_blockSize ? end - b : s_blockSize;
+                KcdcHammerAitoff::Project(count, ra + b, dec + b, x, y);
+                for (size_t i=0; i<count; ++i) pixels[GetPixel(x[i], y[i])] += weights ? weights[b+i] : 1.0;
+            }
+        });
+        for (size_t t=0; t<partial.size(); ++t)
+        {
+            for (size_t i=0; i<m_pixels.size(); ++i) m_pixels[i] += partial[t][i];
+        }
+    }
+
+    ///@brief Set every pixel inside the sphere to the map bin it shows; pixels outside are 0
+    template <typename T>
+    void SetMap(const T* values, uint32_t raBins, uint32_t decBins, double binSize, double raMin, double decMin, uint32_t threads=1)
+    {
+        RunParallel(threads, m_height, [&](uint32_t, size_t begin, size_t end)
+        {
+            for (size_t row=begin; row<end; ++row)
+            {
+                const double y = 90.0 - (row + 0.5)*180.0/m_height;
+                for (uint32_t col=0; col<m_width; ++col)
+                {
+                    const double x = -180.0 + (col + 0.5)*360.0/m_width;
+                    double ra, dec, value(0.0);
+                    if (KcdcHammerAitoff::Unproject(x, y, ra, dec))
+                    {
+                        // the same RA range as the map
+                        double t = fmod(ra - raMin, 360.0);
+                        if (t < 0.0) t += 360.0;
+                        const size_t i = GetIndex((dec - decMin)/binSize, decBins);
+                        const size_t j = GetIndex(t/binSize, raBins);
+                        value = values[i*raBins + j];
+                    }
+                    m_pixels[row*m_width + col] = value;
+                }
+            }
+        });
+    }
+
+    ///@brief Smallest and largest pixel values
+    void GetRange(double& min, double& max) const
+    {
+        min = std::numeric_limits<double>::infinity();
+        max = -min;
+        for (size_t i=0; i<m_pixels.size(); ++i)
+        {
+            if (m_pixels[i] < min) min = m_pixels[i];
+            if (m_pixels[i] > max) max = m_pixels[i];
+        }
+    }
+
+    ///@brief Write a binary 8 bit PGM, min black and max white
+    bool WritePgm(const std::string& fname, double min, double max) const
+    {
+        std::ofstream os(fname.c_str(), std::ios::binary | std::ios::trunc);
+        os << "P5\n" << m_width << " " << m_height << "\n255\n";
+        const double scale = max > min ? 255.0/(max - min) : 0.0;
+        std::vector<unsigned char> row(m_width);
+        for (uint32_t r=0; r<m_height; ++r)
+        {
+            for (uint32_t c=0; c<m_width; ++c)
+            {
+                const double v = ((*this)(r, c) - min)*scale;
+                row[c] = v <= 0.0 ? 0 : (v >= 255.0 ? 255 : (unsigned char)(v + 0.5));
+            }
+            os.write(reinterpret_cast<const char*>(row.data()), row.size());
+        }
+        os.close();
+        return !os.fail();
+    }
+
+    ///@brief Write the pixel values as a little endian grayscale PFM (rows bottom to top)
+    bool WritePfm(const std::string& fname) const
+    {
+        std::ofstream os(fname.c_str(), std::ios::binary | std::ios::trunc);
+        os << "Pf\n" << m_width << " " << m_height << "\n-1.0\n";
+        std::vector<unsigned char> row(4*(size_t)m_width);
+        for (int64_t r=m_height-1; r>=0; --r)
+        {
+            for (uint32_t c=0; c<m_width; ++c)
+            {
+                const float v = (float)(*this)(r, c);
+                uint32_t bits;
+                memcpy(&bits, &v, sizeof(bits));
+                for (int k=0; k<4; ++k) row[4*c+k] = (bits >> (8*k)) & 0xff;
+            }
+            os.write(reinterpret_cast<const char*>(row.data()), row.size());
+        }
+        os.close();
+        return !os.fail();
+    }
+
+protected:
+    static const size_t s_blockSize = 1024;    ///< events projected at a time
+
+    ///@brief Pixel index of projected (x, y), clamped to the image
+    size_t GetPixel(double x, double y) const
+    {
+        const size_t col = GetIndex((x + 180.0)*m_width/360.0, m_width);
+        const size_t row = GetIndex((90.0 - y)*m_height/180.0, m_height);
+        return row*m_width + col;
+    }
+
+    ///@brief floor(t) clamped to [0, n-1], 0 for NaN
+    static size_t GetIndex(double t, uint32_t n)
+    {
+        if (!(t > 0.0)) return 0;
+        if (t >= n) return n - 1;
+        return (size_t)t;
+    }
+
+    uint32_t m_width;
+    uint32_t m_height;
+    std::vector<double> m_pixels;
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcProjection_h_
@@ -0,0 +1,125 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcRandom.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Counter based random numbers for reproducible parallel event scrambling
+///
+///  @details Philox4x32-10 (Salmon et al., SC 2011), addressed by (seed, event set, event, draw).
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcRandom_h_
+#define _Csi_KcdcRandom_h_
+#include <inttypes.h>
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief The Philox4x32-10 counter based generator
+class Philox4x32
+{
+public:
+    struct Block
+    {
+        uint32_t v[4];
+    };
+
+    ///@brief Random bits for counter under key
+    static Block Generate(Block counter, uint64_t key)
+    {
+        uint32_t k0 = (uint32_t)key;
+        uint32_t k1 = (uint32_t)(key >> 32);
+        for (uint32_t round=0; round<10; ++round)
+        {
+            if (round > 0)
+            {
+                k0 += 0x9E3779B9;
+                k1 += 0xBB67AE85;
+            }
+            uint64_t p0 = (uint64_t)0xD2511F53 * counter.v[0];
+            uint64_t p1 = (uint64_t)0xCD9E8D57 * counter.v[2];
+            Block next;
+            next.v[0] = (uint32_t)(p1 >> 32) ^ counter.v[1] ^ k0;
+            next.v[1] = (uint32_t)p1;
+            next.v[2] = (uint32_t)(p0 >> 32) ^ counter.v[3] ^ k1;
+            next.v[3] = (uint32_t)p0;
+            counter = next;
+        }
+        return counter;
+    }
+};
+
+///@brief The sequence of random draws belonging to one event of one event set
+class EventRandomStream
+{
+public:
+    EventRandomStream(uint64_t seed, uint64_t set, uint32_t event)
+    : m_seed(seed), m_set(set), m_event(event), m_index(0) {}
+
+    ///@brief Next 64 random bits
+    uint64_t Next()
+    {
+        if ((m_index & 1) == 0)
+        {
+            Philox4x32::Block counter = {{m_event, (uint32_t)(m_index >> 1), (uint32_t)m_set, (uint32_t)(m_set >> 32)}};
+            m_block = Philox4x32::Generate(counter, m_seed);
+        }
+        const uint32_t* half = m_block.v + 2*(m_index & 1);
+        ++m_index;
+        return ((uint64_t)half[0] << 32) | half[1];
+    }
+
+    ///@brief Uniform double in [0, 1)
+    double NextDouble() { return (Next() >> 11) * (1.0/9007199254740992.0); }
+
+    ///@brief Uniform index in [0, n), n > 0
+    uint64_t NextIndex(uint64_t n)
+    {
+        unsigned __int128 product = (unsigned __int128)Next()*n;
+        if ((uint64_t)product < n)
+        {
+            const uint64_t threshold = (0 - n) % n;
+            while ((uint64_t)product < threshold) product = (unsigned __int128)Next()*n;
+        }
+        return (uint64_t)(product >> 64);
+    }
+
+protected:
+    uint64_t m_seed;
+    uint64_t m_set;
+    uint32_t m_event;
+    uint64_t m_index;                   ///< number of draws so far
+    Philox4x32::Block m_block;          ///< bits for draws m_index & ~1 and m_index | 1
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcRandom_h_
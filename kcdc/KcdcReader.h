@@ -0,0 +1,518 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcReader.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Batched reading of transformed KCDC records into record sinks
+///
+///  @details Parses and transforms the input in batches on worker threads and hands them to sinks.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcReader_h_
+#define _Csi_KcdcReader_h_
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <inttypes.h>
+#include <libnova/transform.h>
+#include "KcdcConstants.h"
+#include "KcdcEventCache.h"
+#include "KcdcInputFile.h"
+#include "KcdcPipeline.h"
+#include "KcdcRecord.h"
+#include "KcdcSidereal.h"
+#include "KcdcStats.h"
+#include "KcdcTransform.h"
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief Position of a record that could not be parsed within a batch
+struct KcdcMalformedRecord
+{
+    uint64_t line;                      ///< 1 based line number within the batch
+    KcdcRecordParser::Status status;
+    uint32_t field;
+};
+
+///@brief State a KcdcRecordSink keeps with each batch, created by KcdcRecordSink::CreateBatch
+struct KcdcSinkBatch
+{
+    virtual ~KcdcSinkBatch() {}
+};
+
+///@brief A block of input lines, or rows of an event cache block, and its records
+struct KcdcRecordBatch
+{
+    KcdcRecordBatch() : offset(0), count(0), cacheBlock(0), rowBegin(0), rowEnd(0), timing(false) {}
+    std::string_view lines;             ///< whole input lines
+    std::string storage;                ///< owns lines when they must outlive the input buffer
+    uint64_t offset;                    ///< input offset of lines
+    uint64_t count;                     ///< number of lines, or cache rows, in the batch
+    uint64_t cacheBlock;                ///< event cache block read instead of lines
+    uint32_t rowBegin;                  ///< rows of cacheBlock to read
+    uint32_t rowEnd;
+    bool timing;                        ///< true if stage times are collected
+    std::vector<KcdcMalformedRecord> malformed;
+    std::vector<KcdcRecord> records;    ///< records within an energy range of the reader
+    std::vector<uint64_t> offsets;      ///< text input offset of the line of each record
+    std::vector<KcdcDerived> derived;   ///< LON LAT are not set beyond the galactic max distance
+    std::vector<std::unique_ptr<KcdcSinkBatch> > sinkBatches;  ///< state of each sink, in AddSink order
+    std::vector<uint32_t> rows;         ///< TRANSFORM_BATCH records in the block
+    KcdcEventBlock block;               ///< TRANSFORM_BATCH work arrays
+    SiderealTimeCache sidereal;         ///< kept across the batches this one is reused for
+    KcdcStageTimes times;               ///< time of the worker stages
+};
+
+///@brief Receives the record batches of a KcdcReader scan
+class KcdcRecordSink
+{
+public:
+    virtual ~KcdcRecordSink() {}
+
+    ///@brief State for Work, or 0 if the sink needs none; called on the worker threads
+    virtual KcdcSinkBatch* CreateBatch() { return 0; }
+
+    ///@brief Process batch on a worker thread, adding the time of its stages to times
+    virtual void Work(const KcdcRecordBatch& /*batch*/, KcdcSinkBatch* /*state*/, KcdcStageTimes& /*times*/) {}
+
+    ///@brief Take batch, in input order
+    virtual void Consume(const KcdcRecordBatch& batch, KcdcSinkBatch* state, KcdcStageTimes& times) = 0;
+
+    ///@brief Complete the results after the last batch
+    virtual void Finish(KcdcStageTimes& /*times*/) {}
+};
+
+///@brief Reads a KCDC text input or event cache in batches of parsed and transformed records
+class KcdcReader
+{
+public:
+    ///@param in The text input; shared with the caller, which may move it after Open
+    explicit KcdcReader(KcdcInputFile& in)
+    : m_in(in), m_threads(1), m_transformMode(TRANSFORM_LIBNOVA), m_lazyDecoding(false),
+      m_fieldMask(KcdcRecordParser::s_allFields), m_galacticMaxDistance(std::numeric_limits<double>::infinity()),
+      m_timing(false), m_rowBegin(0), m_rowEnd(0), m_stopped(false),
+      m_regionCos2(pow(cos(40.95*DataConstants::DEG2RAD),2.0)) {}
+
+    ///@brief Set the number of threads that parse and transform; 0 uses one per hardware thread
+    void SetThreads(uint32_t threads) { m_threads = threads; }
+
+    void SetTransformMode(TransformMode mode) { m_transformMode = mode; }
+
+    ///@brief With lazy decoding, only E is parsed of a record outside the energy ranges, and
+    /// of the others only the fields of SetFieldMask
+    void SetLazyDecoding(bool lazy) { m_lazyDecoding = lazy; }
+
+    ///@brief Fields (1 << KcdcField) parsed with lazy decoding; all by default
+    void SetFieldMask(uint32_t mask) { m_fieldMask = mask; }
+
+    ///@brief Pass records with emin <= E <= emax; without a range every record passes
+    void AddEnergyRange(double emin, double emax) { m_ranges.push_back(std::make_pair(emin, emax)); }
+
+    ///@brief Compute LON LAT only for records with DIST <= distance; negative for none.
+    /// The default computes them for all records.
+    void SetGalacticMaxDistance(double distance) { m_galacticMaxDistance = distance; }
+
+    ///@brief Collect stage times in the batches and the times of Scan
+    void SetTiming(bool timing) { m_timing = timing; }
+
+    ///@brief Add a sink for the batches of Scan; it must outlive the scan
+    void AddSink(KcdcRecordSink& sink) { m_sinks.push_back(&sink); }
+
+    ///@brief Open a text input, reading its header line, or an event cache
+    bool Open(const std::string& fname)
+    {
+        Close();
+        if (KcdcEventCache::IsEventCache(fname))
+        {
+            if (!m_cache.Open(fname)) return false;
+            const std::string_view header = m_cache.GetInputHeader();
+            m_header.assign(header.data(), header.size());
+            m_rowBegin = 0;
+            m_rowEnd = m_cache.GetRows();
+            return true;
+        }
+        if (!m_in.Open(fname)) return false;
+        std::string_view s;
+        m_in.GetLine(s);
+        m_header.assign(s.data(), s.size());
+        return true;
+    }
+
+    void Close()
+    {
+        m_cache.Close();
+        m_in.Close();
+    }
+
+    ///@brief True if the open input is an event cache
+    bool IsCache() const { return m_cache.IsOpen(); }
+
+    const KcdcEventCache& GetCache() const { return m_cache; }
+
+    ///@brief Header line of the input
+    const std::string& GetInputHeader() const { return m_header; }
+
+    ///@brief Read only rows [begin, end) of an event cache
+    void SetCacheRows(uint64_t begin, uint64_t end)
+    {
+        m_rowBegin = begin;
+        m_rowEnd = end;
+    }
+
+    ///@brief Read the input and pass every batch to the sinks, then to done(batch, times)
+    template <class Done>
+    void Scan(Done done)
+    {
+        const uint32_t threads = GetThreadCount(m_threads);
+        KcdcStageClock clock(m_timing);         // stages of the calling thread: read, consume
+        KcdcStageTimes times;
+        uint64_t nextBlock(0), blockStart(0);
+        m_stopped = false;
+        // buffered (non mapped) input reuses its buffer; copy batches that outlive the next read
+        const bool copyChunks = !IsCache() && !m_in.IsMapped() && threads>1;
+        RunOrderedPipeline<KcdcRecordBatch>(threads,
+            [&](KcdcRecordBatch& batch)
+            {
+                if (m_stopped) return false;
+                batch.timing = m_timing;
+                if (IsCache()) return GetCacheBatch(batch, nextBlock, blockStart);
+                clock.Start();
+                batch.offset = m_in.GetPosition();
+                if (!m_in.GetChunk(s_chunkSize, batch.lines)) return false;
+                if (copyChunks)
+                {
+                    batch.storage.assign(batch.lines.data(), batch.lines.size());
+                    batch.lines = batch.storage;
+                }
+                clock.Lap(times, STAGE_READ);
+                return true;
+            },
+            [&](KcdcRecordBatch& batch)
+            {
+                KcdcStageClock workClock(m_timing);
+                batch.times.Clear();
+                if (IsCache())
+                {
+                    Load(batch);
+                    workClock.Lap(batch.times, STAGE_READ);
+                }
+                else
+                {
+                    Parse(batch);
+                    workClock.Lap(batch.times, STAGE_PARSE);
+                    Transform(batch);
+                    workClock.Lap(batch.times, STAGE_TRANSFORM);
+                }
+                if (batch.sinkBatches.size() != m_sinks.size())
+                {
+                    batch.sinkBatches.resize(m_sinks.size());
+                    for (size_t k=0; k<m_sinks.size(); ++k) batch.sinkBatches[k].reset(m_sinks[k]->CreateBatch());
+                }
+                for (size_t k=0; k<m_sinks.size(); ++k) m_sinks[k]->Work(batch, batch.sinkBatches[k].get(), batch.times);
+            },
+            [&](KcdcRecordBatch& batch)
+            {
+                for (size_t k=0; k<m_sinks.size(); ++k) m_sinks[k]->Consume(batch, batch.sinkBatches[k].get(), times);
+                times.Merge(batch.times);
+                done(batch, times);
+            });
+    }
+
+    ///@brief End Scan after the batches already read; call from done
+    void Stop() { m_stopped = true; }
+
+    ///@brief Finish the sinks, in AddSink order
+    void Finish(KcdcStageTimes& times)
+    {
+        for (size_t k=0; k<m_sinks.size(); ++k) m_sinks[k]->Finish(times);
+    }
+
+    ///@brief True if e is in an energy range (AddEnergyRange)
+    bool IsAccepted(double e) const
+    {
+        if (m_ranges.empty()) return true;
+        for (size_t r=0; r<m_ranges.size(); ++r)
+        {
+            if (e>=m_ranges[r].first && e<=m_ranges[r].second) return true;
+        }
+        return false;
+    }
+
+    /// @brief Distance of ra (+/-180) and dec from the AddFields region of interest
+    double GetRegionDistance(double ra, double dec) const
+    {
+        //return sqrt(pow((dec-40.95),2.0) + pow((ra-308.0),2.0)/pow(cos(40.95*DEG2RAD),2.0));
+        const double ddec = dec - 40.95;
+        const double dra = ra + 52.0;
+        return sqrt(ddec*ddec + dra*dra/m_regionCos2);
+    }
+
+    static const size_t s_chunkSize = 1 << 20;     ///< input bytes per batch
+
+protected:
+    ///@brief Set batch to the next event cache block, or part of it, with rows to read
+    bool GetCacheBatch(KcdcRecordBatch& batch, uint64_t& nextBlock, uint64_t& blockStart) const
+    {
+        for (; nextBlock<m_cache.GetBlockCount(); ++nextBlock)
+        {
+            if (blockStart >= m_rowEnd) return false;
+            const uint64_t blockEnd = blockStart + m_cache.GetBlockRows(nextBlock);
+            if (blockEnd <= m_rowBegin)
+            {
+                blockStart = blockEnd;
+                continue;
+            }
+            batch.cacheBlock = nextBlock++;
+            batch.rowBegin = m_rowBegin > blockStart ? m_rowBegin - blockStart : 0;
+            batch.rowEnd = (m_rowEnd < blockEnd ? m_rowEnd : blockEnd) - blockStart;
+            blockStart = blockEnd;
+            return true;
+        }
+        return false;
+    }
+
+    ///@brief Fill the records of batch from its event cache rows
+    void Load(KcdcRecordBatch& batch) const
+    {
+        batch.malformed.clear();
+        batch.records.clear();
+        batch.offsets.clear();
+        batch.derived.clear();
+        batch.count = batch.rowEnd - batch.rowBegin;
+        const double* e = m_cache.GetValues<double>(batch.cacheBlock, FIELD_E);
+        const uint64_t* offset = m_cache.GetValues<uint64_t>(batch.cacheBlock, CACHE_OFFSET);
+        for (uint32_t i=batch.rowBegin; i<batch.rowEnd; ++i)
+        {
+            if (!IsAccepted(e[i])) continue;
+            batch.records.push_back(KcdcRecord());
+            batch.derived.push_back(KcdcDerived());
+            KcdcDerived& d = batch.derived.back();
+            m_cache.GetRow(batch.cacheBlock, i, batch.records.back(), d);
+            d.dist = GetRegionDistance(d.ra, d.dec);
+            batch.offsets.push_back(offset[i]);
+        }
+    }
+
+    ///@brief Parse the lines of batch into batch.records
+    void Parse(KcdcRecordBatch& batch) const
+    {
+        batch.malformed.clear();
+        batch.records.clear();
+        batch.offsets.clear();
+        batch.count = 0;
+        KcdcRecordParser parser;
+        const char* p = batch.lines.data();
+        const char* end = p + batch.lines.size();
+        while (p < end)
+        {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+            const char* lineEnd = nl ? nl : end;
+            ++batch.count;
+            batch.records.resize(batch.records.size()+1);
+            KcdcRecord& rec = batch.records.back();
+            const uint64_t lineOffset = batch.offset + (p - batch.lines.data());
+            std::string_view line(p, lineEnd - p);
+            p = nl ? nl + 1 : end;
+            // records outside the energy ranges need no transform, and with lazy decoding no more parsing
+            KcdcRecordParser::Status status = parser.ParseEnergy(line, rec);
+            bool accepted = (status == KcdcRecordParser::PARSE_OK && IsAccepted(rec.e));
+            if (status == KcdcRecordParser::PARSE_OK && (accepted || !m_lazyDecoding))
+            {
+                status = parser.ParseRemaining(rec, m_lazyDecoding ? m_fieldMask : KcdcRecordParser::s_allFields);
+            }
+            if (status != KcdcRecordParser::PARSE_OK)
+            {
+                accepted = false;
+                if (status != KcdcRecordParser::PARSE_EMPTY)
+                {
+                    KcdcMalformedRecord m = {batch.count, status, parser.GetErrorField()};
+                    batch.malformed.push_back(m);
+                }
+            }
+            if (accepted) batch.offsets.push_back(lineOffset);
+            else batch.records.pop_back();
+        }
+    }
+
+    ///@brief Compute batch.derived for batch.records
+    void Transform(KcdcRecordBatch& batch) const
+    {
+        const size_t n = batch.records.size();
+        batch.derived.resize(n);
+        if (m_transformMode == TRANSFORM_BATCH)
+        {
+            TransformBlock(batch);
+            return;
+        }
+        // TRANSFORM_CACHED rotates the equatorial positions of a batch to galactic at the end
+        const bool cached = (m_transformMode == TRANSFORM_CACHED);
+        for (size_t i=0; i<n; ++i) TransformRecord(batch.records[i], batch.derived[i], batch.sidereal, !cached);
+        if (cached) RotateToGalactic(batch);
+    }
+
+    ///@brief Compute LON LAT of the records within the galactic max distance from their RA DEC
+    void RotateToGalactic(KcdcRecordBatch& batch) const
+    {
+        std::vector<KcdcDerived>& derived = batch.derived;
+        KcdcEventBlock& block = batch.block;
+        std::vector<uint32_t>& rows = batch.rows;
+        rows.clear();
+        for (size_t k=0; k<derived.size(); ++k)
+        {
+            if (!(derived[k].dist > m_galacticMaxDistance)) rows.push_back(k);
+        }
+        const size_t m = rows.size();
+        if (m == 0) return;
+        block.Resize(m);
+        for (size_t k=0; k<m; ++k)
+        {
+            block.ra[k] = derived[rows[k]].ra;
+            block.dec[k] = derived[rows[k]].dec;
+        }
+        m_galactic.Transform(m, &block.ra[0], &block.dec[0], &block.lon[0], &block.lat[0]);
+        for (size_t k=0; k<m; ++k)
+        {
+            derived[rows[k]].lon = block.lon[k];
+            derived[rows[k]].lat = block.lat[k];
+        }
+    }
+
+    ///@brief Compute the derived columns of batch.records with the vectorized transform
+    void TransformBlock(KcdcRecordBatch& batch) const
+    {
+        const std::vector<KcdcRecord>& records = batch.records;
+        std::vector<KcdcDerived>& derived = batch.derived;
+        KcdcEventBlock& block = batch.block;
+        std::vector<uint32_t>& rows = batch.rows;
+        const size_t n = records.size();
+        const bool galactic = !(m_galacticMaxDistance < std::numeric_limits<double>::infinity());
+        rows.resize(n);
+        block.Resize(n);
+        for (size_t k=0; k<n; ++k)
+        {
+            const KcdcRecord& rec = records[k];
+            const SiderealTime& st = batch.sidereal.Get(rec.ymd, rec.hms);
+            rows[k] = k;
+            derived[k].jdays = st.jd;
+            block.zenith[k] = rec.ze;
+            block.azimuth[k] = rec.az;
+            block.jd[k] = st.jd;
+            block.lst[k] = SiderealTimeCache::GetLocalSiderealTime(st);
+        }
+        KcdcBatchTransform transform;
+        transform.Transform(n, &block.zenith[0], &block.azimuth[0], &block.lst[0], &block.ra[0], &block.dec[0],
+                            galactic ? &block.lon[0] : 0, galactic ? &block.lat[0] : 0);
+        size_t m(0);
+        for (size_t k=0; k<n; ++k)
+        {
+            KcdcDerived& d = derived[k];
+            d.ra = Convert360To180(block.ra[k]);
+            d.dec = block.dec[k];
+            d.dist = GetRegionDistance(d.ra, d.dec);
+            if (galactic)
+            {
+                d.lon = block.lon[k];
+                d.lat = block.lat[k];
+            }
+            else if (!(d.dist > m_galacticMaxDistance))
+            {
+                // compact the records that need LON LAT to the front of the block
+                rows[m] = rows[k];
+                block.zenith[m] = block.zenith[k];
+                block.azimuth[m] = block.azimuth[k];
+                block.lst[m] = block.lst[k];
+                ++m;
+            }
+        }
+        if (galactic || m == 0) return;
+        transform.Transform(m, &block.zenith[0], &block.azimuth[0], &block.lst[0], &block.ra[0], &block.dec[0],
+                            &block.lon[0], &block.lat[0]);
+        for (size_t k=0; k<m; ++k)
+        {
+            derived[rows[k]].lon = block.lon[k];
+            derived[rows[k]].lat = block.lat[k];
+        }
+    }
+
+    ///@brief Compute the derived columns of a record with the libnova formulas
+    ///@param sidereal Sidereal times of the timestamps, only misses take the libnova lock
+    ///@param galactic If false, LON LAT are left to RotateToGalactic
+    void TransformRecord(const KcdcRecord& rec, KcdcDerived& d, SiderealTimeCache& sidereal, bool galactic) const
+    {
+        using namespace Kcdc::DataConstants;
+        ln_hrz_posn inHrzPos;
+        ln_lnlat_posn observerPos;
+        ln_equ_posn equPos;
+        inHrzPos.alt = 90.0 - rec.ze;
+        inHrzPos.az = EnsureCorrectRange(rec.az + 180.0);
+        observerPos.lat = KASCADE_LATITUDE;
+        observerPos.lng = KASCADE_LONGITUDE;
+        const SiderealTime& st = sidereal.Get(rec.ymd, rec.hms);
+        d.jdays = st.jd;
+        GetEquatorialFromHorizontal(inHrzPos, observerPos, st.gast, equPos);
+        d.ra = Convert360To180(equPos.ra);
+        d.dec = equPos.dec;
+        d.dist = GetRegionDistance(d.ra, d.dec);
+        if (!galactic || d.dist > m_galacticMaxDistance) return;
+
+        ln_gal_posn galacticPos;
+        ln_get_gal_from_equ(&equPos, &galacticPos);
+        d.lat = galacticPos.b;
+        d.lon = galacticPos.l;
+    }
+
+    KcdcInputFile& m_in;
+    KcdcEventCache m_cache;
+    std::string m_header;
+    uint32_t m_threads;
+    TransformMode m_transformMode;
+    bool m_lazyDecoding;
+    uint32_t m_fieldMask;
+    std::vector<std::pair<double, double> > m_ranges;    ///< emin, emax
+    double m_galacticMaxDistance;
+    bool m_timing;
+    std::vector<KcdcRecordSink*> m_sinks;
+    uint64_t m_rowBegin;                ///< event cache rows to read
+    uint64_t m_rowEnd;
+    bool m_stopped;
+    const double m_regionCos2;          ///< cos^2 of the Dec of the GetRegionDistance region
+    const KcdcGalacticRotation m_galactic;
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcReader_h_
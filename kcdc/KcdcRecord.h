@@ -0,0 +1,223 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcRecord.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   KCDC input record and an in-place record parser
+///
+///  @details Tokenizes a line in place and converts the fields with std::from_chars.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcRecord_h_
+#define _Csi_KcdcRecord_h_
+#include <charconv>
+#include <string_view>
+#include <inttypes.h>
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief One record of a KCDC dataset, fields in input file order
+struct KcdcRecord
+{
+    double e;
+    double yc;
+    double xc;
+    double ze;
+    double az;
+    double ne;
+    double nmu;
+    double esumhad;
+    int64_t nhad;
+    double t;
+    double p;
+    uint64_t gt;
+    uint64_t mt;
+    uint64_t ymd;
+    uint64_t hms;
+    uint64_t r;
+    uint64_t ev;
+    double age;
+};
+
+///@brief Columns AddFields derives from a KcdcRecord
+struct KcdcDerived
+{
+    double ra;
+    double dec;
+    double lon;
+    double lat;
+    double jdays;
+    double dist;
+};
+
+///@brief Column index of each KcdcRecord field in the input file
+enum KcdcField
+{
+    FIELD_E = 0, FIELD_YC, FIELD_XC, FIELD_ZE, FIELD_AZ, FIELD_NE, FIELD_NMU, FIELD_ESUMHAD, FIELD_NHAD,
+    FIELD_T, FIELD_P, FIELD_GT, FIELD_MT, FIELD_YMD, FIELD_HMS, FIELD_R, FIELD_EV, FIELD_AGE,
+    FIELD_COUNT
+};
+
+///@brief Returns the column header name of a KcdcField
+inline const char* GetFieldName(uint32_t field)
+{
+    static const char* names[FIELD_COUNT] = {"E", "YC", "XC", "ZE", "AZ", "NE", "NMU", "ESUMHAD", "NHAD",
+                                             "T", "P", "GT", "MT", "YMD", "HMS", "R", "EV", "AGE"};
+    return field<FIELD_COUNT ? names[field] : "?";
+}
+
+///@brief Parses one whitespace separated KCDC line into a KcdcRecord
+class KcdcRecordParser
+{
+public:
+    enum Status
+    {
+        PARSE_OK = 0,            ///< all fields decoded
+        PARSE_EMPTY,             ///< line is blank
+        PARSE_MISSING_FIELD,     ///< line ended before GetErrorField()
+        PARSE_BAD_FIELD          ///< GetErrorField() is not a valid number
+    };
+
+    ///@brief Field mask bit of a KcdcField
+    static uint32_t GetFieldBit(uint32_t field) { return 1u << field; }
+
+    ///@brief Field mask with every field
+    static const uint32_t s_allFields = (1u << FIELD_COUNT) - 1;
+
+    KcdcRecordParser() : m_pos(0), m_end(0), m_field(0), m_status(PARSE_OK) {}
+
+    ///@brief Parse line into rec
+    ///@return PARSE_OK on success; otherwise the content of rec is undefined
+    Status Parse(std::string_view line, KcdcRecord& rec)
+    {
+        if (ParseEnergy(line, rec) != PARSE_OK) return m_status;
+        return ParseRemaining(rec);
+    }
+
+    ///@brief Parse only the E column (the first) of line, so a record can be rejected by
+    /// energy before the rest of the line is tokenized
+    Status ParseEnergy(std::string_view line, KcdcRecord& rec)
+    {
+        m_pos = line.data();
+        m_end = m_pos + line.size();
+        m_field = 0;
+        m_status = PARSE_OK;
+        SkipSpace();
+        if (m_pos == m_end) return (m_status = PARSE_EMPTY);
+        Field(rec.e, true);
+        return m_status;
+    }
+
+    ///@brief Parse the fields after E of the line given to ParseEnergy
+    ///@param fieldMask Fields (GetFieldBit) to decode; the others are only checked to be
+    /// present, their values and validity are not decoded and the members of rec are left as is
+    Status ParseRemaining(KcdcRecord& rec, uint32_t fieldMask = s_allFields)
+    {
+        if (m_status != PARSE_OK) return m_status;
+        uint32_t m = fieldMask;
+        Field(rec.yc, m & (1u<<FIELD_YC)) && Field(rec.xc, m & (1u<<FIELD_XC)) && Field(rec.ze, m & (1u<<FIELD_ZE)) &&
+        Field(rec.az, m & (1u<<FIELD_AZ)) && Field(rec.ne, m & (1u<<FIELD_NE)) && Field(rec.nmu, m & (1u<<FIELD_NMU)) &&
+        Field(rec.esumhad, m & (1u<<FIELD_ESUMHAD)) && Field(rec.nhad, m & (1u<<FIELD_NHAD)) &&
+        Field(rec.t, m & (1u<<FIELD_T)) && Field(rec.p, m & (1u<<FIELD_P)) && Field(rec.gt, m & (1u<<FIELD_GT)) &&
+        Field(rec.mt, m & (1u<<FIELD_MT)) && Field(rec.ymd, m & (1u<<FIELD_YMD)) && Field(rec.hms, m & (1u<<FIELD_HMS)) &&
+        Field(rec.r, m & (1u<<FIELD_R)) && Field(rec.ev, m & (1u<<FIELD_EV)) && Field(rec.age, m & (1u<<FIELD_AGE));
+        return m_status;
+    }
+
+    ///@brief Status of the last Parse
+    Status GetStatus() const { return m_status; }
+
+    ///@brief Field (KcdcField) at which the last Parse failed
+    uint32_t GetErrorField() const { return m_field; }
+
+    ///@brief Short description of the last Parse failure, for diagnostics
+    const char* GetErrorMessage() const { return GetStatusMessage(m_status); }
+
+    ///@brief Short description of a parse status, for diagnostics
+    static const char* GetStatusMessage(Status status)
+    {
+        switch (status)
+        {
+        case PARSE_OK:            return "ok";
+        case PARSE_EMPTY:         return "empty line";
+        case PARSE_MISSING_FIELD: return "missing field";
+        case PARSE_BAD_FIELD:     return "invalid number in field";
+        }
+        return "?";
+    }
+
+protected:
+    void SkipSpace()
+    {
+        while (m_pos!=m_end && (*m_pos==' ' || *m_pos=='\t' || *m_pos=='\r' || *m_pos=='\n')) ++m_pos;
+    }
+
+    /// @brief Decode the next token into value, or only skip it if !decode; sets m_status and
+    /// returns false on failure
+    template <typename T>
+    bool Field(T& value, bool decode)
+    {
+        SkipSpace();
+        if (m_pos == m_end)
+        {
+            m_status = PARSE_MISSING_FIELD;
+            return false;
+        }
+        if (!decode)
+        {
+            while (m_pos!=m_end && *m_pos!=' ' && *m_pos!='\t' && *m_pos!='\r' && *m_pos!='\n') ++m_pos;
+            ++m_field;
+            return true;
+        }
+        const char* begin = m_pos;
+        if (*begin == '+') ++begin;     // from_chars does not accept an explicit plus sign
+        std::from_chars_result res = std::from_chars(begin, m_end, value);
+        if (res.ec != std::errc() || (res.ptr!=m_end && *res.ptr!=' ' && *res.ptr!='\t' &&
+                                      *res.ptr!='\r' && *res.ptr!='\n'))
+        {
+            m_status = PARSE_BAD_FIELD;
+            return false;
+        }
+        m_pos = res.ptr;
+        ++m_field;
+        return true;
+    }
+
+    const char* m_pos;
+    const char* m_end;
+    uint32_t m_field;
+    Status m_status;
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcRecord_h_
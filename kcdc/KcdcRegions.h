@@ -0,0 +1,351 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcRegions.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Catalog of circular sky regions with a cell index for AddFields
+///
+///  @details Sources are indexed by equal RA/Dec sky cells and matched by angular distance.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcRegions_h_
+#define _Csi_KcdcRegions_h_
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <inttypes.h>
+#include "KcdcConstants.h"
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief A circular region of interest: center RA, Dec and radius in degrees
+struct KcdcRegion
+{
+    KcdcRegion(const std::string& id_="", double ra_=0.0, double dec_=0.0, double radius_=0.0) :
+        id(id_), ra(ra_), dec(dec_), radius(radius_) {}
+
+    std::string id;     ///< written to the AddFields SOURCES column; no white space or commas
+    double ra;
+    double dec;
+    double radius;
+};
+
+///@brief Sources of interest for AddFields, and the sky-cell index used to match events
+class KcdcRegionCatalog
+{
+public:
+    static constexpr double s_defaultCellSize = 1.0;    ///< cell width in degrees
+
+    explicit KcdcRegionCatalog(double cellSize=s_defaultCellSize) : m_cellSize(cellSize), m_raCells(0), m_decCells(0) {}
+
+    size_t GetSize() const { return m_regions.size(); }
+    bool IsEmpty() const { return m_regions.empty(); }
+    const KcdcRegion& Get(size_t i) const { return m_regions[i]; }
+
+    ///@brief Set the cell width in degrees, 0 < cellSize <= 180; call Build after
+    bool SetCellSize(double cellSize)
+    {
+        if (!(cellSize > 0.0 && cellSize <= 180.0))
+        {
+            m_error = "invalid cell size";
+            return false;
+        }
+        m_cellSize = cellSize;
+        return true;
+    }
+
+    double GetCellSize() const { return m_cellSize; }
+
+    ///@brief Description of the last Add, Load or SetCellSize failure
+    const std::string& GetError() const { return m_error; }
+
+    void Clear()
+    {
+        m_regions.clear();
+        m_x.clear();
+        m_y.clear();
+        m_z.clear();
+        m_chord2.clear();
+        m_cellStart.clear();
+        m_cellSources.clear();
+    }
+
+    ///@brief Add a source; -90 <= dec <= 90 and 0 < radius <= 180
+    ///@return false if the source is not valid
+    bool Add(const KcdcRegion& region)
+    {
+        using namespace Kcdc::DataConstants;
+        if (region.id.empty() || region.id.find_first_of(", \t\r\n") != std::string::npos)
+        {
+            m_error = "invalid source id (" + region.id + ")";
+            return false;
+        }
+        if (!std::isfinite(region.ra) || !(region.dec >= -90.0 && region.dec <= 90.0) ||
+            !(region.radius > 0.0 && region.radius <= 180.0))
+        {
+            m_error = "invalid region for source (" + region.id + ")";
+            return false;
+        }
+        m_regions.push_back(region);
+        double x, y, z;
+        GetUnitVector(region.ra, region.dec, x, y, z);
+        m_x.push_back(x);
+        m_y.push_back(y);
+        m_z.push_back(z);
+        const double h = sin(0.5*region.radius*DEG2RAD);
+        m_chord2.push_back(4.0*h*h);
+        return true;
+    }
+
+    bool Add(const std::string& id, double ra, double dec, double radius) { return Add(KcdcRegion(id, ra, dec, radius)); }
+
+    ///@brief Add the sources of a text file and Build the index
+    ///@return false if the file cannot be read or a line is not a valid source
+    bool Load(const std::string& fname)
+    {
+        std::ifstream in(fname.c_str());
+        if (!in)
+        {
+            m_error = "unable to open (" + fname + ")";
+            return false;
+        }
+        std::string line;
+        uint64_t lineNumber(0);
+        while (std::getline(in, line))
+        {
+            ++lineNumber;
+            const size_t first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') continue;
+            std::istringstream is(line);
+            KcdcRegion region;
+            std::string rest;
+            if (!(is >> region.id >> region.ra >> region.dec >> region.radius) || (is >> rest))
+            {
+                m_error = fname + " line " + std::to_string(lineNumber) + ": expected id ra dec radius";
+                return false;
+            }
+            if (!Add(region))
+            {
+                m_error = fname + " line " + std::to_string(lineNumber) + ": " + m_error;
+                return false;
+            }
+        }
+        Build();
+        return true;
+    }
+
+    ///@brief Build the cell index of the sources
+    void Build()
+    {
+        m_decCells = static_cast<uint32_t>(ceil(180.0/m_cellSize));
+        m_raCells = static_cast<uint32_t>(ceil(360.0/m_cellSize));
+        const size_t cells = static_cast<size_t>(m_decCells)*m_raCells;
+        m_cellStart.assign(cells + 1, 0);
+        // count the sources of every cell, then fill them in catalog order
+        for (uint32_t s=0; s<m_regions.size(); ++s) ForEachCell(s, [&](size_t cell) { ++m_cellStart[cell+1]; });
+        for (size_t c=0; c<cells; ++c) m_cellStart[c+1] += m_cellStart[c];
+        m_cellSources.resize(m_cellStart[cells]);
+        std::vector<uint32_t> next(m_cellStart.begin(), m_cellStart.end() - 1);
+        for (uint32_t s=0; s<m_regions.size(); ++s) ForEachCell(s, [&](size_t cell) { m_cellSources[next[cell]++] = s; });
+    }
+
+    ///@brief Append the index of every source whose region contains ra (any range) and dec
+    /// to sources, in catalog order
+    ///@return the number of sources appended
+    size_t Match(double ra, double dec, std::vector<uint32_t>& sources) const
+    {
+        if (m_cellStart.empty() || !std::isfinite(ra) || !(dec >= -90.0 && dec <= 90.0)) return 0;
+        const size_t cell = GetCell(ra, dec);
+        const uint32_t begin = m_cellStart[cell];
+        const uint32_t end = m_cellStart[cell+1];
+        if (begin == end) return 0;
+        double x, y, z;
+        GetUnitVector(ra, dec, x, y, z);
+        size_t n(0);
+        for (uint32_t i=begin; i<end; ++i)
+        {
+            // the squared chord is accurate for small regions, unlike the dot product
+            const uint32_t s = m_cellSources[i];
+            const double dx = x - m_x[s];
+            const double dy = y - m_y[s];
+            const double dz = z - m_z[s];
+            if (dx*dx + dy*dy + dz*dz <= m_chord2[s])
+            {
+                sources.push_back(s);
+                ++n;
+            }
+        }
+        return n;
+    }
+
+    ///@brief Number of sources listed in the cell of ra and dec
+    size_t GetCellSourceCount(double ra, double dec) const
+    {
+        if (m_cellStart.empty() || !std::isfinite(ra) || !(dec >= -90.0 && dec <= 90.0)) return 0;
+        const size_t cell = GetCell(ra, dec);
+        return m_cellStart[cell+1] - m_cellStart[cell];
+    }
+
+    ///@brief Angular distance in degrees between two positions (haversine formula)
+    static double GetAngularDistance(double ra1, double dec1, double ra2, double dec2)
+    {
+        using namespace Kcdc::DataConstants;
+        const double sdec = sin(0.5*(dec2 - dec1)*DEG2RAD);
+        const double sra = sin(0.5*(ra2 - ra1)*DEG2RAD);
+        double h = sdec*sdec + cos(dec1*DEG2RAD)*cos(dec2*DEG2RAD)*sra*sra;
+        if (h > 1.0) h = 1.0;
+        return 2.0*asin(sqrt(h))*RAD2DEG;
+    }
+
+    ///@brief Checksum of the sources, to tell catalogs apart in checkpoints
+    uint64_t GetChecksum() const
+    {
+        std::ostringstream os;
+        os.precision(17);
+        for (size_t i=0; i<m_regions.size(); ++i)
+        {
+            const KcdcRegion& r = m_regions[i];
+            os << r.id << ' ' << r.ra << ' ' << r.dec << ' ' << r.radius << '\n';
+        }
+        const std::string s = os.str();
+        uint64_t hash = 14695981039346656037ull;     // FNV-1a
+        for (size_t i=0; i<s.size(); ++i)
+        {
+            hash ^= static_cast<unsigned char>(s[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+protected:
+    /// Added to the region extent when the cells are indexed, against rounding
+    static constexpr double s_margin = 1e-9;
+
+    static void GetUnitVector(double ra, double dec, double& x, double& y, double& z)
+    {
+        using namespace Kcdc::DataConstants;
+        const double cdec = cos(dec*DEG2RAD);
+        x = cdec*cos(ra*DEG2RAD);
+        y = cdec*sin(ra*DEG2RAD);
+        z = sin(dec*DEG2RAD);
+    }
+
+    uint32_t GetDecCell(double dec) const
+    {
+        const double row = floor((dec + 90.0)/m_cellSize);
+        if (row < 0.0) return 0;
+        if (row >= m_decCells) return m_decCells - 1;
+        return static_cast<uint32_t>(row);
+    }
+
+    ///@brief Column of an RA in [0, 360]
+    uint32_t GetRaCell(double ra) const
+    {
+        const double col = floor(ra/m_cellSize);
+        if (col < 0.0) return 0;
+        if (col >= m_raCells) return m_raCells - 1;
+        return static_cast<uint32_t>(col);
+    }
+
+    size_t GetCell(double ra, double dec) const
+    {
+        double a = fmod(ra, 360.0);
+        if (a < 0.0) a += 360.0;
+        return static_cast<size_t>(GetDecCell(dec))*m_raCells + GetRaCell(a);
+    }
+
+    ///@brief Call fn with every cell the region of source s overlaps
+    template <typename Fn>
+    void ForEachCell(uint32_t s, Fn fn) const
+    {
+        using namespace Kcdc::DataConstants;
+        const KcdcRegion& r = m_regions[s];
+        const double radius = r.radius + s_margin;
+        const uint32_t rowBegin = GetDecCell(r.dec - radius);
+        const uint32_t rowEnd = GetDecCell(r.dec + radius) + 1;
+        // half width in RA of a cap that does not contain a pole
+        bool allRa = fabs(r.dec) + radius >= 90.0;
+        // up to two column ranges: the RA range is wrapped in degrees, as the last column
+        // is narrower when the cell size does not divide 360
+        uint32_t colBegin[2] = {0, 0}, colEnd[2] = {m_raCells, 0};
+        if (!allRa)
+        {
+            const double width = asin(sin(radius*DEG2RAD)/cos(r.dec*DEG2RAD))*RAD2DEG + s_margin;
+            double a = fmod(r.ra, 360.0);
+            if (a < 0.0) a += 360.0;
+            const double lo = a - width, hi = a + width;
+            allRa = hi - lo >= 360.0;
+            if (lo < 0.0 || hi >= 360.0)
+            {
+                colBegin[0] = GetRaCell(lo < 0.0 ? lo + 360.0 : lo);
+                colEnd[1] = GetRaCell(hi >= 360.0 ? hi - 360.0 : hi) + 1;
+                allRa = allRa || colEnd[1] > colBegin[0];
+            }
+            else
+            {
+                colBegin[0] = GetRaCell(lo);
+                colEnd[0] = GetRaCell(hi) + 1;
+            }
+        }
+        if (allRa)
+        {
+            colBegin[0] = 0;
+            colEnd[0] = m_raCells;
+            colEnd[1] = 0;
+        }
+        for (uint32_t row=rowBegin; row<rowEnd; ++row)
+        {
+            for (int i=0; i<2; ++i)
+            {
+                for (uint32_t col=colBegin[i]; col<colEnd[i]; ++col) fn(static_cast<size_t>(row)*m_raCells + col);
+            }
+        }
+    }
+
+    std::vector<KcdcRegion> m_regions;
+    std::vector<double> m_x;            ///< unit vector of each source center
+    std::vector<double> m_y;
+    std::vector<double> m_z;
+    std::vector<double> m_chord2;       ///< squared chord of each source radius
+    double m_cellSize;
+    uint32_t m_raCells;
+    uint32_t m_decCells;
+    std::vector<uint32_t> m_cellStart;  ///< first entry of each cell in m_cellSources, and the end
+    std::vector<uint32_t> m_cellSources;
+    std::string m_error;
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcRegions_h_
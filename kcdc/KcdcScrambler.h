@@ -0,0 +1,152 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcScrambler.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Time scrambling of an event set for background (fake event) maps
+///
+///  @details A fake event keeps the horizontal direction of a real event and the time of another.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcScrambler_h_
+#define _Csi_KcdcScrambler_h_
+#include <cmath>
+#include <vector>
+#include <inttypes.h>
+#include <libnova/ln_types.h>
+#include <libnova/utility.h>
+#include "KcdcConstants.h"
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief Generates time scrambled fake events from a set of real events
+class TimeScrambler
+{
+public:
+    static const uint32_t s_defaultOversampling = 20;
+
+    TimeScrambler(double latitude = DataConstants::KASCADE_LATITUDE,
+                  double longitude = DataConstants::KASCADE_LONGITUDE)
+    : m_latitude(ln_deg_to_rad(latitude)), m_longitude(ln_deg_to_rad(longitude)) {}
+
+    void Reserve(size_t n)
+    {
+        m_hourAngle.reserve(n);
+        m_dec.reserve(n);
+        m_sidereal.reserve(n);
+    }
+
+    void Clear()
+    {
+        m_hourAngle.clear();
+        m_dec.clear();
+        m_sidereal.clear();
+    }
+
+    ///@brief Remove the first n events; the event after them becomes event 0
+    void Discard(size_t n)
+    {
+        if (n >= GetSize())
+        {
+            Clear();
+            return;
+        }
+        m_hourAngle.erase(m_hourAngle.begin(), m_hourAngle.begin() + n);
+        m_dec.erase(m_dec.begin(), m_dec.begin() + n);
+        m_sidereal.erase(m_sidereal.begin(), m_sidereal.begin() + n);
+    }
+
+    size_t GetSize() const { return m_dec.size(); }
+
+    ///@brief Add a real event
+    ///@param object Horizontal position, libnova azimuth convention
+    ///@param gast Greenwich apparent sidereal time of the event in hours
+    void AddEvent(const ln_hrz_posn& object, double gast)
+    {
+        double A = ln_deg_to_rad(object.az);
+        double h = ln_deg_to_rad(object.alt);
+        double H = atan2(sin(A), (cos(A) * sin(m_latitude) + tan(h) * cos(m_latitude)));
+        double declination = asin(sin(m_latitude) * sin(h) - cos(m_latitude) * cos(h) * cos(A));
+        m_hourAngle.push_back(H);
+        m_dec.push_back(ln_rad_to_deg(declination));
+        m_sidereal.push_back(gast * 2.0 * M_PI / 24.0);
+    }
+
+    ///@brief Add an event with the values AddEvent computed for it (GetEvent), e.g. restored
+    /// from a KcdcCheckpoint
+    void AddEvent(double hourAngle, double declination, double sidereal)
+    {
+        m_hourAngle.push_back(hourAngle);
+        m_dec.push_back(declination);
+        m_sidereal.push_back(sidereal);
+    }
+
+    ///@brief Values AddEvent computed for event: hour angle and sidereal time in radians,
+    /// declination in degrees
+    void GetEvent(size_t event, double& hourAngle, double& declination, double& sidereal) const
+    {
+        hourAngle = m_hourAngle[event];
+        declination = m_dec[event];
+        sidereal = m_sidereal[event];
+    }
+
+    ///@brief Declination of event (and of all its fake events) in degrees
+    double GetDeclination(size_t event) const { return m_dec[event]; }
+
+    ///@brief Right ascension 0 to 360 of event seen at the time of event donor
+    double GetRightAscension(size_t event, size_t donor) const
+    {
+        return ln_range_degrees(ln_rad_to_deg(m_sidereal[donor] - m_hourAngle[event] + m_longitude));
+    }
+
+    ///@brief Generate oversampling fake events for each event in [begin, end)
+    template <class Draw, class Fill>
+    void Scramble(size_t begin, size_t end, uint32_t oversampling, Draw draw, Fill fill) const
+    {
+        for (size_t n=begin; n<end; ++n)
+        {
+            const double dec = m_dec[n];
+            for (uint32_t i=0; i<oversampling; ++i) fill(GetRightAscension(n, draw(n, i)), dec);
+        }
+    }
+
+protected:
+    double m_latitude;                  ///< radians
+    double m_longitude;                 ///< radians
+    std::vector<double> m_hourAngle;    ///< radians
+    std::vector<double> m_dec;          ///< degrees
+    std::vector<double> m_sidereal;     ///< apparent sidereal time in radians
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcScrambler_h_
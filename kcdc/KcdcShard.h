@@ -0,0 +1,97 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcShard.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Shard specification for processing one input on several processes or nodes
+///
+///  @details Shards are runs of whole fixed size segments, so merged results do not depend on their count.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcShard_h_
+#define _Csi_KcdcShard_h_
+#include <cstdlib>
+#include <string>
+#include <inttypes.h>
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief Shard index of count; the default shard 0 of 1 is the whole input
+struct KcdcShard
+{
+    KcdcShard(uint32_t index_=0, uint32_t count_=1) : index(index_), count(count_) {}
+
+    uint32_t index;     ///< 0 based
+    uint32_t count;
+
+    ///@brief Default segment size in bytes
+    static const uint64_t s_defaultSegmentSize = 1ull << 30;
+
+    bool IsValid() const { return count > 0 && index < count; }
+
+    ///@brief True for the whole input (shard 0 of 1)
+    bool IsWhole() const { return count == 1; }
+
+    ///@brief Segment of a line starting at byte offset of the input
+    static uint64_t GetSegment(uint64_t offset, uint64_t segmentSize) { return offset/segmentSize; }
+
+    ///@brief Number of segments of an input of size bytes
+    static uint64_t GetSegmentCount(uint64_t size, uint64_t segmentSize) { return (size + segmentSize - 1)/segmentSize; }
+
+    ///@brief First segment of this shard of an input of segments segments
+    uint64_t GetFirstSegment(uint64_t segments) const { return segments*index/count; }
+
+    ///@brief Segment after the last one of this shard
+    uint64_t GetEndSegment(uint64_t segments) const { return segments*(index+1)/count; }
+
+    ///@brief "i/N"
+    std::string ToString() const { return std::to_string(index) + "/" + std::to_string(count); }
+
+    ///@brief Parse "i/N" into shard
+    ///@return false, leaving shard unchanged, if spec is not a valid shard
+    static bool Parse(const std::string& spec, KcdcShard& shard)
+    {
+        const char* p = spec.c_str();
+        char* end(0);
+        unsigned long index = strtoul(p, &end, 10);
+        if (end == p || *end != '/') return false;
+        p = end + 1;
+        unsigned long count = strtoul(p, &end, 10);
+        if (end == p || *end != 0 || count == 0 || index >= count || count > 0xffffffffUL) return false;
+        shard = KcdcShard(index, count);
+        return true;
+    }
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcShard_h_
@@ -0,0 +1,222 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcSidereal.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Julian date and sidereal time cache keyed on event timestamps
+///
+///  @details Julian date and apparent sidereal time computed once per distinct YMD/HMS timestamp.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcSidereal_h_
+#define _Csi_KcdcSidereal_h_
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <inttypes.h>
+#include <libnova/ln_types.h>
+#include <libnova/sidereal_time.h>
+#include <libnova/utility.h>
+#include "KcdcConstants.h"
+#include "KcdcTransform.h"
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief Get Julian date from KCDC YMD, HMS and nanoseconds
+///
+/// Based on or translated from golang https://github.com/soniakeys/meeus.git
+inline double ComputeJulianDate(uint64_t ymd, uint64_t hms, uint64_t mmn)
+{
+    using namespace std;
+
+    double years = floor(ymd / 10000);
+    double months = floor((ymd - years * 10000) / 100);
+    double days = (ymd - years * 10000 - months *100);
+
+    if (months <= 2) {
+        months += 12;
+        years--;
+    }
+
+    double hours = hms / 10000;
+    double minutes = (hms - hours * 10000.0) / 100.0;
+    double seconds = (double)(hms - hours * 10000.0 - minutes *100.0) + mmn*1e-9;
+
+    days += (hours + (minutes + seconds / 60.0) / 60.0) / 24.0;
+    double b = floor(years / 100.0);
+    b = 2 - b + floor(b / 4);
+
+    return floor(365.25 * floor(years + 4716.0)) + floor(306 * (months+1.0)/10.) + b + days - 1524.5;
+}
+
+///@brief Julian date and apparent sidereal time of one timestamp
+struct SiderealTime
+{
+    double jd;          ///< Julian date
+    double gast;        ///< Greenwich apparent sidereal time in hours, from libnova
+};
+
+///@brief Cache of Julian date and apparent sidereal time per event timestamp; not thread safe, use one per thread
+class SiderealTimeCache
+{
+public:
+    SiderealTimeCache() : m_lastKey(s_noKey), m_clock(0), m_hits(0), m_misses(0)
+    {
+        for (size_t i=0; i<s_entries; ++i)
+        {
+            m_entries[i].key = s_noKey;
+            m_entries[i].used = 0;
+        }
+    }
+
+    ///@brief Julian date and sidereal time of a KCDC YMD / HMS timestamp
+    const SiderealTime& Get(uint64_t ymd, uint64_t hms)
+    {
+        uint64_t key = ymd*1000000 + hms;
+        if (key == m_lastKey)
+        {
+            ++m_hits;
+            return m_last;
+        }
+        Entry& e = Find(key);
+        if (e.key != key)
+        {
+            e.key = key;
+            e.value.jd = ComputeJulianDate(ymd, hms, 0);      /// no mmn in data
+            e.value.gast = ComputeSiderealTime(e.value.jd);
+        }
+        m_lastKey = key;
+        m_last = e.value;
+        return m_last;
+    }
+
+    ///@brief Sidereal time of a Julian date (e.g. taken from another event)
+    const SiderealTime& GetByJulianDate(double jd)
+    {
+        uint64_t bits;
+        memcpy(&bits, &jd, sizeof(bits));
+        uint64_t key = bits | s_jdFlag;         // keeps Julian date keys apart from timestamps
+        if (key == m_lastKey)
+        {
+            ++m_hits;
+            return m_last;
+        }
+        Entry& e = Find(key);
+        if (e.key != key)
+        {
+            e.key = key;
+            e.value.jd = jd;
+            e.value.gast = ComputeSiderealTime(jd);
+        }
+        m_lastKey = key;
+        m_last = e.value;
+        return m_last;
+    }
+
+    ///@brief Local apparent sidereal time in degrees for an observer longitude
+    static double GetLocalSiderealTime(const SiderealTime& st, double longitude=DataConstants::KASCADE_LONGITUDE)
+    {
+        return st.gast*15.0 + longitude;
+    }
+
+    uint64_t GetHits() const { return m_hits; }
+    uint64_t GetMisses() const { return m_misses; }
+
+protected:
+    struct Entry
+    {
+        uint64_t key;
+        uint64_t used;      ///< m_clock at last use
+        SiderealTime value;
+    };
+
+    static const size_t s_ways = 4;
+    static const size_t s_sets = 64;
+    static const size_t s_entries = s_ways*s_sets;
+    static const uint64_t s_noKey = ~0ULL;
+    static const uint64_t s_jdFlag = 1ULL << 63;
+
+    /// @brief The entry holding key, or the least recently used entry of its set
+    Entry& Find(uint64_t key)
+    {
+        uint64_t h = key*0x9E3779B97F4A7C15ULL;
+        Entry* set = m_entries + (h >> 58)%s_sets*s_ways;
+        Entry* lru = set;
+        ++m_clock;
+        for (size_t w=0; w<s_ways; ++w)
+        {
+            if (set[w].key == key)
+            {
+                ++m_hits;
+                set[w].used = m_clock;
+                return set[w];
+            }
+            if (set[w].used < lru->used) lru = set + w;
+        }
+        ++m_misses;
+        lru->used = m_clock;
+        return *lru;
+    }
+
+    static double ComputeSiderealTime(double jd)
+    {
+        std::lock_guard<std::mutex> lock(GetLibnovaMutex());
+        return ln_get_apparent_sidereal_time(jd);
+    }
+
+    uint64_t m_lastKey;
+    SiderealTime m_last;
+    uint64_t m_clock;
+    uint64_t m_hits;
+    uint64_t m_misses;
+    Entry m_entries[s_entries];
+};
+
+///@brief The ln_get_equ_from_hrz formulas in double with a precomputed apparent sidereal time; within
+/// about 1e-11 degrees of ln_get_equ_from_hrz
+inline void GetEquatorialFromHorizontal(const ln_hrz_posn& object, const ln_lnlat_posn& observer, double gast,
+                                        ln_equ_posn& position)
+{
+    double A = ln_deg_to_rad(object.az);
+    double h = ln_deg_to_rad(object.alt);
+    double longitude = ln_deg_to_rad(observer.lng);
+    double latitude = ln_deg_to_rad(observer.lat);
+    double H = atan2(sin(A), (cos(A) * sin(latitude) + tan(h) * cos(latitude)));
+    double declination = asin(sin(latitude) * sin(h) - cos(latitude) * cos(h) * cos(A));
+    double sidereal = gast * 2.0 * M_PI / 24.0;
+    position.ra = ln_range_degrees(ln_rad_to_deg(sidereal - H + longitude));
+    position.dec = ln_rad_to_deg(declination);
+}
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcSidereal_h_
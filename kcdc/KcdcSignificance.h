@@ -0,0 +1,229 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcSignificance.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Excess and Li-Ma significance maps from the ProcessEventStats maps
+///
+///  @details On and off counts are summed over a circle around every bin with summed-area tables.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcSignificance_h_
+#define _Csi_KcdcSignificance_h_
+#include <cmath>
+#include <ostream>
+#include <vector>
+#include <inttypes.h>
+#include "KcdcConstants.h"
+#include "KcdcFormatter.h"
+#include "KcdcMapFile.h"
+#include "KcdcPipeline.h"
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief Summed-area table of a map of decBins rows of raBins counts
+class KcdcSummedArea
+{
+public:
+    KcdcSummedArea(const uint64_t* counts, uint32_t raBins, uint32_t decBins)
+    : m_raBins(raBins), m_decBins(decBins), m_table((size_t)(raBins+1)*(decBins+1), 0)
+    {
+        const size_t stride = raBins + 1;
+        for (uint32_t i=0; i<decBins; ++i)
+        {
+            uint64_t row(0);
+            for (uint32_t j=0; j<raBins; ++j)
+            {
+                row += counts[(size_t)i*raBins + j];
+                m_table[(i+1)*stride + j+1] = m_table[i*stride + j+1] + row;
+            }
+        }
+    }
+
+    ///@brief Sum of rows [rowBegin, rowEnd) and columns [colBegin, colEnd)
+    uint64_t Sum(uint32_t rowBegin, uint32_t rowEnd, int64_t colBegin, int64_t colEnd) const
+    {
+        if (colBegin < 0) return Sum(rowBegin, rowEnd, colBegin + m_raBins, m_raBins) + Sum(rowBegin, rowEnd, 0, colEnd);
+        if (colEnd > m_raBins) return Sum(rowBegin, rowEnd, colBegin, m_raBins) + Sum(rowBegin, rowEnd, 0, colEnd - m_raBins);
+        const size_t stride = m_raBins + 1;
+        return m_table[rowEnd*stride + colEnd] - m_table[rowBegin*stride + colEnd]
+             - m_table[rowEnd*stride + colBegin] + m_table[rowBegin*stride + colBegin];
+    }
+
+protected:
+    int64_t m_raBins;
+    uint32_t m_decBins;
+    std::vector<uint64_t> m_table;      ///< (decBins+1) rows of raBins+1 sums, a zero first row and column
+};
+
+///@brief Window sums, excess and significance of every bin for one window radius
+struct KcdcSignificanceMap
+{
+    KcdcSignificanceMap() : radius(0.0), raBins(0), decBins(0) {}
+
+    double radius;              ///< window radius in degrees
+    uint32_t raBins;
+    uint32_t decBins;
+    std::vector<double> on;     ///< real events in the window
+    std::vector<double> off;    ///< fake events in the window
+    std::vector<double> excess; ///< on - alpha*off
+    std::vector<double> significance;   ///< Li-Ma significance, negative for a deficit
+
+    ///@brief Write values as text like the ProcessEventStats maps, highest Dec row first
+    void Write(std::ostream& os, const std::vector<double>& values, uint32_t precision=4) const
+    {
+        KcdcOutputBuffer out(1 << 20);
+        for (int64_t i=decBins-1; i>=0; --i)
+        {
+            for (uint32_t j=0; j<raBins; ++j)
+            {
+                out.AppendFixed(values[(size_t)i*raBins + j], 0, precision);
+                out.Append(' ');
+            }
+            out.Append('\n');
+            if (out.IsFull()) out.Flush(os);
+        }
+        out.Flush(os);
+    }
+
+    ///@brief Index of the bin with the largest significance
+    size_t GetMaxBin() const
+    {
+        size_t best(0);
+        for (size_t i=1; i<significance.size(); ++i)
+        {
+            if (significance[i] > significance[best]) best = i;
+        }
+        return best;
+    }
+};
+
+///@brief Excess and Li-Ma significance maps for a list of window radii
+class KcdcSignificance
+{
+public:
+    ///@brief Li-Ma (1983) eq. 17 significance of non on and noff off events with exposure ratio
+    /// alpha, signed like the excess non - alpha*noff
+    static double GetLiMa(double non, double noff, double alpha)
+    {
+        const double total = non + noff;
+        if (total <= 0.0 || alpha <= 0.0) return 0.0;
+        double s(0.0);
+        if (non > 0.0) s += non*log((1.0 + alpha)/alpha*(non/total));
+        if (noff > 0.0) s += noff*log((1.0 + alpha)*(noff/total));
+        s = s > 0.0 ? sqrt(2.0*s) : 0.0;
+        return non < alpha*noff ? -s : s;
+    }
+
+    ///@brief Compute maps[k] for radii[k] from the real and fake maps of a band
+    ///@param alpha On to off exposure ratio, 1/oversampling for ProcessEventStats maps
+    ///@return false if the maps differ in binning
+    static bool Compute(const KcdcMapFile& real, const KcdcMapFile& fake, double alpha, const std::vector<double>& radii,
+                        uint32_t threads, std::vector<KcdcSignificanceMap>& maps)
+    {
+        using namespace Kcdc::DataConstants;
+        if (!real.IsCompatible(fake) || real.counts.size() != fake.counts.size() ||
+            real.counts.size() != (size_t)real.raBins*real.decBins) return false;
+        const uint32_t raBins = real.raBins;
+        const uint32_t decBins = real.decBins;
+        const size_t bins = real.counts.size();
+        const KcdcSummedArea on(real.counts.data(), raBins, decBins);
+        const KcdcSummedArea off(fake.counts.data(), raBins, decBins);
+        maps.assign(radii.size(), KcdcSignificanceMap());
+        for (size_t r=0; r<radii.size(); ++r)
+        {
+            KcdcSignificanceMap& map = maps[r];
+            map.radius = radii[r];
+            map.raBins = raBins;
+            map.decBins = decBins;
+            map.on.resize(bins);
+            map.off.resize(bins);
+            map.excess.resize(bins);
+            map.significance.resize(bins);
+        }
+        RunParallel(threads, radii.size()*decBins, [&](uint32_t, size_t begin, size_t end)
+        {
+            std::vector<int64_t> cols(decBins);
+            for (size_t item=begin; item<end; ++item)
+            {
+                KcdcSignificanceMap& map = maps[item/decBins];
+                const uint32_t row = item%decBins;
+                const int64_t rows = (int64_t)floor(map.radius/real.binSize + 1e-9);
+                const uint32_t rowBegin = row > rows ? row - rows : 0;
+                const uint32_t rowEnd = row + rows + 1 < decBins ? row + rows + 1 : decBins;
+                GetWindowColumns(real, row, rowBegin, rowEnd, map.radius, cols);
+                for (uint32_t j=0; j<raBins; ++j)
+                {
+                    const size_t bin = (size_t)row*raBins + j;
+                    double non(0.0), noff(0.0);
+                    for (uint32_t i=rowBegin; i<rowEnd; ++i)
+                    {
+                        const bool ring = 2*cols[i] + 1 >= raBins;
+                        const int64_t colBegin = ring ? 0 : (int64_t)j - cols[i];
+                        const int64_t colEnd = ring ? raBins : (int64_t)j + cols[i] + 1;
+                        non += on.Sum(i, i+1, colBegin, colEnd);
+                        noff += off.Sum(i, i+1, colBegin, colEnd);
+                    }
+                    map.on[bin] = non;
+                    map.off[bin] = noff;
+                    map.excess[bin] = non - alpha*noff;
+                    map.significance[bin] = GetLiMa(non, noff, alpha);
+                }
+            }
+        });
+        return true;
+    }
+
+protected:
+    ///@brief Number of RA columns cols[i] either side of a bin of row whose centers in row i
+    /// are within radius degrees of the bin center, for the rows [rowBegin, rowEnd)
+    static void GetWindowColumns(const KcdcMapFile& map, uint32_t row, uint32_t rowBegin, uint32_t rowEnd, double radius,
+                                 std::vector<int64_t>& cols)
+    {
+        using namespace Kcdc::DataConstants;
+        const double dec = (map.decMin + (row + 0.5)*map.binSize)*DEG2RAD;
+        const double cosRadius = cos((radius + 1e-9)*DEG2RAD);     // bins on the circle are in
+        for (uint32_t i=rowBegin; i<rowEnd; ++i)
+        {
+            const double deci = (map.decMin + (i + 0.5)*map.binSize)*DEG2RAD;
+            // cos of the largest RA difference: cos(d) = sin(dec)sin(deci) + cos(dec)cos(deci)cos(ra)
+            const double denominator = cos(dec)*cos(deci);
+            const double c = denominator > 0.0 ? (cosRadius - sin(dec)*sin(deci))/denominator : -1.0;
+            if (c <= -1.0) cols[i] = map.raBins;
+            else cols[i] = (int64_t)floor(acos(c > 1.0 ? 1.0 : c)*RAD2DEG/map.binSize + 1e-9);
+        }
+    }
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcSignificance_h_
@@ -0,0 +1,216 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcSimd.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Portable SIMD vector type and vectorized trigonometry
+///
+///  @details VecD holds SIMD_LANES doubles, as many as the compiler target flags allow.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcSimd_h_
+#define _Csi_KcdcSimd_h_
+#include <cmath>
+#include <cstring>
+#include <inttypes.h>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace Csi
+{
+namespace Kcdc
+{
+namespace Simd
+{
+
+#if defined(__AVX512F__)
+const size_t SIMD_LANES = 8;
+#elif defined(__AVX__)
+const size_t SIMD_LANES = 4;
+#elif defined(__SSE2__)
+const size_t SIMD_LANES = 2;
+#else
+const size_t SIMD_LANES = 1;
+#endif
+
+typedef double VecD __attribute__((vector_size(8*SIMD_LANES)));
+typedef int64_t VecI __attribute__((vector_size(8*SIMD_LANES)));
+
+///@brief Name of the instruction set the vector code was compiled for
+inline const char* GetInstructionSet()
+{
+#if defined(__AVX512F__)
+    return "avx512";
+#elif defined(__AVX2__)
+    return "avx2";
+#elif defined(__AVX__)
+    return "avx";
+#elif defined(__SSE2__)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
+
+inline VecD Set(double v)
+{
+    VecD r;
+    for (size_t i=0; i<SIMD_LANES; ++i) r[i] = v;
+    return r;
+}
+
+inline VecI Set64(int64_t v)
+{
+    VecI r;
+    for (size_t i=0; i<SIMD_LANES; ++i) r[i] = v;
+    return r;
+}
+
+inline VecD Load(const double* p)
+{
+    VecD r;
+    memcpy(&r, p, sizeof(r));
+    return r;
+}
+
+inline void Store(double* p, VecD v) { memcpy(p, &v, sizeof(v)); }
+
+/// @brief Lane wise select: mask ? a : b, mask lanes are all ones or all zeros
+inline VecD Select(VecI mask, VecD a, VecD b) { return (VecD)((mask & (VecI)a) | (~mask & (VecI)b)); }
+
+inline VecD Abs(VecD x) { return (VecD)((VecI)x & Set64(0x7fffffffffffffffLL)); }
+
+/// @brief Copy of x with the sign of s
+inline VecD CopySign(VecD x, VecD s)
+{
+    return (VecD)(((VecI)x & Set64(0x7fffffffffffffffLL)) | ((VecI)s & Set64((int64_t)0x8000000000000000ULL)));
+}
+
+inline VecD Sqrt(VecD x)
+{
+#if defined(__AVX512F__)
+    return (VecD)_mm512_sqrt_pd((__m512d)x);
+#elif defined(__AVX__)
+    return (VecD)_mm256_sqrt_pd((__m256d)x);
+#elif defined(__SSE2__)
+    return (VecD)_mm_sqrt_pd((__m128d)x);
+#else
+    VecD r;
+    r[0] = std::sqrt(x[0]);
+    return r;
+#endif
+}
+
+/// @brief Round to nearest integer, for |x| < 2^51
+inline VecD Round(VecD x, VecI& bits)
+{
+    const VecD magic = Set(6755399441055744.0);     // 1.5*2^52
+    VecD t = x + magic;
+    bits = (VecI)t;                                  // low mantissa bits hold the integer
+    return t - magic;
+}
+
+/// @brief Sine and cosine of x given in degrees
+inline void SinCosDeg(VecD x, VecD& s, VecD& c)
+{
+    VecI quadrant;
+    VecD k = Round(x*Set(1.0/90.0), quadrant);
+    VecD z = (x - k*Set(90.0))*Set(M_PI/180.0);
+    VecD zz = z*z;
+    VecD ps = Set(1.58962301576546568060E-10);
+    ps = ps*zz + Set(-2.50507477628578072866E-8);
+    ps = ps*zz + Set(2.75573136213857245213E-6);
+    ps = ps*zz + Set(-1.98412698295895385996E-4);
+    ps = ps*zz + Set(8.33333333332211858878E-3);
+    ps = ps*zz + Set(-1.66666666666666307295E-1);
+    VecD sz = z + z*zz*ps;
+    VecD pc = Set(-1.13585365213876817300E-11);
+    pc = pc*zz + Set(2.08757008419747316778E-9);
+    pc = pc*zz + Set(-2.75573141792967388112E-7);
+    pc = pc*zz + Set(2.48015872888517045348E-5);
+    pc = pc*zz + Set(-1.38888888888730564116E-3);
+    pc = pc*zz + Set(4.16666666666665929218E-2);
+    VecD cz = Set(1.0) - Set(0.5)*zz + zz*zz*pc;
+    // quadrant q: sin(z+q*90), cos(z+q*90)
+    VecI q = quadrant & Set64(3);
+    VecI odd = (q & Set64(1)) != 0;
+    VecD sr = Select(odd, cz, sz);
+    VecD cr = Select(odd, sz, cz);
+    VecI negS = (q == 2) | (q == 3);
+    VecI negC = (q == 1) | (q == 2);
+    s = Select(negS, -sr, sr);
+    c = Select(negC, -cr, cr);
+}
+
+/// @brief atan2(y, x) in radians, Cephes atan with branch free argument reduction
+inline VecD Atan2(VecD y, VecD x)
+{
+    const double T3P8 = 2.41421356237309504880;     // tan(3pi/8)
+    const double MOREBITS = 6.123233995736765886130E-17;
+    VecD ax = Abs(x);
+    VecD ay = Abs(y);
+    VecI big = ay > Set(T3P8)*ax;                    // ratio > tan(3pi/8): pi/2 - atan(x/y)
+    VecI mid = ~big & (ay > Set(0.66)*ax);           // ratio > 0.66: pi/4 + atan((y-x)/(y+x))
+    VecD num = Select(big, -ax, Select(mid, ay - ax, ay));
+    VecD den = Select(big, ay, Select(mid, ay + ax, ax));
+    den = Select(den == Set(0.0), Set(1.0), den);    // atan2(0,0)
+    VecD z = num/den;
+    VecD base = Select(big, Set(M_PI_2), Select(mid, Set(M_PI_4), Set(0.0)));
+    VecD more = Select(big, Set(MOREBITS), Select(mid, Set(0.5*MOREBITS), Set(0.0)));
+    VecD zz = z*z;
+    VecD p = Set(-8.750608600031904122785E-1);
+    p = p*zz + Set(-1.615753718733365076637E1);
+    p = p*zz + Set(-7.500855792314704667340E1);
+    p = p*zz + Set(-1.228866684490136173410E2);
+    p = p*zz + Set(-6.485021904942025371773E1);
+    VecD q = zz + Set(2.485846490142306297962E1);
+    q = q*zz + Set(1.650270098316988542046E2);
+    q = q*zz + Set(4.328810604912902668951E2);
+    q = q*zz + Set(4.853903996359136964868E2);
+    q = q*zz + Set(1.945506571482613964425E2);
+    VecD r = base + (z + z*zz*p/q + more);
+    // first quadrant result to all four quadrants
+    r = Select(x < Set(0.0), Set(M_PI) - r, r);
+    return CopySign(r, y);
+}
+
+/// @brief x reduced to [0, 360)
+inline VecD RangeDegrees(VecD x)
+{
+    VecI bits;
+    VecD k = Round(x*Set(1.0/360.0), bits);
+    VecD r = x - k*Set(360.0);
+    return Select(r < Set(0.0), r + Set(360.0), r);
+}
+
+} // end namespace Simd
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcSimd_h_
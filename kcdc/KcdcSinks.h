@@ -0,0 +1,592 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcSinks.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Record sinks for KcdcReader: filtered writer, maps, scrambler, statistics
+///
+///  @details Several sinks on one KcdcReader share a single pass over the input.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcSinks_h_
+#define _Csi_KcdcSinks_h_
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <inttypes.h>
+#include <libnova/transform.h>
+#include "KcdcCompression.h"
+#include "KcdcEventCache.h"
+#include "KcdcEventStore.h"
+#include "KcdcFormatter.h"
+#include "KcdcHistogram.h"
+#include "KcdcPipeline.h"
+#include "KcdcRandom.h"
+#include "KcdcReader.h"
+#include "KcdcRegions.h"
+#include "KcdcScrambler.h"
+#include "KcdcShard.h"
+#include "KcdcSidereal.h"
+#include "KcdcStats.h"
+#include "KcdcTransform.h"
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief Writes the records within a max distance, or a source of a catalog, as AddFields does
+class KcdcFieldsSink : public KcdcRecordSink
+{
+public:
+    ///@param maxDistance Records with DIST above it are not written
+    ///@param regions If not empty, only records within one of its sources are written, with a
+    /// SOURCES column
+    KcdcFieldsSink(KcdcOutputFile& out, double maxDistance, const KcdcRegionCatalog& regions)
+    : m_out(out), m_maxDistance(maxDistance), m_regions(regions), m_energyPassed(0), m_written(0) {}
+
+    ///@brief Records the sink got, the reader's energy selection passed
+    uint64_t GetEnergyPassed() const { return m_energyPassed; }
+
+    ///@brief Records written
+    uint64_t GetWritten() const { return m_written; }
+
+    ///@brief Continue the counts of an earlier run
+    void SetCounts(uint64_t energyPassed, uint64_t written)
+    {
+        m_energyPassed = energyPassed;
+        m_written = written;
+    }
+
+    virtual KcdcSinkBatch* CreateBatch() { return new Batch(); }
+
+    virtual void Work(const KcdcRecordBatch& batch, KcdcSinkBatch* state, KcdcStageTimes& times)
+    {
+        Batch& b = static_cast<Batch&>(*state);
+        KcdcStageClock clock(batch.timing);
+        Select(batch, b);
+        clock.Lap(times, STAGE_FILTER);
+        Format(batch, b);
+        clock.Lap(times, STAGE_FORMAT);
+    }
+
+    virtual void Consume(const KcdcRecordBatch& batch, KcdcSinkBatch* state, KcdcStageTimes& times)
+    {
+        Batch& b = static_cast<Batch&>(*state);
+        KcdcStageClock clock(batch.timing);
+        m_out.Write(b.out.GetData(), b.out.GetSize());
+        b.out.Clear();
+        clock.Lap(times, STAGE_WRITE);
+        m_energyPassed += batch.records.size();
+        m_written += b.written;
+    }
+
+protected:
+    /// @brief The formatted output of a batch
+    struct Batch : public KcdcSinkBatch
+    {
+        Batch() : out(KcdcReader::s_chunkSize + KcdcReader::s_chunkSize/2), written(0) {}
+        KcdcOutputBuffer out;
+        std::vector<uint8_t> selected;      ///< records written
+        std::vector<uint32_t> sources;      ///< catalog sources of the selected records
+        std::vector<uint32_t> sourceEnd;    ///< end in sources of each record
+        std::string sourceIds;              ///< SOURCES column being formatted
+        uint64_t written;                   ///< records selected
+    };
+
+    /// @brief Set b.selected for the records within the max distance and the catalog
+    void Select(const KcdcRecordBatch& batch, Batch& b) const
+    {
+        const size_t n = batch.records.size();
+        const bool catalog = !m_regions.IsEmpty();
+        b.selected.resize(n);
+        b.sources.clear();
+        b.sourceEnd.resize(catalog ? n : 0);
+        uint64_t written(0);
+        for (size_t i=0; i<n; ++i)
+        {
+            const KcdcDerived& d = batch.derived[i];
+            b.selected[i] = d.dist<=m_maxDistance;
+            if (catalog)
+            {
+                if (b.selected[i] && m_regions.Match(d.ra, d.dec, b.sources) == 0) b.selected[i] = 0;
+                b.sourceEnd[i] = b.sources.size();
+            }
+            written += b.selected[i];
+        }
+        b.written = written;
+    }
+
+    /// @brief Format the selected records of a batch into b.out
+    void Format(const KcdcRecordBatch& batch, Batch& b) const
+    {
+        const size_t n = batch.records.size();
+        b.out.Clear();
+        if (m_regions.IsEmpty())
+        {
+            for (size_t i=0; i<n; ++i)
+            {
+                if (b.selected[i]) KcdcRecordFormatter::AppendRecord(b.out, batch.records[i], batch.derived[i]);
+            }
+            return;
+        }
+        uint32_t begin(0);
+        for (size_t i=0; i<n; ++i)
+        {
+            const uint32_t end = b.sourceEnd[i];
+            if (b.selected[i])
+            {
+                b.sourceIds.clear();
+                for (uint32_t k=begin; k<end; ++k)
+                {
+                    if (k > begin) b.sourceIds += ',';
+                    b.sourceIds += m_regions.Get(b.sources[k]).id;
+                }
+                if (begin == end) b.sourceIds = "-";
+                KcdcRecordFormatter::AppendRecord(b.out, batch.records[i], batch.derived[i], b.sourceIds);
+            }
+            begin = end;
+        }
+    }
+
+    KcdcOutputFile& m_out;
+    const double m_maxDistance;
+    const KcdcRegionCatalog& m_regions;
+    uint64_t m_energyPassed;
+    uint64_t m_written;
+};
+
+///@brief Counts the RA DEC of the records with emin <= E <= emax into a sky map
+class KcdcSkyMapSink : public KcdcRecordSink
+{
+public:
+    KcdcSkyMapSink(double emin, double emax, double binSize=0.5) : m_emin(emin), m_emax(emax), m_map(binSize) {}
+
+    double GetMinEnergy() const { return m_emin; }
+    double GetMaxEnergy() const { return m_emax; }
+
+    SkyHistogram<>& GetMap() { return m_map; }
+    const SkyHistogram<>& GetMap() const { return m_map; }
+
+    virtual void Consume(const KcdcRecordBatch& batch, KcdcSinkBatch* /*state*/, KcdcStageTimes& times)
+    {
+        KcdcStageClock clock(batch.timing);
+        for (size_t i=0; i<batch.records.size(); ++i)
+        {
+            const double e = batch.records[i].e;
+            if (e<m_emin || e>m_emax) continue;
+            m_map.Fill(batch.derived[i].ra, batch.derived[i].dec);
+        }
+        clock.Lap(times, STAGE_HISTOGRAM);
+    }
+
+protected:
+    const double m_emin;
+    const double m_emax;
+    SkyHistogram<> m_map;
+};
+
+///@brief Makes the fake (time scrambled) event map of the records with emin <= E <= emax
+class KcdcScramblerSink : public KcdcRecordSink
+{
+public:
+    ///@param threads Threads that scramble a set
+    ///@param segmentSize Input bytes per segment, as for KcdcData::SetSegmentSize
+    KcdcScramblerSink(double emin, double emax, uint32_t oversampling, uint64_t seed, uint32_t threads,
+                      uint64_t segmentSize, double binSize=0.5)
+    : m_emin(emin), m_emax(emax), m_oversampling(oversampling), m_seed(seed), m_threads(threads > 0 ? threads : 1),
+      m_segmentSize(segmentSize), m_setSize(s_defaultSetSize), m_sliding(false), m_map(binSize),
+      m_shards(m_threads, SkyHistogram<>(binSize)), m_setIndex(0), m_segment(0), m_windowBase(0), m_windowNext(0)
+    {
+        m_scrambler.Reserve(m_setSize);
+    }
+
+    double GetMinEnergy() const { return m_emin; }
+    double GetMaxEnergy() const { return m_emax; }
+
+    ///@brief Set the real events per set (default s_defaultSetSize) and whether sets slide;
+    /// call before the first event
+    void SetEventSets(uint64_t size, bool sliding)
+    {
+        m_setSize = size > 0 ? size : 1;
+        m_sliding = sliding;
+        m_scrambler.Reserve(m_sliding ? m_setSize + m_setSize/2 : m_setSize);
+    }
+
+    ///@brief Get the size set by SetEventSets
+    uint64_t GetSetSize() const { return m_setSize; }
+
+    ///@brief Check whether SetEventSets selected sliding sets
+    bool IsSliding() const { return m_sliding; }
+
+    ///@brief Fake event map; complete after Finish
+    const SkyHistogram<>& GetMap() const { return m_map; }
+
+    ///@brief Fake event map of the sets scrambled so far
+    void GetCurrentMap(SkyHistogram<>& map) const
+    {
+        map = m_map;
+        for (size_t t=0; t<m_shards.size(); ++t) map.Merge(m_shards[t]);
+    }
+
+    ///@brief Real events of the open set
+    const TimeScrambler& GetScrambler() const { return m_scrambler; }
+
+    ///@brief Set number of the open set, segment in the upper 32 bits
+    uint64_t GetSetIndex() const { return m_setIndex; }
+
+    ///@brief Input segment of the open set
+    uint64_t GetSegment() const { return m_segment; }
+
+    ///@brief Index in its segment of the first event of the open set; 0 without sliding sets
+    uint64_t GetWindowBase() const { return m_windowBase; }
+
+    ///@brief Index in its segment of the first event not yet scrambled; 0 without sliding sets
+    uint64_t GetWindowNext() const { return m_windowNext; }
+
+    ///@brief Continue from the state of an earlier run: the map GetCurrentMap returned and
+    /// the open set, whose events are then added with GetScrambler
+    bool Restore(uint64_t setIndex, uint64_t segment, const std::vector<uint64_t>& counts, uint64_t outOfRange,
+                 uint64_t windowBase=0, uint64_t windowNext=0)
+    {
+        m_setIndex = setIndex;
+        m_segment = segment;
+        m_windowBase = windowBase;
+        m_windowNext = windowNext;
+        m_scrambler.Clear();
+        return m_map.Assign(counts, outOfRange);
+    }
+
+    ///@brief Add an event to the open set; see Restore
+    void AddEvent(double hourAngle, double declination, double sidereal)
+    {
+        m_scrambler.AddEvent(hourAngle, declination, sidereal);
+    }
+
+    virtual void Consume(const KcdcRecordBatch& batch, KcdcSinkBatch* /*state*/, KcdcStageTimes& times)
+    {
+        KcdcStageClock clock(batch.timing);
+        // a sliding window scrambles the events whose window is complete once it holds a window and a half
+        const uint64_t fullSize = m_sliding ? m_setSize + m_setSize/2 : m_setSize;
+        for (size_t i=0; i<batch.records.size(); ++i)
+        {
+            const KcdcRecord& rec = batch.records[i];
+            if (rec.e<m_emin || rec.e>m_emax) continue;
+            const uint64_t segment = KcdcShard::GetSegment(batch.offsets[i], m_segmentSize);
+            if (segment != m_segment)
+            {
+                clock.Lap(times, STAGE_HISTOGRAM);
+                StartSegment(segment);
+                clock.Lap(times, STAGE_SCRAMBLE);
+            }
+            ln_hrz_posn inHrzPos;
+            inHrzPos.alt = 90.0 - rec.ze;
+            inHrzPos.az = EnsureCorrectRange(rec.az + 180.0);
+            m_scrambler.AddEvent(inHrzPos, m_sidereal.GetByJulianDate(batch.derived[i].jdays).gast);
+            if (m_scrambler.GetSize() == fullSize)
+            {
+                clock.Lap(times, STAGE_HISTOGRAM);
+                if (m_sliding) ScrambleWindows(false);
+                else ScrambleSet();
+                clock.Lap(times, STAGE_SCRAMBLE);
+            }
+        }
+        clock.Lap(times, STAGE_HISTOGRAM);
+    }
+
+    ///@brief Scramble the last set, which ends with the input (or shard), and add up the map
+    virtual void Finish(KcdcStageTimes& times)
+    {
+        KcdcStageClock clock(true);
+        EndSegment();
+        for (size_t t=0; t<m_shards.size(); ++t)
+        {
+            m_map.Merge(m_shards[t]);
+            m_shards[t] = SkyHistogram<>(m_map.GetBinSize());
+        }
+        clock.Lap(times, STAGE_SCRAMBLE);
+    }
+
+    static const uint64_t s_defaultSetSize = 100000;   ///< real events per scrambling set
+
+protected:
+    /// @brief Scramble the partial set of the previous segment and start the sets of segment
+    void StartSegment(uint64_t segment)
+    {
+        EndSegment();
+        m_segment = segment;
+        m_setIndex = segment << 32;
+    }
+
+    /// @brief Scramble the events of the open set that are not scrambled yet
+    void EndSegment()
+    {
+        if (m_sliding) ScrambleWindows(true);
+        else if (m_scrambler.GetSize() > 0) ScrambleSet();
+    }
+
+    /// @brief Generate the fake events of the open set and start the next set
+    void ScrambleSet()
+    {
+        const uint64_t setSize = m_scrambler.GetSize();
+        ScrambleEvents(0, setSize, [setSize](size_t /*event*/, size_t& first, size_t& size)
+            {
+                first = 0;
+                size = setSize;
+            });
+        m_scrambler.Clear();
+        ++m_setIndex;
+    }
+
+    /// @brief Generate the fake events of the sliding set events whose window is complete
+    void ScrambleWindows(bool segmentEnd)
+    {
+        const uint64_t total = m_windowBase + m_scrambler.GetSize();
+        const uint64_t half = m_setSize/2;
+        const uint64_t end = segmentEnd ? total : (total >= m_setSize ? total - (m_setSize - half) + 1 : 0);
+        if (end > m_windowNext)
+        {
+            const uint64_t base = m_windowBase;
+            const uint64_t setSize = m_setSize;
+            ScrambleEvents(m_windowNext - base, end - m_windowNext, [base, half, total, setSize](size_t event, size_t& first, size_t& size)
+                {
+                    const uint64_t index = base + event;
+                    uint64_t begin = index > half ? index - half : 0;
+                    if (begin + setSize > total) begin = total > setSize ? total - setSize : 0;
+                    first = begin - base;
+                    size = std::min(setSize, total - begin);
+                }, true);
+            m_windowNext = end;
+        }
+        if (segmentEnd)
+        {
+            m_scrambler.Clear();
+            m_windowBase = 0;
+            m_windowNext = 0;
+        }
+        else if (total > m_windowBase + m_setSize)
+        {
+            // the windows of the events after m_windowNext start at total - m_setSize or later
+            m_scrambler.Discard(total - m_setSize - m_windowBase);
+            m_windowBase = total - m_setSize;
+        }
+    }
+
+    /// @brief Generate the fake events of the count open set events from first on
+    template <class Window>
+    void ScrambleEvents(size_t first, size_t count, Window window, bool segmentIndex=false)
+    {
+        RunParallel(m_threads, count, [&](uint32_t thread, size_t begin, size_t end)
+        {
+            SkyHistogram<>& shard = m_shards[thread];
+            EventRandomStream stream(m_seed, m_setIndex, 0);
+            size_t donorFirst(0), donorCount(0);
+            // fake events are binned in blocks
+            static const size_t fakeBlockSize = 1024;
+            double fakeRa[fakeBlockSize], fakeDec[fakeBlockSize];
+            size_t fakeCount(0);
+            m_scrambler.Scramble(first + begin, first + end, m_oversampling,
+                [&](size_t event, uint32_t i)
+                {
+                    if (i == 0)
+                    {
+                        stream = EventRandomStream(m_seed, m_setIndex, (uint32_t)(segmentIndex ? m_windowBase + event : event));
+                        window(event, donorFirst, donorCount);
+                    }
+                    return donorFirst + stream.NextIndex(donorCount);
+                },
+                [&](double ra, double dec)
+                {
+                    fakeRa[fakeCount] = Convert360To180(ra);
+                    fakeDec[fakeCount] = dec;
+                    if (++fakeCount == fakeBlockSize)
+                    {
+                        shard.Fill(fakeCount, fakeRa, fakeDec);
+                        fakeCount = 0;
+                    }
+                });
+            shard.Fill(fakeCount, fakeRa, fakeDec);
+        });
+    }
+
+    const double m_emin;
+    const double m_emax;
+    const uint32_t m_oversampling;
+    const uint64_t m_seed;
+    const uint32_t m_threads;
+    const uint64_t m_segmentSize;
+    uint64_t m_setSize;
+    bool m_sliding;
+    SkyHistogram<> m_map;
+    std::vector<SkyHistogram<> > m_shards;     ///< one per thread, added to m_map by Finish
+    TimeScrambler m_scrambler;                  ///< real events of the open set
+    SiderealTimeCache m_sidereal;
+    uint64_t m_setIndex;
+    uint64_t m_segment;
+    uint64_t m_windowBase;                      ///< segment index of open set event 0 (sliding sets)
+    uint64_t m_windowNext;                      ///< segment index of the first event not yet scrambled
+};
+
+///@brief Count, min, max and mean of every column (KcdcStoreColumn) of the records
+class KcdcStatisticsSink : public KcdcRecordSink
+{
+public:
+    struct Summary
+    {
+        Summary() : count(0), min(std::numeric_limits<double>::infinity()), max(-std::numeric_limits<double>::infinity()), sum(0.0) {}
+        double GetMean() const { return count > 0 ? sum/count : 0.0; }
+        uint64_t count;     ///< values that are not NaN
+        double min;
+        double max;
+        double sum;
+    };
+
+    KcdcStatisticsSink() : m_records(0), m_summary(STORE_COLUMN_COUNT) {}
+
+    ///@brief Value of a KcdcStoreColumn of a record
+    static double GetValue(const KcdcRecord& rec, const KcdcDerived& d, uint32_t column)
+    {
+        switch (column)
+        {
+        case FIELD_E: return rec.e;
+        case FIELD_YC: return rec.yc;
+        case FIELD_XC: return rec.xc;
+        case FIELD_ZE: return rec.ze;
+        case FIELD_AZ: return rec.az;
+        case FIELD_NE: return rec.ne;
+        case FIELD_NMU: return rec.nmu;
+        case FIELD_ESUMHAD: return rec.esumhad;
+        case FIELD_NHAD: return rec.nhad;
+        case FIELD_T: return rec.t;
+        case FIELD_P: return rec.p;
+        case FIELD_GT: return rec.gt;
+        case FIELD_MT: return rec.mt;
+        case FIELD_YMD: return rec.ymd;
+        case FIELD_HMS: return rec.hms;
+        case FIELD_R: return rec.r;
+        case FIELD_EV: return rec.ev;
+        case FIELD_AGE: return rec.age;
+        case STORE_RA: return d.ra;
+        case STORE_DEC: return d.dec;
+        case STORE_LON: return d.lon;
+        case STORE_LAT: return d.lat;
+        case STORE_JDAYS: return d.jdays;
+        case STORE_DIST: return d.dist;
+        }
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    ///@brief Records counted
+    uint64_t GetRecords() const { return m_records; }
+
+    const Summary& Get(uint32_t column) const { return m_summary[column]; }
+
+    virtual void Consume(const KcdcRecordBatch& batch, KcdcSinkBatch* /*state*/, KcdcStageTimes& times)
+    {
+        KcdcStageClock clock(batch.timing);
+        for (size_t i=0; i<batch.records.size(); ++i)
+        {
+            for (uint32_t c=0; c<STORE_COLUMN_COUNT; ++c)
+            {
+                const double v = GetValue(batch.records[i], batch.derived[i], c);
+                if (std::isnan(v)) continue;
+                Summary& s = m_summary[c];
+                ++s.count;
+                if (v < s.min) s.min = v;
+                if (v > s.max) s.max = v;
+                s.sum += v;
+            }
+        }
+        m_records += batch.records.size();
+        clock.Lap(times, STAGE_HISTOGRAM);
+    }
+
+    ///@brief Write a line "column count min max mean" per column
+    void Write(std::ostream& os) const
+    {
+        os << std::setprecision(10);
+        for (uint32_t c=0; c<STORE_COLUMN_COUNT; ++c)
+        {
+            const Summary& s = m_summary[c];
+            os << std::setw(8) << KcdcEventStore::GetColumnName(c) << " " << s.count;
+            if (s.count > 0) os << " " << s.min << " " << s.max << " " << s.GetMean();
+            os << "\n";
+        }
+    }
+
+protected:
+    uint64_t m_records;
+    std::vector<Summary> m_summary;     ///< by column
+};
+
+///@brief Appends the records to an event cache, with their input offsets
+class KcdcEventCacheSink : public KcdcRecordSink
+{
+public:
+    explicit KcdcEventCacheSink(KcdcEventCacheWriter& writer) : m_writer(writer) {}
+
+    virtual void Consume(const KcdcRecordBatch& batch, KcdcSinkBatch* /*state*/, KcdcStageTimes& times)
+    {
+        KcdcStageClock clock(batch.timing);
+        for (size_t i=0; i<batch.records.size(); ++i) m_writer.Append(batch.records[i], batch.derived[i], batch.offsets[i]);
+        clock.Lap(times, STAGE_WRITE);
+    }
+
+protected:
+    KcdcEventCacheWriter& m_writer;
+};
+
+///@brief Appends the records to an event store, until a value does not fit it
+class KcdcEventStoreSink : public KcdcRecordSink
+{
+public:
+    explicit KcdcEventStoreSink(KcdcEventStore& store) : m_store(store), m_ok(true) {}
+
+    ///@brief False once a record could not be appended (KcdcEventStore::GetError)
+    bool IsOk() const { return m_ok; }
+
+    virtual void Consume(const KcdcRecordBatch& batch, KcdcSinkBatch* /*state*/, KcdcStageTimes& times)
+    {
+        KcdcStageClock clock(batch.timing);
+        for (size_t i=0; m_ok && i<batch.records.size(); ++i) m_ok = m_store.Append(batch.records[i], batch.derived[i]);
+        clock.Lap(times, STAGE_WRITE);
+    }
+
+protected:
+    KcdcEventStore& m_store;
+    bool m_ok;
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcSinks_h_
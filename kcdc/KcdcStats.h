@@ -0,0 +1,324 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcStats.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Throughput counters and stage timing of a processing run
+///
+///  @details Stage timing, counters, a periodic progress line and a JSON summary of a run.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcStats_h_
+#define _Csi_KcdcStats_h_
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <inttypes.h>
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief Processing stages timed by KcdcStageClock
+enum KcdcStage
+{
+    STAGE_READ = 0,         ///< reading and decompressing input
+    STAGE_PARSE,            ///< tokenizing and decoding records
+    STAGE_TRANSFORM,        ///< horizontal to equatorial and galactic coordinates
+    STAGE_FILTER,           ///< energy and distance selection
+    STAGE_HISTOGRAM,        ///< filling the real event maps
+    STAGE_SCRAMBLE,         ///< generating and binning the fake events
+    STAGE_FORMAT,           ///< formatting output records
+    STAGE_WRITE,            ///< writing output
+    STAGE_COUNT
+};
+
+///@brief Returns the name of a KcdcStage as used in the reports
+inline const char* GetStageName(uint32_t stage)
+{
+    static const char* names[STAGE_COUNT] = {"read", "parse", "transform", "filter", "histogram", "scramble", "format", "write"};
+    return stage<STAGE_COUNT ? names[stage] : "?";
+}
+
+///@brief Nanoseconds spent in each KcdcStage
+struct KcdcStageTimes
+{
+    KcdcStageTimes() { Clear(); }
+    void Clear() { for (uint32_t s=0; s<STAGE_COUNT; ++s) ns[s] = 0; }
+    void Merge(const KcdcStageTimes& rhs) { for (uint32_t s=0; s<STAGE_COUNT; ++s) ns[s] += rhs.ns[s]; }
+    uint64_t GetTotal() const
+    {
+        uint64_t t(0);
+        for (uint32_t s=0; s<STAGE_COUNT; ++s) t += ns[s];
+        return t;
+    }
+    uint64_t ns[STAGE_COUNT];
+};
+
+///@brief Lap timer: each Lap adds the time since the previous lap (or Start) to a stage
+class KcdcStageClock
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit KcdcStageClock(bool enabled) : m_enabled(enabled) { Start(); }
+
+    bool IsEnabled() const { return m_enabled; }
+
+    ///@brief Begin timing, e.g. after a wait that belongs to no stage
+    void Start() { if (m_enabled) m_last = Clock::now(); }
+
+    void Lap(KcdcStageTimes& times, KcdcStage stage)
+    {
+        if (!m_enabled) return;
+        Clock::time_point now = Clock::now();
+        times.ns[stage] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_last).count();
+        m_last = now;
+    }
+
+protected:
+    bool m_enabled;
+    Clock::time_point m_last;
+};
+
+///@brief Counters and stage times of one AddFields, WriteEventCache or ProcessEventStats run
+class KcdcRunStats
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    KcdcRunStats() : m_records(0), m_bytes(0), m_malformed(0), m_interval(0.0), m_reportedRecords(0) {}
+
+    ///@brief Start a run, clearing everything
+    ///@param interval Seconds between progress lines; 0 for none
+    void Begin(const std::string& operation, const std::string& input, const std::string& output, double interval)
+    {
+        m_operation = operation;
+        m_input = input;
+        m_output = output;
+        m_settings.clear();
+        m_counters.clear();
+        m_times.Clear();
+        m_records = m_bytes = m_malformed = m_reportedRecords = 0;
+        m_interval = interval;
+        m_start = m_lastReport = Clock::now();
+        m_end = m_start;
+    }
+
+    ///@brief Stop the wall clock
+    void End() { m_end = Clock::now(); }
+
+    ///@brief Record a setting of the run, e.g. the transform mode, for the summary
+    void SetSetting(const std::string& name, const std::string& value) { Set(m_settings, name, value); }
+
+    ///@brief Set a named counter, e.g. the records passing a filter
+    void SetCounter(const std::string& name, uint64_t value) { Set(m_counters, name, std::to_string(value)); }
+
+    ///@brief Set the input records and bytes read so far
+    void SetProgress(uint64_t records, uint64_t bytes)
+    {
+        m_records = records;
+        m_bytes = bytes;
+    }
+
+    void SetMalformed(uint64_t malformed) { m_malformed = malformed; }
+
+    ///@brief Add stage times, e.g. those of a worker
+    void AddTimes(const KcdcStageTimes& times) { m_times.Merge(times); }
+
+    const KcdcStageTimes& GetTimes() const { return m_times; }
+    uint64_t GetRecords() const { return m_records; }
+    uint64_t GetBytes() const { return m_bytes; }
+
+    ///@brief Seconds since Begin, or between Begin and End
+    double GetElapsed() const
+    {
+        Clock::time_point end = (m_end == m_start) ? Clock::now() : m_end;
+        return std::chrono::duration<double>(end - m_start).count();
+    }
+
+    ///@brief True if a progress line is due; reads the clock
+    bool IsReportDue() const
+    {
+        return m_interval > 0.0 && std::chrono::duration<double>(Clock::now() - m_lastReport).count() >= m_interval;
+    }
+
+    ///@brief Print a progress line: records, rates of the last interval and the stage split
+    void ReportLine(std::ostream& os)
+    {
+        Clock::time_point now = Clock::now();
+        double dt = std::chrono::duration<double>(now - m_lastReport).count();
+        double rate = dt > 0.0 ? (m_records - m_reportedRecords)/dt : 0.0;
+        double elapsed = std::chrono::duration<double>(now - m_start).count();
+        char line[256];
+        int n = snprintf(line, sizeof(line), "%12" PRIu64 " records %8.1f s %10.0f rec/s %8.1f MB/s avg",
+                         m_records, elapsed, rate, elapsed > 0.0 ? m_bytes/elapsed/1e6 : 0.0);
+        os << "\n" << std::string(line, n > 0 ? n : 0) << GetStageSplit() << std::flush;
+        m_lastReport = now;
+        m_reportedRecords = m_records;
+    }
+
+    ///@brief Percentage of the timed work per stage, e.g. " parse 40% transform 35%"
+    std::string GetStageSplit() const
+    {
+        std::string s;
+        uint64_t total = m_times.GetTotal();
+        if (total == 0) return s;
+        for (uint32_t st=0; st<STAGE_COUNT; ++st)
+        {
+            if (m_times.ns[st] == 0) continue;
+            s += std::string(" ") + GetStageName(st) + " " + std::to_string((100*m_times.ns[st] + total/2)/total) + "%";
+        }
+        return s;
+    }
+
+    ///@brief Print the run summary lines
+    void Report(std::ostream& os) const
+    {
+        double elapsed = GetElapsed();
+        char line[256];
+        int n = snprintf(line, sizeof(line), "%" PRIu64 " records in %.3f s: %.0f rec/s, %.1f MB/s",
+                         m_records, elapsed, elapsed > 0.0 ? m_records/elapsed : 0.0,
+                         elapsed > 0.0 ? m_bytes/elapsed/1e6 : 0.0);
+        os << "\n" << std::string(line, n > 0 ? n : 0);
+        if (m_times.GetTotal() > 0) os << "\nStage time:" << GetStageSplit();
+        os << "\n";
+    }
+
+    ///@brief Write the summary as a JSON object
+    void WriteJson(std::ostream& os) const
+    {
+        double elapsed = GetElapsed();
+        os << "{\n";
+        os << "  \"operation\": " << Quote(m_operation) << ",\n";
+        os << "  \"input\": " << Quote(m_input) << ",\n";
+        os << "  \"output\": " << Quote(m_output) << ",\n";
+        os << "  \"settings\": {";
+        for (size_t i=0; i<m_settings.size(); ++i)
+        {
+            os << (i>0 ? ", " : "") << Quote(m_settings[i].first) << ": " << Quote(m_settings[i].second);
+        }
+        os << "},\n";
+        os << "  \"wall_seconds\": " << Number(elapsed) << ",\n";
+        os << "  \"records\": " << m_records << ",\n";
+        os << "  \"bytes\": " << m_bytes << ",\n";
+        os << "  \"records_per_second\": " << Number(elapsed > 0.0 ? m_records/elapsed : 0.0) << ",\n";
+        os << "  \"bytes_per_second\": " << Number(elapsed > 0.0 ? m_bytes/elapsed : 0.0) << ",\n";
+        os << "  \"malformed\": " << m_malformed << ",\n";
+        os << "  \"counters\": {";
+        for (size_t i=0; i<m_counters.size(); ++i)
+        {
+            os << (i>0 ? ", " : "") << Quote(m_counters[i].first) << ": " << m_counters[i].second;
+        }
+        os << "},\n";
+        os << "  \"stage_seconds\": {";
+        for (uint32_t st=0; st<STAGE_COUNT; ++st)
+        {
+            os << (st>0 ? ", " : "") << Quote(GetStageName(st)) << ": " << Number(m_times.ns[st]*1e-9);
+        }
+        os << "}\n";
+        os << "}\n";
+    }
+
+    ///@brief Write the JSON summary to fname
+    ///@return false if the file cannot be written
+    bool WriteJson(const std::string& fname) const
+    {
+        std::ofstream os(fname.c_str(), std::ios::binary);
+        if (!os) return false;
+        WriteJson(os);
+        os.close();
+        return !os.fail();
+    }
+
+protected:
+    typedef std::vector<std::pair<std::string, std::string> > Entries;
+
+    static void Set(Entries& entries, const std::string& name, const std::string& value)
+    {
+        for (size_t i=0; i<entries.size(); ++i)
+        {
+            if (entries[i].first == name)
+            {
+                entries[i].second = value;
+                return;
+            }
+        }
+        entries.push_back(std::make_pair(name, value));
+    }
+
+    static std::string Quote(const std::string& s)
+    {
+        std::string q("\"");
+        for (size_t i=0; i<s.size(); ++i)
+        {
+            unsigned char c = s[i];
+            if (c == '"' || c == '\\') q += '\\', q += c;
+            else if (c < 0x20)
+            {
+                char esc[8];
+                snprintf(esc, sizeof(esc), "\\u%04x", c);
+                q += esc;
+            }
+            else q += c;
+        }
+        return q + "\"";
+    }
+
+    static std::string Number(double v)
+    {
+        char s[32];
+        snprintf(s, sizeof(s), "%.6g", v);
+        return s;
+    }
+
+    std::string m_operation;
+    std::string m_input;
+    std::string m_output;
+    Entries m_settings;
+    Entries m_counters;             ///< values already formatted
+    KcdcStageTimes m_times;
+    uint64_t m_records;
+    uint64_t m_bytes;
+    uint64_t m_malformed;
+    double m_interval;              ///< seconds between progress lines
+    uint64_t m_reportedRecords;     ///< m_records at the last progress line
+    Clock::time_point m_start;
+    Clock::time_point m_end;
+    Clock::time_point m_lastReport;
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcStats_h_
@@ -0,0 +1,285 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcTransform.h
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Batched horizontal to equatorial to galactic coordinate transform
+///
+///  @details Structure of arrays transforms written as rotations of unit vectors.
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#ifndef _Csi_KcdcTransform_h_
+#define _Csi_KcdcTransform_h_
+#include <cmath>
+#include <mutex>
+#include <vector>
+#include <inttypes.h>
+#include <libnova/sidereal_time.h>
+#include "Vector.h"
+#include "KcdcConstants.h"
+#include "KcdcSimd.h"
+
+namespace Csi
+{
+namespace Kcdc
+{
+
+///@brief How KcdcData computes equatorial and galactic coordinates
+enum TransformMode
+{
+    TRANSFORM_LIBNOVA = 0,      ///< ln_get_equ_from_hrz formulas in double, RA DEC within 1e-11 degrees, and ln_get_gal_from_equ (default)
+    TRANSFORM_BATCH,            ///< blocks of events through KcdcBatchTransform, within 1e-9 degrees of libnova
+    TRANSFORM_CACHED            ///< libnova formulas with KcdcGalacticRotation, LON LAT within 1e-11 degrees
+};
+
+///@brief Serializes libnova calls that are not thread safe
+inline std::mutex& GetLibnovaMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+///@brief Ensures input is in range 0-360
+inline double EnsureCorrectRange(double alpha)
+{
+    double tmp = (int)(alpha / 360);
+    if (alpha < 0.0) tmp --;
+    tmp *= 360.0;
+    return alpha - tmp;
+}
+
+///@brief Convert from 360 degrees to +/-180
+inline double Convert360To180(double alpha)
+{
+    if(alpha >= 180.)return alpha - 360.;
+    return alpha;
+}
+
+///@brief Structure of arrays for a block of events
+struct KcdcEventBlock
+{
+    KcdcEventBlock() : size(0) {}
+
+    void Resize(size_t n)
+    {
+        size = n;
+        zenith.resize(n);
+        azimuth.resize(n);
+        jd.resize(n);
+        lst.resize(n);
+        ra.resize(n);
+        dec.resize(n);
+        lon.resize(n);
+        lat.resize(n);
+    }
+
+    size_t size;
+    std::vector<double> zenith;
+    std::vector<double> azimuth;
+    std::vector<double> jd;
+    std::vector<double> lst;        ///< local apparent sidereal time
+    std::vector<double> ra;         ///< 0 to 360
+    std::vector<double> dec;
+    std::vector<double> lon;        ///< galactic longitude 0 to 360
+    std::vector<double> lat;        ///< galactic latitude
+};
+
+///@brief Equatorial to galactic coordinates as a fixed rotation of unit vectors
+class KcdcGalacticRotation
+{
+public:
+    KcdcGalacticRotation(double poleRa = DataConstants::GAL_N_POLE_RA_B1950,
+                         double poleDec = DataConstants::GAL_N_POLE_DEC_B1950,
+                         double lon0 = DataConstants::GAL_LON0_B1950)
+    {
+        using namespace DataConstants;
+        const double sinRa = sin(poleRa*DEG2RAD), cosRa = cos(poleRa*DEG2RAD);
+        const double sinDec = sin(poleDec*DEG2RAD), cosDec = cos(poleDec*DEG2RAD);
+        // l = lon0 + 180 - atan2(v.b, v.a), b = asin(v.pole) for a unit vector v
+        const Vector pole(cosDec*cosRa, cosDec*sinRa, sinDec);
+        const Vector a(sinDec*cosRa, sinDec*sinRa, -cosDec);
+        const Vector b(sinRa, -cosRa, 0.0);
+        const double sinL = sin((lon0 + 180.0)*DEG2RAD), cosL = cos((lon0 + 180.0)*DEG2RAD);
+        m_row[0] = a*cosL + b*sinL;
+        m_row[1] = a*sinL - b*cosL;
+        m_row[2] = pole;
+    }
+
+    ///@brief Unit vector of an equatorial (or galactic) position in degrees
+    static Vector GetUnitVector(double ra, double dec)
+    {
+        using namespace DataConstants;
+        const double cosDec = cos(dec*DEG2RAD);
+        return Vector(cosDec*cos(ra*DEG2RAD), cosDec*sin(ra*DEG2RAD), sin(dec*DEG2RAD));
+    }
+
+    ///@brief Row i of the rotation: the galactic x, y and z axes in equatorial coordinates
+    const Vector& GetRow(int i) const { return m_row[i]; }
+
+    ///@brief Rotate the unit vector of an equatorial position
+    Vector Rotate(const Vector& v) const { return Vector(m_row[0]*v, m_row[1]*v, m_row[2]*v); }
+
+    ///@brief Galactic longitude 0 to 360 and latitude of ra, dec (degrees)
+    void Transform(double ra, double dec, double& lon, double& lat) const
+    {
+        using namespace DataConstants;
+        const Vector g = Rotate(GetUnitVector(ra, dec));
+        lon = EnsureCorrectRange(atan2(g.y, g.x)*RAD2DEG);
+        lat = atan2(g.z, sqrt(g.x*g.x + g.y*g.y))*RAD2DEG;
+    }
+
+    ///@brief Transform n positions; lon and lat may be ra and dec
+    void Transform(size_t n, const double* ra, const double* dec, double* lon, double* lat) const
+    {
+        for (size_t i=0; i<n; ++i) Transform(ra[i], dec[i], lon[i], lat[i]);
+    }
+
+protected:
+    Vector m_row[3];
+};
+
+///@brief Vectorized horizontal -> equatorial -> galactic transform for an observer
+class KcdcBatchTransform
+{
+public:
+    KcdcBatchTransform(double latitude = DataConstants::KASCADE_LATITUDE,
+                       double longitude = DataConstants::KASCADE_LONGITUDE)
+    : m_longitude(longitude)
+    {
+        using namespace DataConstants;
+        m_sinLat = sin(latitude*DEG2RAD);
+        m_cosLat = cos(latitude*DEG2RAD);
+        m_sinPole = sin(GAL_N_POLE_DEC_B1950*DEG2RAD);
+        m_cosPole = cos(GAL_N_POLE_DEC_B1950*DEG2RAD);
+    }
+
+    ///@brief Local apparent sidereal time in degrees at Julian date jd
+    double GetLocalSiderealTime(double jd) const
+    {
+        double gast;
+        {
+            std::lock_guard<std::mutex> lock(GetLibnovaMutex());
+            gast = ln_get_apparent_sidereal_time(jd);
+        }
+        return gast*15.0 + m_longitude;
+    }
+
+    ///@brief Fill block.lst from block.jd and transform the block
+    ///@param galactic If false, lon and lat are not computed
+    void Transform(KcdcEventBlock& block, bool galactic=true) const
+    {
+        double lastJd(0.0), lastLst(0.0);
+        for (size_t i=0; i<block.size; ++i)
+        {
+            // events are time ordered, so consecutive events often share a timestamp
+            if (i==0 || block.jd[i]!=lastJd)
+            {
+                lastJd = block.jd[i];
+                lastLst = GetLocalSiderealTime(lastJd);
+            }
+            block.lst[i] = lastLst;
+        }
+        Transform(block.size, &block.zenith[0], &block.azimuth[0], &block.lst[0], &block.ra[0], &block.dec[0],
+                  galactic ? &block.lon[0] : 0, galactic ? &block.lat[0] : 0);
+    }
+
+    ///@brief Transform n events given zenith, azimuth and local sidereal time (degrees)
+    ///@param lon, lat May both be null to skip the galactic transform
+    void Transform(size_t n, const double* zenith, const double* azimuth, const double* lst,
+                   double* ra, double* dec, double* lon, double* lat) const
+    {
+        using namespace Simd;
+        const size_t full = n - n%SIMD_LANES;
+        for (size_t i=0; i<full; i+=SIMD_LANES)
+        {
+            Kernel(zenith+i, azimuth+i, lst+i, ra+i, dec+i, lon ? lon+i : 0, lat ? lat+i : 0);
+        }
+        if (full < n)
+        {
+            // pad the tail to a full vector
+            double in[3][SIMD_LANES] = {{0.0}}, out[4][SIMD_LANES];
+            for (size_t i=full; i<n; ++i)
+            {
+                in[0][i-full] = zenith[i];
+                in[1][i-full] = azimuth[i];
+                in[2][i-full] = lst[i];
+            }
+            Kernel(in[0], in[1], in[2], out[0], out[1], lon ? out[2] : 0, lat ? out[3] : 0);
+            for (size_t i=full; i<n; ++i)
+            {
+                ra[i] = out[0][i-full];
+                dec[i] = out[1][i-full];
+                if (lon) lon[i] = out[2][i-full];
+                if (lat) lat[i] = out[3][i-full];
+            }
+        }
+    }
+
+protected:
+    /// @brief Transform SIMD_LANES events
+    void Kernel(const double* zenith, const double* azimuth, const double* lst,
+                double* ra, double* dec, double* lon, double* lat) const
+    {
+        using namespace Simd;
+        using namespace DataConstants;
+        VecD sinZe, cosZe, sinAz, cosAz;
+        SinCosDeg(Load(zenith), sinZe, cosZe);           // altitude h = 90-ze: sin h = cos ze, cos h = sin ze
+        SinCosDeg(Load(azimuth), sinAz, cosAz);          // libnova A = az+180: sin A = -sin az, cos A = -cos az
+        // unit vector in the hour angle frame: (cos dec cos H, cos dec sin H, sin dec)
+        VecD x = cosZe*Set(m_cosLat) - cosAz*sinZe*Set(m_sinLat);
+        VecD y = -(sinAz*sinZe);
+        VecD z = cosZe*Set(m_sinLat) + cosAz*sinZe*Set(m_cosLat);
+        VecD rho = Sqrt(x*x + y*y);
+        VecD hourAngle = Atan2(y, x)*Set(RAD2DEG);
+        VecD vlst = Load(lst);
+        Store(ra, RangeDegrees(vlst - hourAngle));
+        Store(dec, Atan2(z, rho)*Set(RAD2DEG));
+        if (!lon || !lat) return;
+
+        // a = pole ra - ra = (pole ra - lst) + H, rotate (x,y) by pole ra - lst
+        VecD sinT, cosT;
+        SinCosDeg(Set(GAL_N_POLE_RA_B1950) - vlst, sinT, cosT);
+        VecD rhoCosA = cosT*x - sinT*y;
+        VecD rhoSinA = sinT*x + cosT*y;
+        VecD gx = rhoCosA*Set(m_sinPole) - z*Set(m_cosPole);
+        VecD gz = z*Set(m_sinPole) + rhoCosA*Set(m_cosPole);
+        Store(lon, RangeDegrees(Set(GAL_LON0_B1950 + 180.0) - Atan2(rhoSinA, gx)*Set(RAD2DEG)));
+        Store(lat, Atan2(gz, Sqrt(gx*gx + rhoSinA*rhoSinA))*Set(RAD2DEG));
+    }
+
+    double m_longitude;
+    double m_sinLat;
+    double m_cosLat;
+    double m_sinPole;
+    double m_cosPole;
+};
+
+} // end namespace Kcdc
+} // end namespace Csi
+#endif // _Csi_KcdcTransform_h_
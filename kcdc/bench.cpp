@@ -0,0 +1,347 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   bench.cpp
+///
+///  @author: Doug Reitz\n
+///  url:     https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Benchmark of the KCDC processing stages on synthetic data
+///
+///  Generates a synthetic KCDC file (KcdcEventGenerator), times parsing, Julian dates, the
+///  coordinate transforms, histogram filling and formatting separately, then AddFields and
+///  ProcessEventStats end to end, and writes the results as JSON.
+///
+///  Usage: bench [-n records] [-r repeat] [-t threads] [-d data file] [-o json file]
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "KcdcData.h"
+#include "KcdcGenerator.h"
+
+using namespace Csi::Kcdc;
+
+namespace
+{
+
+struct BenchResult
+{
+   std::string name;
+   double seconds;
+   uint64_t records;
+};
+
+double Now()
+{
+   return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// @brief Best of repeat runs of stage()
+template <class Stage>
+BenchResult Time(const std::string& name, uint64_t records, uint32_t repeat, Stage stage)
+{
+   double best(0.0);
+   for (uint32_t i=0; i<repeat; ++i)
+   {
+      double start = Now();
+      stage();
+      double t = Now() - start;
+      if (i==0 || t<best) best = t;
+   }
+   BenchResult r = {name, best, records};
+   std::cout << "   " << name << ": " << best << " s, " << (best>0.0 ? records/best : 0.0) << " rec/s\n";
+   return r;
+}
+
+void WriteResults(std::ostream& os, const std::vector<BenchResult>& results)
+{
+   for (size_t i=0; i<results.size(); ++i)
+   {
+      const BenchResult& r = results[i];
+      char line[256];
+      snprintf(line, sizeof(line), "    {\"name\": \"%s\", \"seconds\": %.6g, \"records\": %" PRIu64 ", \"records_per_second\": %.6g}%s\n",
+               r.name.c_str(), r.seconds, r.records, r.seconds>0.0 ? r.records/r.seconds : 0.0,
+               i+1<results.size() ? "," : "");
+      os << line;
+   }
+}
+
+} // end namespace
+
+int main(int argc, char** argv)
+{
+   using namespace Csi::Kcdc::DataConstants;
+   uint64_t records(1000000);
+   uint32_t repeat(3);
+   uint32_t threads(1);
+   std::string dataFile("bench.data.txt");
+   std::string jsonFile("bench.json");
+   for (int i=1; i+1<argc; i+=2)
+   {
+      if (!strcmp(argv[i], "-n")) records = strtoull(argv[i+1], 0, 10);
+      else if (!strcmp(argv[i], "-r")) repeat = strtoul(argv[i+1], 0, 10);
+      else if (!strcmp(argv[i], "-t")) threads = strtoul(argv[i+1], 0, 10);
+      else if (!strcmp(argv[i], "-d")) dataFile = argv[i+1];
+      else if (!strcmp(argv[i], "-o")) jsonFile = argv[i+1];
+      else
+      {
+         std::cout << "Usage: bench [-n records] [-r repeat] [-t threads] [-d data file] [-o json file]\n";
+         return 1;
+      }
+   }
+   if (repeat == 0) repeat = 1;
+
+   std::cout << "Generating " << records << " records (" << dataFile << ")\n";
+   std::vector<BenchResult> stages;
+   bool written(false);
+   stages.push_back(Time("generate", records, 1, [&]()
+   {
+      KcdcEventGenerator generator;
+      written = generator.WriteFile(dataFile, records);
+   }));
+   if (!written)
+   {
+      std::cout << "Unable to write " << dataFile << "\n";
+      return 1;
+   }
+   std::ifstream in(dataFile.c_str(), std::ios::binary);
+   std::stringstream ss;
+   ss << in.rdbuf();
+   const std::string text = ss.str();
+   const std::string_view body = std::string_view(text).substr(text.find('\n') + 1);
+
+   std::cout << "Stages (best of " << repeat << ", " << Simd::GetInstructionSet() << ")\n";
+   double checksum(0.0);        // keeps the compiler from dropping the stage results
+   std::vector<KcdcRecord> recs;
+   recs.reserve(records);
+   stages.push_back(Time("parse", records, repeat, [&]()
+   {
+      recs.clear();
+      KcdcRecordParser parser;
+      const char* p = body.data();
+      const char* end = p + body.size();
+      while (p < end)
+      {
+         const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+         const char* lineEnd = nl ? nl : end;
+         KcdcRecord rec;
+         if (parser.Parse(std::string_view(p, lineEnd - p), rec) == KcdcRecordParser::PARSE_OK) recs.push_back(rec);
+         p = nl ? nl + 1 : end;
+      }
+   }));
+   const size_t n = recs.size();
+
+   KcdcData data;
+   std::vector<double> jd(n);
+   stages.push_back(Time("julian_date", n, repeat, [&]()
+   {
+      for (size_t i=0; i<n; ++i) jd[i] = data.GetJulianDate(recs[i].ymd, recs[i].hms, 0);
+   }));
+
+   ln_lnlat_posn observer;
+   observer.lat = KASCADE_LATITUDE;
+   observer.lng = KASCADE_LONGITUDE;
+   std::vector<double> ra(n), dec(n), lon(n), lat(n);
+   stages.push_back(Time("transform_libnova", n, repeat, [&]()
+   {
+      for (size_t i=0; i<n; ++i)
+      {
+         ln_hrz_posn hrz;
+         ln_equ_posn equ;
+         ln_gal_posn gal;
+         hrz.alt = 90.0 - recs[i].ze;
+         hrz.az = data.EnsureCorrectRange(recs[i].az + 180.0);
+         ln_get_equ_from_hrz(&hrz, &observer, jd[i], &equ);
+         ln_get_gal_from_equ(&equ, &gal);
+         ra[i] = data.Convert360To180(equ.ra);
+         dec[i] = equ.dec;
+         lon[i] = gal.l;
+         lat[i] = gal.b;
+      }
+   }));
+   const KcdcGalacticRotation galactic;
+   stages.push_back(Time("transform_cached", n, repeat, [&]()
+   {
+      SiderealTimeCache sidereal;
+      for (size_t i=0; i<n; ++i)
+      {
+         ln_hrz_posn hrz;
+         ln_equ_posn equ;
+         hrz.alt = 90.0 - recs[i].ze;
+         hrz.az = data.EnsureCorrectRange(recs[i].az + 180.0);
+         const SiderealTime& st = sidereal.Get(recs[i].ymd, recs[i].hms);
+         GetEquatorialFromHorizontal(hrz, observer, st.gast, equ);
+         ra[i] = data.Convert360To180(equ.ra);
+         dec[i] = equ.dec;
+      }
+      galactic.Transform(n, &ra[0], &dec[0], &lon[0], &lat[0]);
+   }));
+   stages.push_back(Time("galactic_libnova", n, repeat, [&]()
+   {
+      for (size_t i=0; i<n; ++i)
+      {
+         ln_equ_posn equ;
+         ln_gal_posn gal;
+         equ.ra = ra[i];
+         equ.dec = dec[i];
+         ln_get_gal_from_equ(&equ, &gal);
+         lon[i] = gal.l;
+         lat[i] = gal.b;
+      }
+   }));
+   stages.push_back(Time("galactic_rotation", n, repeat, [&]()
+   {
+      galactic.Transform(n, &ra[0], &dec[0], &lon[0], &lat[0]);
+   }));
+   stages.push_back(Time("transform_batch", n, repeat, [&]()
+   {
+      SiderealTimeCache sidereal;
+      KcdcBatchTransform transform;
+      KcdcEventBlock block;
+      const size_t blockSize = 4096;
+      for (size_t begin=0; begin<n; begin+=blockSize)
+      {
+         const size_t m = std::min(blockSize, n - begin);
+         block.Resize(m);
+         for (size_t k=0; k<m; ++k)
+         {
+            const KcdcRecord& rec = recs[begin+k];
+            block.zenith[k] = rec.ze;
+            block.azimuth[k] = rec.az;
+            block.lst[k] = SiderealTimeCache::GetLocalSiderealTime(sidereal.Get(rec.ymd, rec.hms));
+         }
+         transform.Transform(m, &block.zenith[0], &block.azimuth[0], &block.lst[0], &ra[begin], &dec[begin],
+                             &lon[begin], &lat[begin]);
+         for (size_t k=0; k<m; ++k) ra[begin+k] = data.Convert360To180(ra[begin+k]);
+      }
+   }));
+   for (size_t i=0; i<n; i+=997) checksum += ra[i] + dec[i] + lon[i] + lat[i];
+
+   SkyHistogram<> map(0.5);
+   stages.push_back(Time("histogram_fill", n, repeat, [&]()
+   {
+      map.Clear();
+      for (size_t i=0; i<n; ++i) map.Fill(ra[i], dec[i]);
+   }));
+   stages.push_back(Time("histogram_fill_batched", n, repeat, [&]()
+   {
+      map.Clear();
+      map.Fill(n, &ra[0], &dec[0]);
+   }));
+   checksum += map.GetTotal();
+
+   uint64_t formatted(0);
+   stages.push_back(Time("format", n, repeat, [&]()
+   {
+      KcdcOutputBuffer out;
+      KcdcDerived d;
+      formatted = 0;
+      for (size_t i=0; i<n; ++i)
+      {
+         d.ra = ra[i];
+         d.dec = dec[i];
+         d.lon = lon[i];
+         d.lat = lat[i];
+         d.jdays = jd[i];
+         d.dist = 0.0;
+         KcdcRecordFormatter::AppendRecord(out, recs[i], d);
+         if (out.IsFull())
+         {
+            formatted += out.GetSize();
+            out.Clear();
+         }
+      }
+      formatted += out.GetSize();
+   }));
+   checksum += formatted;
+
+   std::cout << "End to end (" << threads << " threads)\n";
+   std::vector<BenchResult> runs;
+   const std::string outFile = dataFile + ".out";
+   const char* modeNames[] = {"libnova", "batch", "cached"};
+   const TransformMode modes[] = {TRANSFORM_LIBNOVA, TRANSFORM_BATCH, TRANSFORM_CACHED};
+   std::ostringstream log;
+   std::streambuf* coutBuffer = std::cout.rdbuf();
+   for (size_t m=0; m<3; ++m)
+   {
+      KcdcData run;
+      run.SetThreads(threads);
+      run.SetTransformMode(modes[m]);
+      std::cout.rdbuf(log.rdbuf());
+      double start = Now();
+      run.AddFields(dataFile, outFile, 200.0);
+      double t = Now() - start;
+      std::cout.rdbuf(coutBuffer);
+      BenchResult r = {std::string("AddFields.") + modeNames[m], t, records};
+      std::cout << "   " << r.name << ": " << t << " s, " << records/t << " rec/s\n";
+      runs.push_back(r);
+   }
+   {
+      KcdcData run;
+      run.SetThreads(threads);
+      run.SetTransformMode(TRANSFORM_CACHED);
+      std::cout.rdbuf(log.rdbuf());
+      double start = Now();
+      run.ProcessEventStats(dataFile, outFile, 0.0, 1e6);
+      double t = Now() - start;
+      std::cout.rdbuf(coutBuffer);
+      BenchResult r = {"ProcessEventStats.cached", t, records};
+      std::cout << "   " << r.name << ": " << t << " s, " << records/t << " rec/s\n";
+      runs.push_back(r);
+   }
+   remove(outFile.c_str());
+   remove((outFile + ".nreal.dat").c_str());
+   remove((outFile + ".nfake.dat").c_str());
+
+   std::ofstream json(jsonFile.c_str(), std::ios::binary);
+   char line[512];
+   snprintf(line, sizeof(line),
+            "{\n  \"records\": %" PRIu64 ",\n  \"input_bytes\": %zu,\n  \"instruction_set\": \"%s\",\n"
+            "  \"threads\": %u,\n  \"repeat\": %u,\n  \"checksum\": %.17g,\n",
+            records, text.size(), Simd::GetInstructionSet(), threads, repeat, checksum);
+   json << line << "  \"stages\": [\n";
+   WriteResults(json, stages);
+   json << "  ],\n  \"end_to_end\": [\n";
+   WriteResults(json, runs);
+   json << "  ]\n}\n";
+   json.close();
+   if (json.fail())
+   {
+      std::cout << "Unable to write " << jsonFile << "\n";
+      return 1;
+   }
+   std::cout << "Results written to " << jsonFile << "\n";
+   return 0;
+}
@@ -38,12 +38,40 @@
 int main()
 {
    Csi::Kcdc::KcdcData data;
+   //data.SetThreads(0);     // 0 uses all hardware threads
+   //data.SetTransformMode(Csi::Kcdc::TRANSFORM_CACHED);    // sidereal time computed once per timestamp
+   //data.SetTransformMode(Csi::Kcdc::TRANSFORM_BATCH);     // vectorized coordinate transforms
+   //data.SetOversampling(20);    // ProcessEventStats fake events per real event
+   //data.SetEventSetSize(100000, true);    // ProcessEventStats fake event times from the 100000 events around each event
+   //data.SetProgressInterval(5.0);    // throughput line every 5 s instead of the dots
+   //data.SetStatsFile("run.json");    // JSON summary with stage timings
+   //data.SetShard(Csi::Kcdc::KcdcShard(0, 4));    // shard 0 of 4, join the outputs with ./merge
+   //data.SetCheckpointFile("run.ckp");    // save the state every 5 minutes and at the end
+   //data.SetResume(true);                 // continue a crashed run, or one whose input has grown
+   //Csi::Kcdc::KcdcRegionCatalog catalog;     // lines of "id ra dec radius" in degrees
+   //if (catalog.Load("sources.txt")) data.SetRegionCatalog(catalog);    // adds a SOURCES column
+   //data.SetDirectOutput(true);    // uncompressed output with O_DIRECT, bypassing the page cache
    //             input file               output file             max distance (0.0 means no max)
    data.AddFields("data/example.data.txt", "data/example.out.txt", 0.0);
    //data.AddFields("data.txt", "out.txt", 6.0);
+   //data.AddFields("data.txt.gz", "out.txt.gz", 6.0);     // compressed input and output
+   //data.WriteEventCache("data.txt", "data.kec");     // then use data.kec as input instead of data.txt
+   //Csi::Kcdc::KcdcEventStore store;     // load once, then select and count without re-reading
+   //data.LoadEventStore("data.kec", store);
+   //Csi::Kcdc::KcdcSelection sel, cone;
+   //store.Select(Csi::Kcdc::FIELD_ZE, 0.0, 30.0, sel);     // zenith cut
+   //store.SelectCone(83.63, 22.01, 3.0, cone);             // 3 degrees around the Crab
+   //sel.And(cone);
+   //store.WriteText("crab.txt", sel);
 
-   //data.ProcessEventStats("data.txt", "mid", 15.47712, 15.90309);
-   //data.ProcessEventStats("data.txt", "low", 15.0, 15.11394);
-   //data.ProcessEventStats("data.txt", "high", 15.90309, 1e6);
+   //                                                        name     emin      emax
+   std::vector<Csi::Kcdc::KcdcData::EnergyBand> bands;
+   bands.push_back(Csi::Kcdc::KcdcData::EnergyBand("mid",  15.47712, 15.90309));
+   bands.push_back(Csi::Kcdc::KcdcData::EnergyBand("low",  15.0,     15.11394));
+   bands.push_back(Csi::Kcdc::KcdcData::EnergyBand("high", 15.90309, 1e6));
+   //data.SetMapFormat(Csi::Kcdc::MAP_FORMAT_BINARY);    // name.nreal.map instead of name.nreal.dat
+   //data.ProcessEventStats("data.txt", bands);     // all bands in one pass over the input
+   //data.ProcessSignificance({"mid", "low", "high"}, {1.0, 2.5, 5.0});    // Li-Ma maps of window radii in degrees
+   //data.RenderMaps({"mid", "low", "high"});    // Hammer-Aitoff images mid.nreal.pgm, mid.nreal.pfm, ...
    return 0;
 } 
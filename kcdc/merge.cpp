@@ -0,0 +1,59 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   merge.cpp
+///
+///  @author: Doug Reitz\n
+///  url:     https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Joins the outputs of sharded AddFields and ProcessEventStats runs
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "KcdcData.h"
+
+// merge -f out.txt part0.txt part1.txt ...    AddFields outputs, in shard order
+// merge -m name part0 part1 ...               ProcessEventStats maps part0.nreal.dat ... into name.nreal.dat
+// merge -b name part0 part1 ...               the same into the binary map name.nreal.map
+int main(int argc, char** argv)
+{
+   if (argc < 4 || (strcmp(argv[1], "-f") && strcmp(argv[1], "-m") && strcmp(argv[1], "-b")))
+   {
+      std::cout << "Usage: merge -f output part...    join AddFields outputs, given in shard order\n"
+                << "       merge -m name part...      add ProcessEventStats maps (names without .nreal.dat or .nreal.map)\n"
+                << "       merge -b name part...      add maps into binary .map files\n";
+      return 2;
+   }
+   std::vector<std::string> parts(argv + 3, argv + argc);
+   Csi::Kcdc::KcdcData data;
+   if (!strcmp(argv[1], "-b")) data.SetMapFormat(Csi::Kcdc::MAP_FORMAT_BINARY);
+   bool ok = !strcmp(argv[1], "-f") ? data.MergeFields(parts, argv[2]) : data.MergeEventStats(parts, argv[2]);
+   return ok ? 0 : 1;
+}
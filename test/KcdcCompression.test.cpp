@@ -0,0 +1,169 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcCompression.test.cpp
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Unit test for the gzip and zstd KcdcOutputFile and KcdcDecompressor
+///
+///  @details
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#define BOOST_TEST_MODULE TestSuite
+#define BOOST_TEST_DYN_LINK
+#define BOOST_AUTO_TEST_MAIN
+#include "kcdc/KcdcCompression.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <boost/test/unit_test.hpp>
+
+using Csi::Kcdc::Compression;
+using Csi::Kcdc::KcdcBlockPipe;
+using Csi::Kcdc::KcdcDecompressor;
+using Csi::Kcdc::KcdcOutputFile;
+
+/// KCDC like text lines, compressible but not trivially so
+static std::string MakeData(size_t size)
+{
+    std::string data;
+    data.reserve(size + 64);
+    uint64_t x(88172645463325252ull);
+    char line[64];
+    while (data.size() < size)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        snprintf(line, sizeof(line), "%10.4f %11" PRIu64 " %8" PRIu64 "\n", (x % 100000)/1000.0, x >> 30, x % 1000);
+        data += line;
+    }
+    data.resize(size);
+    return data;
+}
+
+/// Decompress fname into data; returns the decompressor error
+static std::string ReadAll(const std::string& fname, Compression compression, std::string& data)
+{
+    KcdcDecompressor in;
+    data.clear();
+    if (!in.Start(open(fname.c_str(), O_RDONLY), compression)) return in.GetError();
+    std::vector<char> buffer(1 << 20);
+    while (size_t n = in.Read(buffer.data(), buffer.size())) data.append(buffer.data(), n);
+    return in.GetError();
+}
+
+static void CheckRoundTrip(const std::string& fname, Compression compression, size_t size)
+{
+    const std::string data = MakeData(size);
+    KcdcOutputFile out;
+    BOOST_REQUIRE(out.Open(fname));
+    // uneven writes, so the blocks are not filled in step with the write calls
+    for (size_t pos=0; pos<data.size(); pos += 777777) out.Write(data.data() + pos, std::min<size_t>(777777, data.size() - pos));
+    BOOST_REQUIRE(out.Close());
+
+    std::string copy;
+    const std::string error = ReadAll(fname, compression, copy);
+    BOOST_CHECK_MESSAGE(error.empty(), fname << " " << size << ": " << error);
+    BOOST_CHECK_EQUAL(copy.size(), data.size());
+    BOOST_CHECK_MESSAGE(copy == data, fname << " " << size << " bytes differ");
+    std::remove(fname.c_str());
+}
+
+static void CheckRoundTrips(const std::string& fname, Compression compression)
+{
+    const size_t block = KcdcBlockPipe(1).GetBlockSize();
+    const size_t sizes[] = {0, 1000, block, block + 1, 2*block + 1, 3*block + 4096};
+    for (int i=0; i<6; ++i) CheckRoundTrip(fname, compression, sizes[i]);
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_compression_gzip_test )
+{
+    CheckRoundTrips("KcdcCompression.test.gz", Csi::Kcdc::COMPRESSION_GZIP);
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_compression_zstd_test )
+{
+    if (!Csi::Kcdc::IsZstdAvailable()) return;
+    CheckRoundTrips("KcdcCompression.test.zst", Csi::Kcdc::COMPRESSION_ZSTD);
+
+    // two frames, so the zstd blocks of the second are not aligned with the pipe blocks
+    const std::string fname("KcdcCompression.test.zst");
+    const size_t block = KcdcBlockPipe(1).GetBlockSize();
+    const std::string data = MakeData(2*block + 1);
+    const size_t head[] = {1000, 100000};
+    for (int i=0; i<2; ++i)
+    {
+        std::string frames;
+        for (int k=0; k<2; ++k)
+        {
+            KcdcOutputFile out;
+            BOOST_REQUIRE(out.Open(fname));
+            if (k == 0) out.Write(data.data(), head[i]);
+            else out.Write(data.data() + head[i], data.size() - head[i]);
+            BOOST_REQUIRE(out.Close());
+            std::ifstream is(fname.c_str(), std::ios::binary);
+            frames.append((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+        }
+        std::ofstream(fname.c_str(), std::ios::binary | std::ios::trunc) << frames;
+        std::string copy;
+        BOOST_CHECK_EQUAL(ReadAll(fname, Csi::Kcdc::COMPRESSION_ZSTD, copy), "");
+        BOOST_CHECK(copy == data);
+    }
+
+    // a frame cut short is reported
+    KcdcOutputFile out;
+    BOOST_REQUIRE(out.Open(fname));
+    out.Write(data.data(), data.size());
+    BOOST_REQUIRE(out.Close());
+    BOOST_REQUIRE(truncate(fname.c_str(), 1000) == 0);
+    std::string copy;
+    BOOST_CHECK(!ReadAll(fname, Csi::Kcdc::COMPRESSION_ZSTD, copy).empty());
+    std::remove(fname.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_compression_errors_test )
+{
+    // a read error is not the end of the input
+    const Compression compressions[] = {Csi::Kcdc::COMPRESSION_GZIP, Csi::Kcdc::COMPRESSION_ZSTD};
+    for (int i=0; i<2; ++i)
+    {
+        if (compressions[i] == Csi::Kcdc::COMPRESSION_ZSTD && !Csi::Kcdc::IsZstdAvailable()) continue;
+        KcdcDecompressor in;
+        BOOST_REQUIRE(in.Start(open(".", O_RDONLY), compressions[i]));
+        char c;
+        BOOST_CHECK_EQUAL(in.Read(&c, 1), 0u);
+        BOOST_CHECK(!in.GetError().empty());
+    }
+
+    KcdcOutputFile out;
+    BOOST_CHECK(!out.Open("no/such/directory/out.gz"));
+    BOOST_CHECK(!out.GetError().empty());
+    BOOST_CHECK(!out.Open("no/such/directory/out.txt"));
+    BOOST_CHECK(!out.GetError().empty());
+}
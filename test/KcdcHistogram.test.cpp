@@ -0,0 +1,138 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcHistogram.test.cpp
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Unit test for the SkyHistogram binning
+///
+///  @details
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#define BOOST_TEST_MODULE TestSuite
+#define BOOST_TEST_DYN_LINK
+#define BOOST_AUTO_TEST_MAIN
+#include "kcdc/KcdcHistogram.h"
+#include <cmath>
+#include <sstream>
+#include <boost/test/unit_test.hpp>
+
+using Csi::Kcdc::SkyHistogram;
+
+BOOST_AUTO_TEST_CASE( kcdc_histogram_binning_test )
+{
+    SkyHistogram<> map;
+    BOOST_CHECK_EQUAL(map.GetRaBins(), 720u);
+    BOOST_CHECK_EQUAL(map.GetDecBins(), 360u);
+
+    // a bin includes its lower edge and excludes its upper edge
+    BOOST_CHECK_EQUAL(map.GetBin(-180.0, -90.0), 0u);
+    BOOST_CHECK_EQUAL(map.GetBin(-179.5, -90.0), 1u);
+    BOOST_CHECK_EQUAL(map.GetBin(std::nextafter(-179.5, -180.0), -90.0), 0u);
+    BOOST_CHECK_EQUAL(map.GetBin(0.0, 0.0), 180u*720u + 360u);
+    BOOST_CHECK_EQUAL(map.GetBin(-1e-9, 0.0), 180u*720u + 359u);
+    BOOST_CHECK_EQUAL(map.GetBin(179.999, 89.999), 360u*720u - 1u);
+    BOOST_CHECK_EQUAL(map.GetOutOfRange(), 0u);
+
+    // the upper edges and everything outside go into the nearest edge bin
+    BOOST_CHECK_EQUAL(map.GetBin(180.0, 90.0), 360u*720u - 1u);
+    BOOST_CHECK_EQUAL(map.GetBin(-200.0, -95.0), 0u);
+    BOOST_CHECK_EQUAL(map.GetBin(500.0, 0.0), 180u*720u + 719u);
+    BOOST_CHECK_EQUAL(map.GetBin(0.0, std::nan("")), 360u);
+    BOOST_CHECK_EQUAL(map.GetOutOfRange(), 4u);
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_histogram_partial_bin_test )
+{
+    // 0.7 does not divide 360: the last RA bin reaches past raMax, to 515*0.7 = 360.5
+    SkyHistogram<uint32_t> map(0.7, 0.0, 360.0, -90.0, 90.0);
+    BOOST_CHECK_EQUAL(map.GetRaBins(), 515u);
+    BOOST_CHECK_EQUAL(map.GetDecBins(), 258u);
+    BOOST_CHECK_EQUAL(map.GetBin(359.9, -90.0), 514u);
+    BOOST_CHECK_EQUAL(map.GetBin(360.4, -90.0), 514u);
+    BOOST_CHECK_EQUAL(map.GetOutOfRange(), 0u);
+    BOOST_CHECK_EQUAL(map.GetBin(360.6, -90.0), 514u);
+    BOOST_CHECK_EQUAL(map.GetOutOfRange(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_histogram_fill_test )
+{
+    SkyHistogram<uint32_t> map(10.0);
+    SkyHistogram<uint32_t> block(10.0);
+    std::vector<double> ra, dec;
+    for (int i=0; i<1000; ++i)
+    {
+        ra.push_back(-190.0 + 0.39*i);
+        dec.push_back(-95.0 + 0.19*i);
+        map.Fill(ra.back(), dec.back());
+    }
+    block.Fill(ra.size(), ra.data(), dec.data());
+    BOOST_CHECK_EQUAL(map.GetTotal(), 1000u);
+    BOOST_CHECK_EQUAL(block.GetOutOfRange(), map.GetOutOfRange());
+    BOOST_CHECK(map.GetOutOfRange() > 0u);
+    for (uint32_t i=0; i<map.GetDecBins(); ++i)
+    {
+        for (uint32_t j=0; j<map.GetRaBins(); ++j) BOOST_CHECK_EQUAL(block(i,j), map(i,j));
+    }
+
+    SkyHistogram<uint64_t> sum(10.0);
+    BOOST_CHECK(sum.Merge(map));
+    BOOST_CHECK(sum.Merge(block));
+    BOOST_CHECK_EQUAL(sum.GetTotal(), 2000u);
+    BOOST_CHECK_EQUAL(sum.GetOutOfRange(), 2*map.GetOutOfRange());
+    SkyHistogram<uint64_t> other(5.0);
+    BOOST_CHECK(!other.Merge(map));
+    BOOST_CHECK_EQUAL(other.GetTotal(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_histogram_text_test )
+{
+    SkyHistogram<> map(30.0);
+    map.Fill(-170.0, 80.0);
+    map.Fill(170.0, -80.0);
+    map.Fill(170.0, -80.0);
+    std::stringstream text;
+    map.Write(text);
+
+    // highest Dec row first, every count followed by a space
+    std::string first;
+    std::getline(text, first);
+    BOOST_CHECK_EQUAL(first, "1 0 0 0 0 0 0 0 0 0 0 0 ");
+
+    text.seekg(0);
+    SkyHistogram<> copy(30.0);
+    BOOST_CHECK(copy.Read(text));
+    BOOST_CHECK_EQUAL(copy(5, 0), 1u);
+    BOOST_CHECK_EQUAL(copy(0, 11), 2u);
+    BOOST_CHECK_EQUAL(copy.GetTotal(), 3u);
+
+    std::string truncated = text.str();
+    truncated.resize(truncated.size()/2);
+    std::istringstream in(truncated);
+    BOOST_CHECK(!copy.Read(in));
+}
@@ -0,0 +1,164 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcMapFile.test.cpp
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Unit test for the KcdcMapFile encodings
+///
+///  @details
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#define BOOST_TEST_MODULE TestSuite
+#define BOOST_TEST_DYN_LINK
+#define BOOST_AUTO_TEST_MAIN
+#include "kcdc/KcdcMapFile.h"
+#include <cstdio>
+#include <fstream>
+#include <boost/test/unit_test.hpp>
+
+using Csi::Kcdc::KcdcMapFile;
+using Csi::Kcdc::SkyHistogram;
+
+static const char* s_fileName = "KcdcMapFile.test.map";
+
+static KcdcMapFile MakeMap()
+{
+    SkyHistogram<uint32_t> h(5.0);
+    h.Fill(-180.0, -90.0);
+    h.Fill(10.0, 20.0);
+    h.Fill(10.0, 20.0);
+    h.Fill(179.0, 89.0);
+    h.Fill(400.0, 0.0);
+    KcdcMapFile map;
+    map.name = "band_6.4";
+    map.kind = KcdcMapFile::KIND_FAKE;
+    map.emin = 6.4;
+    map.emax = 6.6;
+    map.oversampling = 20;
+    map.SetMap(h);
+    map.counts[1000] = 1ull << 40;      // needs a varint of 6 bytes
+    return map;
+}
+
+static void CheckEqual(const KcdcMapFile& lhs, const KcdcMapFile& rhs)
+{
+    BOOST_CHECK_EQUAL(lhs.name, rhs.name);
+    BOOST_CHECK_EQUAL(lhs.kind, rhs.kind);
+    BOOST_CHECK_EQUAL(lhs.emin, rhs.emin);
+    BOOST_CHECK_EQUAL(lhs.emax, rhs.emax);
+    BOOST_CHECK_EQUAL(lhs.oversampling, rhs.oversampling);
+    BOOST_CHECK(lhs.IsCompatible(rhs));
+    BOOST_CHECK_EQUAL(lhs.outOfRange, rhs.outOfRange);
+    BOOST_CHECK(lhs.counts == rhs.counts);
+}
+
+static std::string ReadFile(const char* fname)
+{
+    std::ifstream is(fname, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+}
+
+static void WriteFile(const char* fname, const std::string& data)
+{
+    std::ofstream os(fname, std::ios::binary | std::ios::trunc);
+    os.write(data.data(), data.size());
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_map_file_round_trip_test )
+{
+    const KcdcMapFile map = MakeMap();
+    BOOST_CHECK_EQUAL(map.GetNonZero(), 5u);
+    BOOST_CHECK_EQUAL(map.outOfRange, 1u);
+    BOOST_CHECK_EQUAL(map.GetSmallerEncoding(), KcdcMapFile::ENCODING_SPARSE);
+
+    const KcdcMapFile::Encoding encodings[] = {KcdcMapFile::ENCODING_DENSE, KcdcMapFile::ENCODING_SPARSE};
+    for (int e=0; e<2; ++e)
+    {
+        BOOST_REQUIRE(map.Write(s_fileName, encodings[e]));
+        BOOST_CHECK(KcdcMapFile::IsMapFile(s_fileName));
+        KcdcMapFile copy;
+        BOOST_REQUIRE(copy.Read(s_fileName));
+        CheckEqual(copy, map);
+
+        SkyHistogram<uint64_t> h;
+        BOOST_REQUIRE(copy.GetMap(h));
+        BOOST_CHECK_EQUAL(h.GetRaBins(), 72u);
+        BOOST_CHECK_EQUAL(h.GetDecBins(), 36u);
+        BOOST_CHECK_EQUAL(h.GetTotal(), map.GetTotal());
+        BOOST_CHECK_EQUAL(h(22, 38), 2u);
+    }
+    std::remove(s_fileName);
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_map_file_dense_encoding_test )
+{
+    // a map without zeros is smaller dense
+    KcdcMapFile map;
+    map.SetMap(SkyHistogram<uint64_t>(30.0));
+    for (size_t i=0; i<map.counts.size(); ++i) map.counts[i] = 1ull << 60;
+    BOOST_CHECK_EQUAL(map.GetSmallerEncoding(), KcdcMapFile::ENCODING_DENSE);
+    BOOST_REQUIRE(map.Write(s_fileName, KcdcMapFile::ENCODING_DENSE));
+    KcdcMapFile copy;
+    BOOST_REQUIRE(copy.Read(s_fileName));
+    CheckEqual(copy, map);
+    std::remove(s_fileName);
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_map_file_truncated_test )
+{
+    const KcdcMapFile map = MakeMap();
+    const KcdcMapFile::Encoding encodings[] = {KcdcMapFile::ENCODING_DENSE, KcdcMapFile::ENCODING_SPARSE};
+    for (int e=0; e<2; ++e)
+    {
+        BOOST_REQUIRE(map.Write(s_fileName, encodings[e]));
+        const std::string data = ReadFile(s_fileName);
+        // prefixes of the header and a sample of longer ones, up to one byte short
+        for (size_t size=0; size<data.size(); size += (size < 128 ? 1 : 97))
+        {
+            WriteFile(s_fileName, data.substr(0, size));
+            KcdcMapFile copy;
+            BOOST_CHECK_MESSAGE(!copy.Read(s_fileName), "encoding " << e << " size " << size);
+        }
+        WriteFile(s_fileName, data.substr(0, data.size() - 1));
+        KcdcMapFile copy;
+        BOOST_CHECK(!copy.Read(s_fileName));
+
+        // trailing bytes are rejected as well
+        WriteFile(s_fileName, data + '\0');
+        BOOST_CHECK(!copy.Read(s_fileName));
+    }
+
+    // a text map is not a map file
+    WriteFile(s_fileName, "0 0 1 \n");
+    BOOST_CHECK(!KcdcMapFile::IsMapFile(s_fileName));
+    KcdcMapFile copy;
+    BOOST_CHECK(!copy.Read(s_fileName));
+    std::remove(s_fileName);
+    BOOST_CHECK(!copy.Read(s_fileName));
+}
@@ -0,0 +1,110 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcRandom.test.cpp
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Unit test for the Philox4x32 generator and EventRandomStream
+///
+///  @details
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#define BOOST_TEST_MODULE TestSuite
+#define BOOST_TEST_DYN_LINK
+#define BOOST_AUTO_TEST_MAIN
+#include "kcdc/KcdcRandom.h"
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using Csi::Kcdc::EventRandomStream;
+using Csi::Kcdc::Philox4x32;
+
+static void CheckBlock(const Philox4x32::Block& counter, uint64_t key, const Philox4x32::Block& expected)
+{
+    Philox4x32::Block result = Philox4x32::Generate(counter, key);
+    for (int i=0; i<4; ++i) BOOST_CHECK_EQUAL(result.v[i], expected.v[i]);
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_random_philox_known_answer_test )
+{
+    // the philox4x32 10 round vectors of Random123 (kat_vectors), key words low first
+    CheckBlock({{0, 0, 0, 0}}, 0,
+               {{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}});
+    CheckBlock({{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}}, 0xffffffffffffffffull,
+               {{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}});
+    CheckBlock({{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}}, 0x299f31d0a4093822ull,
+               {{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}});
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_random_stream_test )
+{
+    // draws 2k and 2k+1 are the two halves of block k
+    EventRandomStream stream(0x299f31d0a4093822ull, 0x0370734413198a2eull, 0x243f6a88);
+    Philox4x32::Block block = Philox4x32::Generate({{0x243f6a88, 0, 0x13198a2e, 0x03707344}}, 0x299f31d0a4093822ull);
+    BOOST_CHECK_EQUAL(stream.Next(), ((uint64_t)block.v[0] << 32) | block.v[1]);
+    BOOST_CHECK_EQUAL(stream.Next(), ((uint64_t)block.v[2] << 32) | block.v[3]);
+    block = Philox4x32::Generate({{0x243f6a88, 1, 0x13198a2e, 0x03707344}}, 0x299f31d0a4093822ull);
+    BOOST_CHECK_EQUAL(stream.Next(), ((uint64_t)block.v[0] << 32) | block.v[1]);
+
+    // the same (seed, set, event) gives the same draws, another event others
+    EventRandomStream a(1, 2, 3), b(1, 2, 3), c(1, 2, 4);
+    for (int i=0; i<100; ++i)
+    {
+        uint64_t x = a.Next();
+        BOOST_CHECK_EQUAL(x, b.Next());
+        BOOST_CHECK(x != c.Next());
+        double d = a.NextDouble();
+        BOOST_CHECK(d >= 0.0 && d < 1.0);
+        b.Next();
+        c.Next();
+    }
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_random_next_index_test )
+{
+    EventRandomStream stream(7, 0, 0);
+    for (int i=0; i<1000; ++i) BOOST_CHECK_EQUAL(stream.NextIndex(1), 0u);
+
+    // every index of a small range is drawn, about equally often
+    const uint64_t n = 7;
+    std::vector<uint32_t> hits(n, 0);
+    for (int i=0; i<70000; ++i)
+    {
+        uint64_t index = stream.NextIndex(n);
+        BOOST_REQUIRE(index < n);
+        ++hits[index];
+    }
+    for (uint64_t i=0; i<n; ++i) BOOST_CHECK(hits[i] > 9500 && hits[i] < 10500);
+
+    // ranges near 2^64, where most of the product is rejected
+    const uint64_t large[] = {(1ull << 63) + 1, 0xffffffffffffffffull, 0xfffffffffffffffdull, 3};
+    for (int k=0; k<4; ++k)
+    {
+        for (int i=0; i<1000; ++i) BOOST_REQUIRE(stream.NextIndex(large[k]) < large[k]);
+    }
+}
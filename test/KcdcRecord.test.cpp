@@ -0,0 +1,141 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcRecord.test.cpp
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Unit test for the KcdcRecordParser and KcdcRecordFormatter
+///
+///  @details
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#define BOOST_TEST_MODULE TestSuite
+#define BOOST_TEST_DYN_LINK
+#define BOOST_AUTO_TEST_MAIN
+#include "kcdc/KcdcFormatter.h"
+#include <sstream>
+#include <string>
+#include <boost/test/unit_test.hpp>
+
+using Csi::Kcdc::KcdcOutputBuffer;
+using Csi::Kcdc::KcdcRecord;
+using Csi::Kcdc::KcdcRecordFormatter;
+using Csi::Kcdc::KcdcRecordParser;
+
+static const char* s_line = " 6.4321 -12.5 +3.25 17.5 250.125 5.1 4.2 0.0 -1 1.5 2.5 1 2 20030412 235959 7 123456 1.25 ";
+
+BOOST_AUTO_TEST_CASE( kcdc_record_parse_test )
+{
+    KcdcRecordParser parser;
+    KcdcRecord rec;
+    BOOST_CHECK_EQUAL(parser.Parse(s_line, rec), KcdcRecordParser::PARSE_OK);
+    BOOST_CHECK_EQUAL(rec.e, 6.4321);
+    BOOST_CHECK_EQUAL(rec.xc, 3.25);
+    BOOST_CHECK_EQUAL(rec.az, 250.125);
+    BOOST_CHECK_EQUAL(rec.nhad, -1);
+    BOOST_CHECK_EQUAL(rec.ymd, 20030412u);
+    BOOST_CHECK_EQUAL(rec.hms, 235959u);
+    BOOST_CHECK_EQUAL(rec.ev, 123456u);
+    BOOST_CHECK_EQUAL(rec.age, 1.25);
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_record_round_trip_test )
+{
+    KcdcRecordParser parser;
+    KcdcRecord rec, copy;
+    BOOST_REQUIRE_EQUAL(parser.Parse(s_line, rec), KcdcRecordParser::PARSE_OK);
+    KcdcOutputBuffer out;
+    KcdcRecordFormatter::AppendInputRecord(out, rec);
+    std::string line(out.GetData(), out.GetSize());
+    BOOST_CHECK_EQUAL(line.back(), '\n');
+    BOOST_REQUIRE_EQUAL(parser.Parse(line, copy), KcdcRecordParser::PARSE_OK);
+    BOOST_CHECK_EQUAL(copy.e, 6.4321);
+    BOOST_CHECK_EQUAL(copy.yc, rec.yc);
+    BOOST_CHECK_EQUAL(copy.nhad, rec.nhad);
+    BOOST_CHECK_EQUAL(copy.ev, rec.ev);
+
+    // formatting the parsed copy gives the same line again
+    out.Clear();
+    KcdcRecordFormatter::AppendInputRecord(out, copy);
+    BOOST_CHECK_EQUAL(std::string(out.GetData(), out.GetSize()), line);
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_record_malformed_test )
+{
+    KcdcRecordParser parser;
+    KcdcRecord rec;
+    BOOST_CHECK_EQUAL(parser.Parse("", rec), KcdcRecordParser::PARSE_EMPTY);
+    BOOST_CHECK_EQUAL(parser.Parse(" \t\r\n", rec), KcdcRecordParser::PARSE_EMPTY);
+
+    // the line ends before the last field
+    std::string line(s_line);
+    line.resize(line.rfind("1.25"));
+    BOOST_CHECK_EQUAL(parser.Parse(line, rec), KcdcRecordParser::PARSE_MISSING_FIELD);
+    BOOST_CHECK_EQUAL(parser.GetErrorField(), (uint32_t)Csi::Kcdc::FIELD_AGE);
+
+    // text, a number with trailing characters and a signed unsigned field
+    line = s_line;
+    line.replace(line.find("17.5"), 4, "abc");
+    BOOST_CHECK_EQUAL(parser.Parse(line, rec), KcdcRecordParser::PARSE_BAD_FIELD);
+    BOOST_CHECK_EQUAL(parser.GetErrorField(), (uint32_t)Csi::Kcdc::FIELD_ZE);
+
+    line = s_line;
+    line.replace(line.find("5.1"), 3, "5.1x");
+    BOOST_CHECK_EQUAL(parser.Parse(line, rec), KcdcRecordParser::PARSE_BAD_FIELD);
+    BOOST_CHECK_EQUAL(parser.GetErrorField(), (uint32_t)Csi::Kcdc::FIELD_NE);
+
+    line = s_line;
+    line.replace(line.find("123456"), 6, "-123456");
+    BOOST_CHECK_EQUAL(parser.Parse(line, rec), KcdcRecordParser::PARSE_BAD_FIELD);
+    BOOST_CHECK_EQUAL(parser.GetErrorField(), (uint32_t)Csi::Kcdc::FIELD_EV);
+
+    // a failed line does not affect the next one
+    BOOST_CHECK_EQUAL(parser.Parse(s_line, rec), KcdcRecordParser::PARSE_OK);
+    BOOST_CHECK_EQUAL(rec.ev, 123456u);
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_record_field_mask_test )
+{
+    KcdcRecordParser parser;
+    KcdcRecord rec;
+    rec.ze = -1.0;
+    BOOST_REQUIRE_EQUAL(parser.ParseEnergy(s_line, rec), KcdcRecordParser::PARSE_OK);
+    BOOST_CHECK_EQUAL(rec.e, 6.4321);
+    const uint32_t mask = KcdcRecordParser::s_allFields & ~(1u << Csi::Kcdc::FIELD_ZE);
+    BOOST_CHECK_EQUAL(parser.ParseRemaining(rec, mask), KcdcRecordParser::PARSE_OK);
+    BOOST_CHECK_EQUAL(rec.ze, -1.0);
+    BOOST_CHECK_EQUAL(rec.age, 1.25);
+
+    // a field that is not decoded is not validated either, but must be present
+    std::string line(s_line);
+    line.replace(line.find("17.5"), 4, "abc");
+    BOOST_REQUIRE_EQUAL(parser.ParseEnergy(line, rec), KcdcRecordParser::PARSE_OK);
+    BOOST_CHECK_EQUAL(parser.ParseRemaining(rec, mask), KcdcRecordParser::PARSE_OK);
+    BOOST_REQUIRE_EQUAL(parser.ParseEnergy("1.0 2.0", rec), KcdcRecordParser::PARSE_OK);
+    BOOST_CHECK_EQUAL(parser.ParseRemaining(rec, mask), KcdcRecordParser::PARSE_MISSING_FIELD);
+}
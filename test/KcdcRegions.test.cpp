@@ -0,0 +1,102 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcRegions.test.cpp
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Unit test for the KcdcRegionCatalog sky-cell index
+///
+///  @details
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#define BOOST_TEST_MODULE TestSuite
+#define BOOST_TEST_DYN_LINK
+#define BOOST_AUTO_TEST_MAIN
+#include "kcdc/KcdcRegions.h"
+#include <boost/test/unit_test.hpp>
+
+using Csi::Kcdc::KcdcRegionCatalog;
+
+static size_t MatchCount(const KcdcRegionCatalog& catalog, double ra, double dec)
+{
+    std::vector<uint32_t> sources;
+    return catalog.Match(ra, dec, sources);
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_regions_match_test )
+{
+    KcdcRegionCatalog catalog;
+    BOOST_CHECK(catalog.Add("a", 10.0, 20.0, 2.0));
+    BOOST_CHECK(catalog.Add("b", 11.0, 20.0, 2.0));
+    catalog.Build();
+    std::vector<uint32_t> sources;
+    BOOST_CHECK_EQUAL(catalog.Match(10.5, 20.0, sources), 2u);
+    BOOST_CHECK_EQUAL(sources[0], 0u);
+    BOOST_CHECK_EQUAL(sources[1], 1u);
+    BOOST_CHECK_EQUAL(MatchCount(catalog, 8.5, 20.0), 1u);
+    BOOST_CHECK_EQUAL(MatchCount(catalog, 10.0, 22.5), 0u);
+    BOOST_CHECK_EQUAL(MatchCount(catalog, 10.0, std::nan("")), 0u);
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_regions_ra_wrap_test )
+{
+    // 0.7 does not divide 360, so the last RA column is narrower than the others
+    const double cellSizes[] = {1.0, 0.7, 7.0};
+    for (int c=0; c<3; ++c)
+    {
+        KcdcRegionCatalog catalog;
+        BOOST_CHECK(catalog.SetCellSize(cellSizes[c]));
+        BOOST_CHECK(catalog.Add("high", 359.9, 10.0, 0.5));
+        BOOST_CHECK(catalog.Add("low", 0.1, -10.0, 0.5));
+        BOOST_CHECK(catalog.Add("negative", -0.2, 40.0, 0.5));
+        catalog.Build();
+        BOOST_CHECK_EQUAL(MatchCount(catalog, 0.1, 10.0), 1u);
+        BOOST_CHECK_EQUAL(MatchCount(catalog, 360.1, 10.0), 1u);
+        BOOST_CHECK_EQUAL(MatchCount(catalog, -0.1, 10.0), 1u);
+        BOOST_CHECK_EQUAL(MatchCount(catalog, 359.9, -10.0), 1u);
+        BOOST_CHECK_EQUAL(MatchCount(catalog, 359.7, 40.0), 1u);
+        BOOST_CHECK_EQUAL(MatchCount(catalog, 0.2, 40.0), 1u);
+        BOOST_CHECK_EQUAL(MatchCount(catalog, 1.0, 10.0), 0u);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_regions_wide_and_polar_test )
+{
+    // a region that spans all RA is listed once per cell
+    KcdcRegionCatalog catalog(0.7);
+    BOOST_CHECK(catalog.Add("wide", 1.0, 70.0, 19.5));
+    BOOST_CHECK(catalog.Add("pole", 180.0, -88.0, 3.0));
+    catalog.Build();
+    BOOST_CHECK_EQUAL(MatchCount(catalog, 1.0, 85.0), 1u);
+    BOOST_CHECK_EQUAL(MatchCount(catalog, 359.5, 70.0), 1u);
+    BOOST_CHECK_EQUAL(MatchCount(catalog, 0.0, -89.5), 1u);
+    BOOST_CHECK_EQUAL(MatchCount(catalog, 90.0, -89.0), 1u);
+    BOOST_CHECK_EQUAL(catalog.GetCellSourceCount(359.99, 70.0), 1u);
+    BOOST_CHECK(!catalog.SetCellSize(0.0));
+    BOOST_CHECK_CLOSE(KcdcRegionCatalog::GetAngularDistance(359.9, 0.0, 0.1, 0.0), 0.2, 1e-9);
+}
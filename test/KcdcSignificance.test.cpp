@@ -0,0 +1,126 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   KcdcSignificance.test.cpp
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Unit test for the KcdcSignificance window sums and Li-Ma significance
+///
+///  @details
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#define BOOST_TEST_MODULE TestSuite
+#define BOOST_TEST_DYN_LINK
+#define BOOST_AUTO_TEST_MAIN
+#include "kcdc/KcdcSignificance.h"
+#include <boost/test/unit_test.hpp>
+
+using namespace Csi::Kcdc;
+
+static KcdcMapFile MakeMap(uint32_t seed)
+{
+    KcdcMapFile map;
+    map.binSize = 2.0;
+    map.raMin = 0.0;
+    map.decMin = -90.0;
+    map.raBins = 180;
+    map.decBins = 90;
+    map.counts.resize((size_t)map.raBins*map.decBins);
+    uint64_t state(seed);
+    for (size_t i=0; i<map.counts.size(); ++i)
+    {
+        state = state*6364136223846793005ULL + 1442695040888963407ULL;
+        map.counts[i] = (state >> 33) % 50;
+    }
+    return map;
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_significance_lima_test )
+{
+    BOOST_CHECK_EQUAL(KcdcSignificance::GetLiMa(10.0, 10.0, 1.0), 0.0);
+    BOOST_CHECK(KcdcSignificance::GetLiMa(150.0, 1000.0, 0.1) > 0.0);
+    BOOST_CHECK(KcdcSignificance::GetLiMa(50.0, 1000.0, 0.1) < 0.0);
+    BOOST_CHECK_EQUAL(KcdcSignificance::GetLiMa(0.0, 0.0, 0.1), 0.0);
+    // large counts approach the excess over its standard deviation
+    BOOST_CHECK_CLOSE(KcdcSignificance::GetLiMa(1.01e8, 1e8, 1.0), 1e6/sqrt(2.01e8), 0.1);
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_significance_window_test )
+{
+    // every window sum is the sum of the bins whose centers are within the radius
+    const KcdcMapFile real = MakeMap(1);
+    const KcdcMapFile fake = MakeMap(2);
+    const double radii[] = {3.0, 10.0, 25.0};
+    std::vector<KcdcSignificanceMap> maps;
+    BOOST_REQUIRE(KcdcSignificance::Compute(real, fake, 0.5, std::vector<double>(radii, radii + 3), 2, maps));
+    BOOST_REQUIRE_EQUAL(maps.size(), 3u);
+    const double d2r = M_PI/180.0;
+    size_t mismatches(0);
+    for (size_t r=0; r<3; ++r)
+    {
+        const double cosRadius = cos((radii[r] + 1e-9)*d2r);
+        // rows near the poles, at mid declination and at the equator
+        const uint32_t rows[] = {0, 3, 30, 44, 60, 89};
+        for (int k=0; k<6; ++k)
+        {
+            const uint32_t row = rows[k];
+            const uint32_t cols[] = {0, 1, 97, 179};
+            for (int l=0; l<4; ++l)
+            {
+                const uint32_t col = cols[l];
+                const double ra = (col + 0.5)*2.0*d2r, dec = (-90.0 + (row + 0.5)*2.0)*d2r;
+                double on(0.0), off(0.0);
+                for (uint32_t i=0; i<real.decBins; ++i)
+                {
+                    for (uint32_t j=0; j<real.raBins; ++j)
+                    {
+                        const double rai = (j + 0.5)*2.0*d2r, deci = (-90.0 + (i + 0.5)*2.0)*d2r;
+                        const double c = sin(dec)*sin(deci) + cos(dec)*cos(deci)*cos(rai - ra);
+                        if (c < cosRadius) continue;
+                        on += real.counts[(size_t)i*real.raBins + j];
+                        off += fake.counts[(size_t)i*real.raBins + j];
+                    }
+                }
+                const size_t bin = (size_t)row*real.raBins + col;
+                if (maps[r].on[bin] != on || maps[r].off[bin] != off) ++mismatches;
+                BOOST_CHECK_EQUAL(maps[r].excess[bin], on - 0.5*off);
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(mismatches, 0u);
+    BOOST_CHECK_EQUAL(maps[1].radius, 10.0);
+}
+
+BOOST_AUTO_TEST_CASE( kcdc_significance_incompatible_test )
+{
+    KcdcMapFile real = MakeMap(1);
+    KcdcMapFile fake = MakeMap(2);
+    fake.binSize = 1.0;
+    std::vector<KcdcSignificanceMap> maps;
+    BOOST_CHECK(!KcdcSignificance::Compute(real, fake, 0.5, std::vector<double>(1, 5.0), 1, maps));
+}
@@ -38,6 +38,9 @@
 #define BOOST_TEST_DYN_LINK
 #define BOOST_AUTO_TEST_MAIN
 #include "Vector.h"
+#include <set>
+#include <type_traits>
+#include <unordered_set>
 #include <boost/test/unit_test.hpp>
 
 
@@ -87,6 +90,68 @@ BOOST_AUTO_TEST_CASE( vector_test )
 
 }
 
+BOOST_AUTO_TEST_CASE( vector_comp_test )
+{
+    Csi::VectorComp comp;
+    BOOST_CHECK(comp(Csi::Vector(1.0, 5.0, 5.0), Csi::Vector(2.0, 0.0, 0.0)));
+    BOOST_CHECK(comp(Csi::Vector(1.0, 2.0, 5.0), Csi::Vector(1.0, 3.0, 0.0)));
+    BOOST_CHECK(comp(Csi::Vector(1.0, 2.0, 3.0), Csi::Vector(1.0, 2.0, 4.0)));
+    BOOST_CHECK(!comp(Csi::Vector(1.0, 2.0, 3.0), Csi::Vector(1.0, 2.0, 3.0)));
+    // numeric, not text order
+    BOOST_CHECK(comp(Csi::Vector(9.0, 0.0, 0.0), Csi::Vector(10.0, 0.0, 0.0)));
+
+    std::set<Csi::Vector, Csi::VectorComp> s;
+    s.insert(Csi::Vector(1.0, 2.0, 3.0));
+    s.insert(Csi::Vector(1.0, 2.0, 3.0));
+    s.insert(Csi::Vector(0.0, 2.0, 3.0));
+    BOOST_CHECK_EQUAL(s.size(), 2u);
+    BOOST_CHECK(*s.begin() == Csi::Vector(0.0, 2.0, 3.0));
+}
 
+BOOST_AUTO_TEST_CASE( vector_hash_test )
+{
+    std::hash<Csi::Vector> hash;
+    BOOST_CHECK_EQUAL(hash(Csi::Vector(0.0, -0.0, 1.0)), hash(Csi::Vector(-0.0, 0.0, 1.0)));
+    BOOST_CHECK(hash(Csi::Vector(1.0, 2.0, 3.0)) != hash(Csi::Vector(3.0, 2.0, 1.0)));
+
+    std::unordered_set<Csi::Vector> s;
+    s.insert(Csi::Vector(1.0, 2.0, 3.0));
+    s.insert(Csi::Vector(1.0, 2.0, 3.0));
+    s.insert(Csi::Vector(3.0, 2.0, 1.0));
+    BOOST_CHECK_EQUAL(s.size(), 2u);
+    BOOST_CHECK(s.count(Csi::Vector(3.0, 2.0, 1.0)) == 1);
+}
 
-
+BOOST_AUTO_TEST_CASE( vector_template_test )
+{
+    static_assert(std::is_trivially_copyable<Csi::Vector>::value, "Vector is memcpy-able");
+    static_assert(std::is_trivially_copyable<Csi::VectorF>::value, "VectorF is memcpy-able");
+    static_assert(sizeof(Csi::VectorF) == 3*sizeof(float), "VectorF is packed");
+
+    // evaluated at compile time
+    constexpr Csi::Vector a(1.0, 2.0, 3.0);
+    constexpr Csi::Vector b = a*2.0 - Csi::Vector(0.0, 1.0, 2.0);
+    static_assert(b == Csi::Vector(2.0, 3.0, 4.0), "constexpr arithmetic");
+    static_assert(a*b == 20.0, "constexpr dot product");
+
+    Csi::VectorF f(1.5f, -2.0f, 0.25f);
+    f += Csi::VectorF(0.5f, 0.0f, 0.0f);
+    BOOST_CHECK(f == Csi::VectorF(2.0f, -2.0f, 0.25f));
+    BOOST_CHECK_EQUAL(f*f, 8.0625f);
+    BOOST_CHECK_EQUAL(Csi::VectorF(3.0f, 4.0f, 0.0f).GetMagnitude(), 5.0f);
+    BOOST_CHECK_EQUAL(f.ToString(), "2 -2 0.25");
+    char text[] = "7 8.5 -9";
+    f = text;
+    BOOST_CHECK(f == Csi::VectorF(7.0f, 8.5f, -9.0f));
+
+    // conversions between precisions are explicit
+    Csi::Vector d(f);
+    BOOST_CHECK(d == Csi::Vector(7.0, 8.5, -9.0));
+    BOOST_CHECK(Csi::VectorF(d) == f);
+    BOOST_CHECK_EQUAL(std::hash<Csi::VectorF>()(f), std::hash<Csi::Vector>()(d));
+
+    std::set<Csi::VectorF, Csi::VectorComp> s;
+    s.insert(f);
+    s.insert(Csi::VectorF(0.0f, 0.0f, 0.0f));
+    BOOST_CHECK(*s.begin() == Csi::VectorF());
+}
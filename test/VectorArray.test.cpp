@@ -0,0 +1,157 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   VectorArray.test.cpp
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Unit test for VectorArray class
+///
+///  @details
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#define BOOST_TEST_MODULE TestSuite
+#define BOOST_TEST_DYN_LINK
+#define BOOST_AUTO_TEST_MAIN
+#include "VectorArray.h"
+#include <boost/test/unit_test.hpp>
+
+
+static Csi::VectorArray MakeArray()
+{
+    Csi::Vector v[5] = {Csi::Vector(1.0, 2.0, 3.0), Csi::Vector(-1.0, 0.5, 2.0), Csi::Vector(0.0, 0.0, 0.0),
+                        Csi::Vector(3.0, -4.0, 0.0), Csi::Vector(0.25, 8.0, -2.0)};
+    return Csi::VectorArray(v, 5);
+}
+
+BOOST_AUTO_TEST_CASE( vector_array_conversion_test )
+{
+    Csi::VectorArray a = MakeArray();
+    BOOST_CHECK_EQUAL(a.GetSize(), 5u);
+    BOOST_CHECK(a.Get(3) == Csi::Vector(3.0, -4.0, 0.0));
+    BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(a.GetX()) % 64, 0u);
+
+    std::vector<Csi::Vector> v = a.ToVectors();
+    BOOST_CHECK_EQUAL(v.size(), 5u);
+    for (size_t i=0; i<v.size(); ++i) BOOST_CHECK(v[i] == a.Get(i));
+
+    a.PushBack(Csi::Vector(7.0, 8.0, 9.0));
+    BOOST_CHECK_EQUAL(a.GetSize(), 6u);
+    BOOST_CHECK(a.Get(5) == Csi::Vector(7.0, 8.0, 9.0));
+}
+
+BOOST_AUTO_TEST_CASE( vector_array_arithmetic_test )
+{
+    Csi::VectorArray a = MakeArray();
+    Csi::VectorArray b = MakeArray();
+    b *= 2.0;
+    for (size_t i=0; i<a.GetSize(); ++i) BOOST_CHECK(b.Get(i) == a.Get(i)*2.0);
+
+    Csi::VectorArray c = a;
+    c += b;
+    for (size_t i=0; i<a.GetSize(); ++i) BOOST_CHECK(c.Get(i) == a.Get(i) + b.Get(i));
+    c -= b;
+    BOOST_CHECK(c == a);
+
+    c.Axpy(0.5, b);
+    for (size_t i=0; i<a.GetSize(); ++i) BOOST_CHECK(c.Get(i) == a.Get(i)*2.0);
+
+    c = a;
+    c += Csi::Vector(1.0, 1.0, 1.0);
+    BOOST_CHECK(c.Get(2) == Csi::Vector(1.0, 1.0, 1.0));
+
+    // the operand may be the array itself
+    c = a;
+    c += c;
+    BOOST_CHECK(c == b);
+    c.Axpy(-0.5, c);
+    BOOST_CHECK(c == a);
+    c -= c;
+    for (size_t i=0; i<c.GetSize(); ++i) BOOST_CHECK(c.Get(i) == Csi::Vector(0.0, 0.0, 0.0));
+}
+
+BOOST_AUTO_TEST_CASE( vector_array_product_test )
+{
+    Csi::VectorArray a = MakeArray();
+    Csi::VectorArray b = MakeArray();
+    b *= -3.0;
+    std::vector<double> dot(a.GetSize());
+    a.Dot(b, &dot[0]);
+    for (size_t i=0; i<a.GetSize(); ++i) BOOST_CHECK_EQUAL(dot[i], a.Get(i)*b.Get(i));
+    a.Dot(Csi::Vector(1.0, 2.0, 3.0), &dot[0]);
+    BOOST_CHECK_EQUAL(dot[0], 14.0);
+
+    std::vector<double> mag(a.GetSize());
+    a.GetMagnitudes(&mag[0]);
+    for (size_t i=0; i<a.GetSize(); ++i) BOOST_CHECK_EQUAL(mag[i], a.Get(i).GetMagnitude());
+    BOOST_CHECK_EQUAL(mag[3], 5.0);
+
+    Csi::VectorArray n = a;
+    n.Normalize();
+    BOOST_CHECK(n.Get(2) == Csi::Vector(0.0, 0.0, 0.0));
+    BOOST_CHECK_CLOSE(n.Get(3).x, 0.6, 1e-12);
+    BOOST_CHECK_CLOSE(n.Get(3).y, -0.8, 1e-12);
+    for (size_t i=0; i<n.GetSize(); ++i)
+    {
+        if (i != 2) BOOST_CHECK_CLOSE(n.Get(i).GetMagnitude(), 1.0, 1e-12);
+    }
+
+    // lengths whose squares underflow or overflow
+    Csi::Vector extreme[4] = {Csi::Vector(3e-200, -4e-200, 0.0), Csi::Vector(0.0, 5e-320, 0.0),
+                              Csi::Vector(3e200, 0.0, 4e200), Csi::Vector(-0.0, 0.0, 0.0)};
+    Csi::VectorArray e(extreme, 4);
+    e.Normalize();
+    BOOST_CHECK_CLOSE(e.Get(0).x, 0.6, 1e-12);
+    BOOST_CHECK_CLOSE(e.Get(0).y, -0.8, 1e-12);
+    BOOST_CHECK(e.Get(1) == Csi::Vector(0.0, 1.0, 0.0));
+    BOOST_CHECK_CLOSE(e.Get(2).x, 0.6, 1e-12);
+    BOOST_CHECK_CLOSE(e.Get(2).z, 0.8, 1e-12);
+    BOOST_CHECK(e.Get(3) == Csi::Vector(0.0, 0.0, 0.0));
+
+    Csi::Vector ex[2] = {Csi::Vector(1.0, 0.0, 0.0), Csi::Vector(0.0, 1.0, 0.0)};
+    Csi::Vector ey[2] = {Csi::Vector(0.0, 1.0, 0.0), Csi::Vector(0.0, 0.0, 1.0)};
+    Csi::VectorArray x(ex, 2), y(ey, 2), z;
+    x.Cross(y, z);
+    BOOST_CHECK(z.Get(0) == Csi::Vector(0.0, 0.0, 1.0));
+    BOOST_CHECK(z.Get(1) == Csi::Vector(1.0, 0.0, 0.0));
+    x.Cross(y, x);      // output may be an input
+    BOOST_CHECK(x == z);
+}
+
+BOOST_AUTO_TEST_CASE( vector_array_matrix_test )
+{
+    Csi::VectorArray a = MakeArray();
+    // rotation by 90 degrees about z
+    const double m[3][3] = {{0.0, -1.0, 0.0}, {1.0, 0.0, 0.0}, {0.0, 0.0, 1.0}};
+    Csi::VectorArray r = a;
+    r.Apply(m);
+    for (size_t i=0; i<a.GetSize(); ++i)
+    {
+        Csi::Vector v = a.Get(i);
+        BOOST_CHECK(r.Get(i) == Csi::Vector(-v.y, v.x, v.z));
+    }
+}
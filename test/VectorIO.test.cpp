@@ -0,0 +1,116 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   VectorIO.test.cpp
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Unit test for VectorGridSet class
+///
+///  @details
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#define BOOST_TEST_MODULE TestSuite
+#define BOOST_TEST_DYN_LINK
+#define BOOST_AUTO_TEST_MAIN
+#include "VectorIO.h"
+#include <cstdio>
+#include <boost/test/unit_test.hpp>
+
+
+BOOST_AUTO_TEST_CASE( vector_reader_parse_test )
+{
+    const std::string text("1 2 3\n\n  -4.5\t+5e1 6 extra\r\n7 8\n9 x 10\n1e-3 2E2 -0");
+    Csi::VectorReader reader;
+    std::vector<Csi::Vector> v;
+    reader.Parse(text.data(), text.size(), v);
+    BOOST_CHECK_EQUAL(v.size(), 3u);
+    BOOST_CHECK(v[0] == Csi::Vector(1.0, 2.0, 3.0));
+    BOOST_CHECK(v[1] == Csi::Vector(-4.5, 50.0, 6.0));
+    BOOST_CHECK(v[2] == Csi::Vector(1e-3, 200.0, 0.0));
+    BOOST_CHECK_EQUAL(reader.GetMalformed(), 2u);
+    BOOST_CHECK_EQUAL(reader.GetFirstMalformedLine(), 4u);
+
+    Csi::VectorArray a;
+    reader.Parse(text.data(), text.size(), a);
+    BOOST_CHECK_EQUAL(a.GetSize(), 3u);
+    BOOST_CHECK(a.Get(1) == v[1]);
+}
+
+BOOST_AUTO_TEST_CASE( vector_reader_threads_test )
+{
+    // enough text for several chunks, with a malformed line in a later one
+    std::string text;
+    Csi::VectorWriter writer;
+    std::vector<Csi::Vector> in;
+    for (int i=0; i<200000; ++i)
+    {
+        in.push_back(Csi::Vector(i*0.1, -i/7.0, i*1e-9));
+        writer.Append(text, in.back());
+        if (i == 150000) text += "bad line\n";
+    }
+    Csi::VectorReader reader;
+    reader.SetThreads(4);
+    std::vector<Csi::Vector> v;
+    reader.Parse(text.data(), text.size(), v);
+    BOOST_CHECK_EQUAL(v.size(), in.size());
+    BOOST_CHECK(v == in);
+    BOOST_CHECK_EQUAL(reader.GetMalformed(), 1u);
+    BOOST_CHECK_EQUAL(reader.GetFirstMalformedLine(), 150002u);
+}
+
+BOOST_AUTO_TEST_CASE( vector_writer_test )
+{
+    Csi::Vector v(0.1, -2.5, 1.0/3.0);
+    std::string text;
+    Csi::VectorWriter(Csi::VectorWriter::FORMAT_STREAM).Append(text, v);
+    BOOST_CHECK_EQUAL(text, v.ToString() + "\n");
+    text.clear();
+    Csi::VectorWriter().Append(text, v);
+    BOOST_CHECK_EQUAL(text, "0.1 -2.5 0.3333333333333333\n");
+
+    // round trip through a file, mapped and read
+    std::vector<Csi::Vector> in;
+    for (int i=0; i<1000; ++i) in.push_back(Csi::Vector(i/3.0, -i*1e10, 1.0/(i+1)));
+    const std::string fname("VectorIO.test.txt");
+    BOOST_CHECK(Csi::VectorWriter().Write(fname, in));
+    for (int mapping=0; mapping<2; ++mapping)
+    {
+        Csi::VectorReader reader;
+        reader.SetMapping(mapping);
+        Csi::VectorArray a;
+        BOOST_CHECK(reader.Load(fname, a));
+        BOOST_CHECK_EQUAL(a.GetSize(), in.size());
+        BOOST_CHECK(a == Csi::VectorArray(in.data(), in.size()));
+    }
+    remove(fname.c_str());
+
+    Csi::VectorReader reader;
+    std::vector<Csi::Vector> out;
+    BOOST_CHECK(!reader.Load("no/such/file", out));
+    BOOST_CHECK(!reader.GetError().empty());
+}
@@ -0,0 +1,115 @@
+// -----------------------------------------------------------------------
+///
+///  @file:   VectorSet.test.cpp
+///
+///  @author: Doug Reitz\n
+///           https://github.com/dreitz/ \n
+///
+///  @date:   20-May-2015\n
+///
+///  @brief   Unit test for VectorGridSet class
+///
+///  @details
+///
+///  Copyright The MIT License (MIT)
+///
+///            Copyright (c) 2015 Doug Reitz
+///
+///            Permission is hereby granted, free of charge, to any person obtaining a copy
+///            of this software and associated documentation files (the "Software"), to deal
+///            in the Software without restriction, including without limitation the rights
+///            to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+///            copies of the Software, and to permit persons to whom the Software is
+///            furnished to do so, subject to the following conditions:
+///
+///            The above copyright notice and this permission notice shall be included in
+///            all copies or substantial portions of the Software.
+///
+///            THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+///            IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+///            FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+///            AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+///            LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+///            OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+///            THE SOFTWARE.
+///
+//-------------------------------------------------------------------------
+#define BOOST_TEST_MODULE TestSuite
+#define BOOST_TEST_DYN_LINK
+#define BOOST_AUTO_TEST_MAIN
+#include "VectorSet.h"
+#include <boost/test/unit_test.hpp>
+
+
+BOOST_AUTO_TEST_CASE( vector_grid_set_exact_test )
+{
+    Csi::VectorGridSet set;
+    bool inserted(false);
+    BOOST_CHECK_EQUAL(set.Insert(Csi::Vector(1.0, 2.0, 3.0), &inserted), 0u);
+    BOOST_CHECK(inserted);
+    BOOST_CHECK_EQUAL(set.Insert(Csi::Vector(1.0, 2.0, 3.5), &inserted), 1u);
+    BOOST_CHECK(inserted);
+    BOOST_CHECK_EQUAL(set.Insert(Csi::Vector(1.0, 2.0, 3.0), &inserted), 0u);
+    BOOST_CHECK(!inserted);
+    BOOST_CHECK_EQUAL(set.GetSize(), 2u);
+    BOOST_CHECK_EQUAL(set.Find(Csi::Vector(1.0, 2.0, 3.5)), 1u);
+    BOOST_CHECK_EQUAL(set.Find(Csi::Vector(1.0, 2.0, 3.25)), Csi::VectorGridSet::npos);
+}
+
+BOOST_AUTO_TEST_CASE( vector_grid_set_tolerance_test )
+{
+    Csi::VectorGridSet set(0.1);
+    bool inserted(false);
+    BOOST_CHECK_EQUAL(set.Insert(Csi::Vector(0.0, 0.0, 0.0)), 0u);
+    // within the tolerance across a cell boundary
+    BOOST_CHECK_EQUAL(set.Insert(Csi::Vector(-0.05, 0.0, 0.05), &inserted), 0u);
+    BOOST_CHECK(!inserted);
+    BOOST_CHECK_EQUAL(set.Insert(Csi::Vector(0.2, 0.0, 0.0), &inserted), 1u);
+    BOOST_CHECK(inserted);
+    // nearest of two candidates
+    BOOST_CHECK_EQUAL(set.Find(Csi::Vector(0.14, 0.0, 0.0)), 1u);
+    BOOST_CHECK_EQUAL(set.Find(Csi::Vector(0.06, 0.0, 0.0)), 0u);
+    BOOST_CHECK_EQUAL(set.Find(Csi::Vector(0.1, 0.1, 0.0)), Csi::VectorGridSet::npos);
+    BOOST_CHECK_EQUAL(set.GetSize(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE( vector_grid_set_grid_test )
+{
+    // every point of a 0.5 grid once, then the grid again shifted by less than the tolerance
+    Csi::VectorGridSet set(0.2);
+    set.Reserve(1000);
+    for (int i=0; i<10; ++i)
+        for (int j=0; j<10; ++j)
+            for (int k=0; k<10; ++k) set.Insert(Csi::Vector(0.5*i, 0.5*j, -0.5*k));
+    BOOST_CHECK_EQUAL(set.GetSize(), 1000u);
+    size_t index(0);
+    for (int i=0; i<10; ++i)
+        for (int j=0; j<10; ++j)
+            for (int k=0; k<10; ++k, ++index)
+                BOOST_CHECK_EQUAL(set.Insert(Csi::Vector(0.5*i + 0.1, 0.5*j - 0.05, -0.5*k + 0.1)), index);
+    BOOST_CHECK_EQUAL(set.GetSize(), 1000u);
+    set.Clear();
+    BOOST_CHECK_EQUAL(set.GetSize(), 0u);
+    BOOST_CHECK_EQUAL(set.Find(Csi::Vector(0.0, 0.0, 0.0)), Csi::VectorGridSet::npos);
+}
+
+BOOST_AUTO_TEST_CASE( vector_grid_set_exact_large_test )
+{
+    // a million distinct points inside one unit cube, then all of them again
+    const int n = 100;
+    Csi::VectorGridSet set;
+    set.Reserve(n*n*n);
+    for (int i=0; i<n; ++i)
+        for (int j=0; j<n; ++j)
+            for (int k=0; k<n; ++k) set.Insert(Csi::Vector(0.01*i, 0.01*j, 0.01*k));
+    BOOST_CHECK_EQUAL(set.GetSize(), (size_t)n*n*n);
+    size_t index(0), mismatches(0);
+    for (int i=0; i<n; ++i)
+        for (int j=0; j<n; ++j)
+            for (int k=0; k<n; ++k, ++index)
+                if (set.Insert(Csi::Vector(0.01*i, 0.01*j, 0.01*k)) != index) ++mismatches;
+    BOOST_CHECK_EQUAL(mismatches, 0u);
+    BOOST_CHECK_EQUAL(set.GetSize(), (size_t)n*n*n);
+    BOOST_CHECK_EQUAL(set.Find(Csi::Vector(-0.0, 0.0, 0.0)), 0u);
+    BOOST_CHECK_EQUAL(set.Find(Csi::Vector(0.005, 0.0, 0.0)), Csi::VectorGridSet::npos);
+}